@@ -0,0 +1,422 @@
+/*
+ * fileio
+ *
+ * Copyright (c) 2000 - 2011 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "gstfileio.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_file_io_debug);
+#define GST_CAT_DEFAULT gst_file_io_debug
+
+typedef struct
+{
+  guint64 offset;
+  guint size;
+  GstBuffer *buffer;
+  gssize result;
+  gint error;                   /* errno when result is -1 */
+  gboolean done;
+  gboolean dropped;             /* nobody wants it anymore, freed once done */
+} GstFileIORequest;
+
+struct _GstFileIO
+{
+  gint fd;
+  guint depth;                  /* reads kept in flight for the reader */
+
+  GQueue *requests;             /* GstFileIORequest in submission order */
+  GMutex *lock;
+  GCond *cond;
+
+  GThreadPool *pool;
+#ifdef HAVE_LIBURING
+  gboolean use_uring;
+  struct io_uring ring;
+  guint inflight;               /* submitted to the ring, dropped ones too */
+#endif
+};
+
+static void
+gst_file_io_request_free (GstFileIORequest * req)
+{
+  if (req->buffer)
+    gst_buffer_unref (req->buffer);
+  g_slice_free (GstFileIORequest, req);
+}
+
+static void
+gst_file_io_worker (gpointer data, gpointer user_data)
+{
+  GstFileIORequest *req = data;
+  GstFileIO *io = user_data;
+  gssize ret;
+  gint error;
+
+  ret = pread (io->fd, GST_BUFFER_DATA (req->buffer), req->size, req->offset);
+  error = errno;
+
+  g_mutex_lock (io->lock);
+  req->result = ret;
+  req->error = ret < 0 ? error : 0;
+  req->done = TRUE;
+  g_cond_broadcast (io->cond);
+  g_mutex_unlock (io->lock);
+}
+
+/**
+ * gst_file_io_new:
+ * @fd: file descriptor to read
+ * @depth: number of reads to keep in flight
+ *
+ * Returns: a new #GstFileIO, NULL if neither backend could be set up
+ */
+GstFileIO *
+gst_file_io_new (gint fd, guint depth)
+{
+  static gsize debug_initialized = 0;
+  GstFileIO *io;
+  GError *error = NULL;
+
+  if (g_once_init_enter (&debug_initialized)) {
+    GST_DEBUG_CATEGORY_INIT (gst_file_io_debug, "fileio", 0, "async file reads");
+    g_once_init_leave (&debug_initialized, 1);
+  }
+
+  io = g_slice_new0 (GstFileIO);
+  io->fd = fd;
+  io->depth = MAX (depth, 1);
+  io->requests = g_queue_new ();
+  io->lock = g_mutex_new ();
+  io->cond = g_cond_new ();
+
+#ifdef HAVE_LIBURING
+  {
+    /* room for reads dropped on a seek that are still in flight */
+    gint ret = io_uring_queue_init (io->depth * 2, &io->ring, 0);
+
+    if (ret == 0) {
+      io->use_uring = TRUE;
+      GST_DEBUG ("reading fd %d with io_uring, %u reads in flight", fd, io->depth);
+      return io;
+    }
+    GST_INFO ("io_uring_queue_init () failed : %s, using threads", g_strerror (-ret));
+  }
+#endif
+
+  io->pool = g_thread_pool_new (gst_file_io_worker, io, io->depth, FALSE, &error);
+  if (io->pool == NULL) {
+    GST_WARNING ("could not create thread pool : %s", error->message);
+    g_error_free (error);
+    gst_file_io_free (io);
+    return NULL;
+  }
+
+  GST_DEBUG ("reading fd %d with %u threads", fd, io->depth);
+
+  return io;
+}
+
+/**
+ * gst_file_io_free:
+ * @io: a #GstFileIO
+ *
+ * Waits for the reads in flight and frees @io. The file descriptor is left
+ * open.
+ */
+void
+gst_file_io_free (GstFileIO * io)
+{
+  GstFileIORequest *req;
+
+#ifdef HAVE_LIBURING
+  if (io->use_uring) {
+    while (io->inflight > 0) {
+      struct io_uring_cqe *cqe;
+
+      io_uring_submit (&io->ring);
+      if (io_uring_wait_cqe (&io->ring, &cqe) < 0)
+        continue;
+      io_uring_cqe_seen (&io->ring, cqe);
+      io->inflight--;
+    }
+    io_uring_queue_exit (&io->ring);
+  }
+#endif
+
+  /* the reads not started yet are skipped */
+  if (io->pool)
+    g_thread_pool_free (io->pool, TRUE, TRUE);
+
+  while ((req = g_queue_pop_head (io->requests)))
+    gst_file_io_request_free (req);
+  g_queue_free (io->requests);
+
+  g_mutex_free (io->lock);
+  g_cond_free (io->cond);
+  g_slice_free (GstFileIO, io);
+}
+
+const gchar *
+gst_file_io_get_backend (GstFileIO * io)
+{
+#ifdef HAVE_LIBURING
+  if (io->use_uring)
+    return "io_uring";
+#endif
+  return "threads";
+}
+
+/* with lock held */
+static GstFileIORequest *
+gst_file_io_submit (GstFileIO * io, guint64 offset, guint size)
+{
+  GstFileIORequest *req;
+
+  req = g_slice_new0 (GstFileIORequest);
+  req->offset = offset;
+  req->size = size;
+  req->buffer = gst_buffer_try_new_and_alloc (size);
+  if (req->buffer == NULL) {
+    g_slice_free (GstFileIORequest, req);
+    return NULL;
+  }
+
+#ifdef HAVE_LIBURING
+  if (io->use_uring) {
+    struct io_uring_sqe *sqe = io_uring_get_sqe (&io->ring);
+
+    if (sqe == NULL) {
+      gst_file_io_request_free (req);
+      return NULL;
+    }
+    io_uring_prep_read (sqe, io->fd, GST_BUFFER_DATA (req->buffer), size, offset);
+    io_uring_sqe_set_data (sqe, req);
+    /* a failed submit is retried before waiting */
+    io_uring_submit (&io->ring);
+    io->inflight++;
+  } else
+#endif
+    g_thread_pool_push (io->pool, req, NULL);
+
+  g_queue_push_tail (io->requests, req);
+
+  return req;
+}
+
+/* with lock held */
+static void
+gst_file_io_wait (GstFileIO * io, GstFileIORequest * req)
+{
+#ifdef HAVE_LIBURING
+  if (io->use_uring) {
+    while (!req->done) {
+      struct io_uring_cqe *cqe;
+      GstFileIORequest *done;
+      gint ret;
+
+      io_uring_submit (&io->ring);
+      ret = io_uring_wait_cqe (&io->ring, &cqe);
+      if (ret == -EINTR || ret == -EAGAIN)
+        continue;
+      if (ret < 0) {
+        GST_ERROR ("io_uring_wait_cqe () failed : %s", g_strerror (-ret));
+        req->result = -1;
+        req->error = -ret;
+        req->done = TRUE;
+        break;
+      }
+
+      done = io_uring_cqe_get_data (cqe);
+      if (cqe->res == -EINVAL) {
+        /* kernel without IORING_OP_READ */
+        done->result = pread (io->fd, GST_BUFFER_DATA (done->buffer), done->size, done->offset);
+        done->error = done->result < 0 ? errno : 0;
+      } else {
+        done->result = cqe->res < 0 ? -1 : cqe->res;
+        done->error = cqe->res < 0 ? -cqe->res : 0;
+      }
+      done->done = TRUE;
+      io_uring_cqe_seen (&io->ring, cqe);
+      io->inflight--;
+    }
+    return;
+  }
+#endif
+
+  while (!req->done)
+    g_cond_wait (io->cond, io->lock);
+}
+
+/* with lock held, frees the dropped reads that completed */
+static void
+gst_file_io_reap (GstFileIO * io)
+{
+  GList *walk = io->requests->head;
+
+  while (walk) {
+    GstFileIORequest *req = walk->data;
+    GList *next = walk->next;
+
+    if (req->dropped && req->done) {
+      g_queue_delete_link (io->requests, walk);
+      gst_file_io_request_free (req);
+    }
+    walk = next;
+  }
+}
+
+/* with lock held */
+static GstFileIORequest *
+gst_file_io_find (GstFileIO * io, guint64 offset, guint size, guint * pending)
+{
+  GList *walk;
+
+  *pending = 0;
+  for (walk = io->requests->head; walk; walk = walk->next) {
+    GstFileIORequest *req = walk->data;
+
+    if (req->dropped)
+      continue;
+    if (req->offset == offset && req->size >= size)
+      return req;
+    (*pending)++;
+  }
+
+  return NULL;
+}
+
+/**
+ * gst_file_io_prefetch:
+ * @io: a #GstFileIO
+ * @offset: where to read
+ * @size: how much to read
+ *
+ * Starts reading the range unless it is being read already.
+ *
+ * Returns: FALSE if @depth reads are in flight already
+ */
+gboolean
+gst_file_io_prefetch (GstFileIO * io, guint64 offset, guint size)
+{
+  GstFileIORequest *req;
+  guint pending;
+
+  g_mutex_lock (io->lock);
+  gst_file_io_reap (io);
+
+  req = gst_file_io_find (io, offset, size, &pending);
+  if (req == NULL && pending < io->depth)
+    req = gst_file_io_submit (io, offset, size);
+  g_mutex_unlock (io->lock);
+
+  return req != NULL;
+}
+
+/**
+ * gst_file_io_read:
+ * @io: a #GstFileIO
+ * @offset: where to read
+ * @size: how much to read
+ * @buffer: the data read, with its offsets set
+ *
+ * Takes the data of a prefetched read of the range, waiting for it to
+ * complete, or reads the range. The reads prefetched for other ranges are
+ * dropped then, the reader went somewhere else.
+ *
+ * Returns: the number of bytes read like read (), -1 with errno set on
+ * error
+ */
+gssize
+gst_file_io_read (GstFileIO * io, guint64 offset, guint size, GstBuffer ** buffer)
+{
+  GstFileIORequest *req;
+  GstBuffer *buf;
+  gssize ret;
+  guint pending;
+
+  *buffer = NULL;
+
+  g_mutex_lock (io->lock);
+  req = gst_file_io_find (io, offset, size, &pending);
+  if (req == NULL) {
+    GList *walk;
+
+    GST_LOG ("no read in flight at %" G_GUINT64_FORMAT ", dropping %u", offset, pending);
+    for (walk = io->requests->head; walk; walk = walk->next)
+      ((GstFileIORequest *) walk->data)->dropped = TRUE;
+
+    req = gst_file_io_submit (io, offset, size);
+  }
+
+  if (req == NULL) {
+    g_mutex_unlock (io->lock);
+
+    /* out of memory or ring space, read it here */
+    buf = gst_buffer_try_new_and_alloc (size);
+    if (buf == NULL) {
+      errno = ENOMEM;
+      return -1;
+    }
+    ret = pread (io->fd, GST_BUFFER_DATA (buf), size, offset);
+    if (ret < 0) {
+      gint error = errno;
+
+      gst_buffer_unref (buf);
+      errno = error;
+      return -1;
+    }
+  } else {
+    g_queue_remove (io->requests, req);
+    gst_file_io_wait (io, req);
+    gst_file_io_reap (io);
+    g_mutex_unlock (io->lock);
+
+    ret = req->result;
+    if (ret < 0) {
+      gint error = req->error;
+
+      gst_file_io_request_free (req);
+      errno = error;
+      return -1;
+    }
+    buf = req->buffer;
+    req->buffer = NULL;
+    gst_file_io_request_free (req);
+  }
+
+  ret = MIN (ret, (gssize) size);
+  GST_BUFFER_SIZE (buf) = ret;
+  GST_BUFFER_OFFSET (buf) = offset;
+  GST_BUFFER_OFFSET_END (buf) = offset + ret;
+  *buffer = buf;
+
+  return ret;
+}
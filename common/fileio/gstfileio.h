@@ -0,0 +1,47 @@
+/*
+ * fileio
+ *
+ * Copyright (c) 2000 - 2011 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 2.1 of the License, or (at your option)
+ * any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef __GST_FILE_IO_H__
+#define __GST_FILE_IO_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GstFileIO:
+ *
+ * Reads of a file descriptor kept in flight ahead of the reader, with
+ * io_uring when built with liburing and the kernel supports it, else with
+ * a pool of threads doing pread (). Not thread safe, meant to be used from
+ * the streaming thread of a source only.
+ */
+typedef struct _GstFileIO GstFileIO;
+
+GstFileIO *gst_file_io_new (gint fd, guint depth);
+void gst_file_io_free (GstFileIO * io);
+const gchar *gst_file_io_get_backend (GstFileIO * io);
+gboolean gst_file_io_prefetch (GstFileIO * io, guint64 offset, guint size);
+gssize gst_file_io_read (GstFileIO * io, guint64 offset, guint size, GstBuffer ** buffer);
+
+G_END_DECLS
+
+#endif /* __GST_FILE_IO_H__ */
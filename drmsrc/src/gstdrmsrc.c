@@ -25,11 +25,22 @@
 #include "config.h"
 #endif
 #include "gstdrmsrc.h"
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 #define LOG_TRACE(message)  //g_print("DRM_SRC: %s: %d: %s - %s \n", __FILE__, __LINE__, __FUNCTION__, message);
 
 #define GST_TAG_PLAYREADY "playready_file_path"
 
+/* in mmap mode the file is mapped in windows of this size */
+#define DRM_SRC_MAP_WINDOW (8 * 1024 * 1024)
+#define DEFAULT_USE_MMAP FALSE
+
+/* reads of the next blocks kept in flight in async-io mode */
+#define DRM_SRC_ASYNC_DEPTH 4
+#define DEFAULT_ASYNC_IO FALSE
+
 static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,GST_STATIC_CAPS_ANY);
 
 
@@ -40,7 +51,9 @@ enum
 {
 	ARG_0,
 	ARG_LOCATION,
-	ARG_FD
+	ARG_FD,
+	ARG_USE_MMAP,
+	ARG_ASYNC_IO
 };
 static void gst_drm_src_finalize (GObject * object);
 static void gst_drm_src_set_property (GObject * object, guint prop_id, const GValue * value, GParamSpec * pspec);
@@ -122,6 +135,14 @@ static void gst_drm_src_class_init (GstDrmSrcClass * klass)
 	g_object_class_install_property (gobject_class, ARG_LOCATION,
 		g_param_spec_string ("location", "File Location",
 		"Location of the file to read", NULL, G_PARAM_READWRITE));
+	g_object_class_install_property (gobject_class, ARG_USE_MMAP,
+		g_param_spec_boolean ("use-mmap", "Use mmap",
+		"Push read-only windows of a memory mapping of the file instead of copying it into new buffers",
+		DEFAULT_USE_MMAP, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
+	g_object_class_install_property (gobject_class, ARG_ASYNC_IO,
+		g_param_spec_boolean ("async-io", "Async I/O",
+		"Keep reads of the next blocks in flight (io_uring or threads) instead of reading in the streaming thread",
+		DEFAULT_ASYNC_IO, G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY));
 
 	// 2. Assigns the function pointers GObject class attributes
 	gobject_class->finalize = GST_DEBUG_FUNCPTR (gst_drm_src_finalize);
@@ -155,6 +176,11 @@ static void gst_drm_src_init (GstDrmSrc * src, GstDrmSrcClass * g_class)
 	src->uri = NULL;
 	src->is_regular = FALSE;
 	src->seekable = FALSE;
+	src->use_mmap = DEFAULT_USE_MMAP;
+	src->can_mmap = FALSE;
+	src->mapping = NULL;
+	src->async_io = DEFAULT_ASYNC_IO;
+	src->io = NULL;
 	PROFILE_INIT;
 }
 /**
@@ -223,6 +249,8 @@ static gboolean gst_drm_src_set_location (GstDrmSrc * src, const gchar * locatio
 /**
  * This function does the following:
  *  1. Sets the location of the file.
+ *  2. Sets the mmap mode.
+ *  3. Sets the async I/O mode.
  *
  * @param   object    [in]   GObject Structure
  * @param   prop_id    [in]   id of the property
@@ -243,6 +271,14 @@ static void gst_drm_src_set_property (GObject * object, guint prop_id, const GVa
 		case ARG_LOCATION:
 			gst_drm_src_set_location (src, g_value_get_string (value));
 			break;
+		// 2. Sets the mmap mode.
+		case ARG_USE_MMAP:
+			src->use_mmap = g_value_get_boolean (value);
+			break;
+		// 3. Sets the async I/O mode.
+		case ARG_ASYNC_IO:
+			src->async_io = g_value_get_boolean (value);
+			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 			break;
@@ -252,6 +288,8 @@ static void gst_drm_src_set_property (GObject * object, guint prop_id, const GVa
  * This function does the following:
  *  1. Provides the location of the file.
  *  2. Provides the file descriptor.
+ *  3. Provides the mmap mode.
+ *  4. Provides the async I/O mode.
  *
  * @param   object    [in]   GObject Structure
  * @param   prop_id    [in]   id of the property
@@ -276,12 +314,186 @@ static void gst_drm_src_get_property (GObject * object, guint prop_id, GValue *
 		case ARG_FD:
 			g_value_set_int (value, src->fd);
 			break;
+		// 3. Provides the mmap mode.
+		case ARG_USE_MMAP:
+			g_value_set_boolean (value, src->use_mmap);
+			break;
+		// 4. Provides the async I/O mode.
+		case ARG_ASYNC_IO:
+			g_value_set_boolean (value, src->async_io);
+			break;
 		default:
 			G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 			break;
 	}
 }
 
+#ifdef HAVE_SYS_MMAN_H
+typedef struct
+{
+	gpointer data;
+	gsize size;
+} GstDrmSrcMapping;
+
+/**
+ * This function does the following:
+ *  1. Unmaps a window once the last buffer of it is gone
+ *
+ * @param   data    [in]   GstDrmSrcMapping of the window
+ *
+ * @return  void
+ */
+static void gst_drm_src_mapping_free (gpointer data)
+{
+	GstDrmSrcMapping *map = data;
+
+	// 1. Unmaps a window once the last buffer of it is gone
+	munmap (map->data, map->size);
+	g_slice_free (GstDrmSrcMapping, map);
+}
+/**
+ * This function does the following:
+ *  1. Maps a page aligned window covering the range
+ *  2. Wraps the window in a read-only buffer that unmaps it when freed
+ *
+ * @param   src    [in]   GstDrmSrc Structure
+ * @param   offset    [in]   offset of the range in the file
+ * @param   length    [in]   size of the range in bytes
+ *
+ * @return  GstBuffer*   Returns the window, NULL if mmap failed
+ */
+static GstBuffer * gst_drm_src_map_window (GstDrmSrc * src, guint64 offset, guint length)
+{
+	GstDrmSrcMapping *map;
+	GstBuffer *mapping;
+	guint64 pagesize = sysconf (_SC_PAGESIZE);
+	guint64 start, size;
+	gpointer data;
+
+	// 1. Maps a page aligned window covering the range
+	start = offset - (offset % pagesize);
+	size = MAX (offset + length - start, DRM_SRC_MAP_WINDOW);
+	size = MIN (size, src->size - start);
+	data = mmap (NULL, size, PROT_READ, MAP_SHARED, src->fd, start);
+	if (data == MAP_FAILED)
+	{
+		GST_WARNING_OBJECT (src, "mmap of %" G_GUINT64_FORMAT " bytes at %" G_GUINT64_FORMAT " failed: %s",
+			size, start, g_strerror (errno));
+		return NULL;
+	}
+	// 2. Wraps the window in a read-only buffer that unmaps it when freed
+	map = g_slice_new (GstDrmSrcMapping);
+	map->data = data;
+	map->size = size;
+	mapping = gst_buffer_new ();
+	GST_BUFFER_DATA (mapping) = data;
+	GST_BUFFER_SIZE (mapping) = size;
+	GST_BUFFER_OFFSET (mapping) = start;
+	GST_BUFFER_MALLOCDATA (mapping) = (guint8 *) map;
+	GST_BUFFER_FREE_FUNC (mapping) = gst_drm_src_mapping_free;
+	GST_BUFFER_FLAG_SET (mapping, GST_BUFFER_FLAG_READONLY);
+	return mapping;
+}
+/**
+ * This function does the following:
+ *  1. Clips the range to the end of the file
+ *  2. Maps a new window if the current one does not cover the range
+ *  3. Hands out a read-only subbuffer, which keeps the window mapped
+ *
+ * @param   src    [in]   GstDrmSrc Structure
+ * @param   offset    [in]   offset of the file to read
+ * @param   length    [in]   size of the data in bytes
+ * @param   buffer    [out]   GstBuffer to hold the contents
+ *
+ * @return  GstFlowReturn   Returns GST_FLOW_OK on success, GST_FLOW_NOT_SUPPORTED if mmap failed
+ */
+static GstFlowReturn gst_drm_src_create_mmap (GstDrmSrc * src, guint64 offset, guint length, GstBuffer ** buffer)
+{
+	GstBuffer *buf;
+
+	// 1. Clips the range to the end of the file
+	if (G_UNLIKELY (offset >= src->size))
+	{
+		GST_DEBUG ("mmap hits EOS");
+		return GST_FLOW_UNEXPECTED;
+	}
+	if (G_UNLIKELY (offset + length > src->size))
+	{
+		GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),("unexpected end of file."));
+		return GST_FLOW_ERROR;
+	}
+	// 2. Maps a new window if the current one does not cover the range
+	if (src->mapping == NULL || offset < GST_BUFFER_OFFSET (src->mapping) ||
+		offset + length > GST_BUFFER_OFFSET (src->mapping) + GST_BUFFER_SIZE (src->mapping))
+	{
+		GstBuffer *mapping = gst_drm_src_map_window (src, offset, length);
+		if (mapping == NULL)
+		{
+			GST_WARNING_OBJECT (src, "falling back to read ()");
+			src->can_mmap = FALSE;
+			return GST_FLOW_NOT_SUPPORTED;
+		}
+		if (src->mapping)
+			gst_buffer_unref (src->mapping);
+		src->mapping = mapping;
+	}
+	// 3. Hands out a read-only subbuffer, which keeps the window mapped
+	buf = gst_buffer_create_sub (src->mapping, offset - GST_BUFFER_OFFSET (src->mapping), length);
+	GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_READONLY);
+	GST_BUFFER_OFFSET (buf) = offset;
+	GST_BUFFER_OFFSET_END (buf) = offset + length;
+	*buffer = buf;
+	return GST_FLOW_OK;
+}
+#endif
+/**
+ * This function does the following:
+ *  1. Takes the block from the reads in flight or reads it
+ *  2. Starts reading the next blocks while this one is processed
+ *
+ * @param   src    [in]   GstDrmSrc Structure
+ * @param   offset    [in]   offset of the file to read
+ * @param   length    [in]   size of the data in bytes
+ * @param   buffer    [out]   GstBuffer to hold the contents
+ *
+ * @return  GstFlowReturn   Returns GST_FLOW_OK on success and ERROR on failure
+ */
+static GstFlowReturn gst_drm_src_create_async (GstDrmSrc * src, guint64 offset, guint length, GstBuffer ** buffer)
+{
+	GstBuffer *buf;
+	gssize ret;
+	guint i;
+
+	// 1. Takes the block from the reads in flight or reads it
+	GST_LOG_OBJECT (src, "Reading %d bytes with %s", length, gst_file_io_get_backend (src->io));
+	ret = gst_file_io_read (src->io, offset, length, &buf);
+	if (G_UNLIKELY (ret < 0))
+	{
+		GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL), GST_ERROR_SYSTEM);
+		return GST_FLOW_ERROR;
+	}
+	if (G_UNLIKELY ((guint) ret < length && src->seekable))
+	{
+		GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),("unexpected end of file."));
+		gst_buffer_unref (buf);
+		return GST_FLOW_ERROR;
+	}
+	if (G_UNLIKELY (ret == 0))
+	{
+		GST_DEBUG ("non-regular file hits EOS");
+		gst_buffer_unref (buf);
+		return GST_FLOW_UNEXPECTED;
+	}
+	// 2. Starts reading the next blocks while this one is processed
+	for (i = 1; i <= DRM_SRC_ASYNC_DEPTH; i++)
+	{
+		guint64 next = offset + (guint64) i * length;
+		if (next >= src->size || !gst_file_io_prefetch (src->io, next, length))
+			break;
+	}
+	*buffer = buf;
+	return GST_FLOW_OK;
+}
 /**
  * This function does the following:
  *  1. Seeks to the specified position.
@@ -359,6 +571,16 @@ static GstFlowReturn gst_drm_src_create (GstBaseSrc * basesrc, guint64 offset, g
 	// 1. Calls DRM file read chain method for drm files.
 
 	// 2. Calls normal file read chain method for standard files.
+#ifdef HAVE_SYS_MMAN_H
+	if (src->can_mmap && length > 0)
+	{
+		GstFlowReturn ret = gst_drm_src_create_mmap (src, offset, length, buffer);
+		if (ret != GST_FLOW_NOT_SUPPORTED)
+			return ret;
+	}
+#endif
+	if (src->io && length > 0)
+		return gst_drm_src_create_async (src, offset, length, buffer);
 	return gst_drm_src_create_read (src, offset, length, buffer);
 }
 /**
@@ -467,12 +689,26 @@ PROFILE_FUNC_BEGIN;
 	}
 	lseek (src->fd, 0, SEEK_SET);
 	src->seekable = src->seekable && src->is_regular;
+	src->size = stat_results.st_size;
+#ifdef HAVE_SYS_MMAN_H
+	src->can_mmap = src->use_mmap && src->is_regular;
+#else
+	if (src->use_mmap)
+		GST_WARNING_OBJECT (src, "mmap is not supported, reading the file");
+#endif
+	if (!src->can_mmap && src->async_io && src->is_regular)
+	{
+		src->io = gst_file_io_new (src->fd, DRM_SRC_ASYNC_DEPTH);
+		if (src->io == NULL)
+			GST_WARNING_OBJECT (src, "async I/O not available, reading in create ()");
+	}
 	PROFILE_FUNC_END;
 	return TRUE;
 }
 /**
  * This function does the following:
  *  1. Closes the file desciptor and resets the flags
+ *  2. Drops the current mmap window
  *
  * @param   basesrc    [in]   BaseSrc Structure
  *
@@ -483,10 +719,18 @@ static gboolean gst_drm_src_stop (GstBaseSrc * basesrc)
 	GstDrmSrc *src = GST_DRM_SRC (basesrc);
 
 	// 1. Closes the file desciptor and resets the flags
+	if (src->io)
+		gst_file_io_free (src->io);
+	src->io = NULL;
 	if(src->fd > 0)
 		close (src->fd);
 	src->fd = 0;
 	src->is_regular = FALSE;
+	// 2. Drops the current mmap window, buffers still out keep it mapped
+	if (src->mapping)
+		gst_buffer_unref (src->mapping);
+	src->mapping = NULL;
+	src->can_mmap = FALSE;
 //	PROFILE_SHOW_RESULT;
 	return TRUE;
 }
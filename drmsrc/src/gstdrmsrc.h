@@ -28,6 +28,7 @@
 #include <sys/types.h>
 #include <gst/gst.h>
 #include <gst/base/gstbasesrc.h>
+#include "gstfileio.h"
 #include <stdio.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -92,6 +93,12 @@ struct _GstDrmSrc
 	guint64 read_position;	
       gboolean seekable;      
 	gboolean is_regular;    
+	gboolean use_mmap;		/* push windows of a mapping instead of reading */
+	gboolean can_mmap;		/* use_mmap and the file could be mapped */
+	guint64 size;			/* file size, for clipping the mapped ranges */
+	GstBuffer *mapping;		/* current window, OFFSET is its file offset */
+	gboolean async_io;		/* keep reads in flight instead of reading in create () */
+	GstFileIO *io;
 };
 
 struct _GstDrmSrcClass 
@@ -55,6 +55,14 @@
 #include <errno.h>
 #include <string.h>
 
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
@@ -86,17 +94,57 @@ GST_DEBUG_CATEGORY_STATIC (gst_pd_pushsrc_debug);
 /* FileSrc signals and args */
 enum
 {
-  /* FILL ME */
+  SIGNAL_ADD_RANGE,
   LAST_SIGNAL
 };
 
+static guint gst_pd_pushsrc_signals[LAST_SIGNAL] = { 0 };
+
 #define DEFAULT_BLOCKSIZE       4*1024
 
+/* without inotify the file size is polled, at the interval a block takes at
+ * the minimum download rate (64 Kbps) */
+#define PD_PUSHSRC_MIN_RATE             64000
+#define PD_PUSHSRC_MAX_POLL_INTERVAL    (200 * GST_MSECOND)
+/* with inotify the size is still checked this often, in case the file is
+ * replaced instead of appended to */
+#define PD_PUSHSRC_WATCH_INTERVAL       GST_SECOND
+#define DEFAULT_USE_INOTIFY             TRUE
+
+/* in mmap mode the file is mapped in windows of this size, reaching past the
+ * end of the file while it is being downloaded */
+#define PD_PUSHSRC_MAP_WINDOW           (8 * 1024 * 1024)
+
+#define DEFAULT_USE_MMAP                FALSE
+
+/* in copy mode the file is read in windows of readahead-size, the last few
+ * of them are kept to serve reads going back and forth. Off by default, the
+ * reads stay what basesrc asks for unless the application opts in */
+#define PD_PUSHSRC_RA_WINDOWS           4
+#define PD_PUSHSRC_RA_NONE              G_MAXUINT64
+#define DEFAULT_READAHEAD_SIZE          0
+#define MAX_READAHEAD_SIZE              (64 * 1024 * 1024)
+
+#define DEFAULT_EXPECTED_SIZE           0
+#define DEFAULT_BUFFERING_SIZE          0
+#define DEFAULT_SPARSE                  FALSE
+
+/* reads of the next blocks kept in flight in async-io mode */
+#define PD_PUSHSRC_ASYNC_DEPTH          4
+#define DEFAULT_ASYNC_IO                FALSE
+
 enum
 {
   ARG_0,
   ARG_LOCATION,
   ARG_EOS,
+  ARG_USE_MMAP,
+  ARG_READAHEAD_SIZE,
+  ARG_EXPECTED_SIZE,
+  ARG_BUFFERING_SIZE,
+  ARG_SPARSE,
+  ARG_ASYNC_IO,
+  ARG_USE_INOTIFY,
 };
 
 static void gst_pd_pushsrc_finalize (GObject * object);
@@ -106,6 +154,8 @@ static void gst_pd_pushsrc_get_property (GObject * object, guint prop_id, GValue
 
 static gboolean gst_pd_pushsrc_start (GstBaseSrc * basesrc);
 static gboolean gst_pd_pushsrc_stop (GstBaseSrc * basesrc);
+static gboolean gst_pd_pushsrc_unlock (GstBaseSrc * basesrc);
+static gboolean gst_pd_pushsrc_unlock_stop (GstBaseSrc * basesrc);
 
 static gboolean gst_pd_pushsrc_is_seekable (GstBaseSrc * src);
 static gboolean gst_pd_pushsrc_get_size (GstBaseSrc * src, guint64 * size);
@@ -113,6 +163,42 @@ static gboolean gst_pd_pushsrc_query (GstBaseSrc * src, GstQuery * query);
 static void gst_pd_pushsrc_uri_handler_init (gpointer g_iface, gpointer iface_data);
 static GstFlowReturn gst_pd_pushsrc_create (GstBaseSrc * basesrc, guint64 offset, guint length, GstBuffer ** buffer);
 static gboolean gst_pd_pushsrc_checkgetrange (GstPad * pad);
+static void gst_pd_pushsrc_add_range (GstPDPushSrc * src, guint64 offset, guint64 size);
+static void gst_pd_pushsrc_wakeup_init (GstPDPushSrc * src);
+static void gst_pd_pushsrc_wakeup (GstPDPushSrc * src);
+
+#ifdef G_ENABLE_DEBUG
+#define g_marshal_value_peek_uint64(v)   g_value_get_uint64 (v)
+#else /* !G_ENABLE_DEBUG */
+#define g_marshal_value_peek_uint64(v)   (v)->data[0].v_uint64
+#endif /* !G_ENABLE_DEBUG */
+
+/* VOID:UINT64,UINT64 */
+static void
+gst_pd_pushsrc_VOID__UINT64_UINT64 (GClosure * closure, GValue * return_value G_GNUC_UNUSED,
+    guint n_param_values, const GValue * param_values,
+    gpointer invocation_hint G_GNUC_UNUSED, gpointer marshal_data)
+{
+  typedef void (*GMarshalFunc_VOID__UINT64_UINT64) (gpointer data1, guint64 arg_1,
+      guint64 arg_2, gpointer data2);
+  register GMarshalFunc_VOID__UINT64_UINT64 callback;
+  register GCClosure *cc = (GCClosure *) closure;
+  register gpointer data1, data2;
+
+  g_return_if_fail (n_param_values == 3);
+
+  if (G_CCLOSURE_SWAP_DATA (closure)) {
+    data1 = closure->data;
+    data2 = g_value_peek_pointer (param_values + 0);
+  } else {
+    data1 = g_value_peek_pointer (param_values + 0);
+    data2 = closure->data;
+  }
+  callback = (GMarshalFunc_VOID__UINT64_UINT64) (marshal_data ? marshal_data : cc->callback);
+
+  callback (data1, g_marshal_value_peek_uint64 (param_values + 1),
+      g_marshal_value_peek_uint64 (param_values + 2), data2);
+}
 
 static void
 _do_init (GType pd_pushsrc_type)
@@ -173,9 +259,86 @@ gst_pd_pushsrc_class_init (GstPDPushSrcClass * klass)
                                         "download of clip is over",
                                         0,
                                         G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, ARG_USE_MMAP,
+      g_param_spec_boolean ("use-mmap", "Use mmap",
+          "Push read-only windows of a memory mapping of the file instead of "
+          "copying it into new buffers", DEFAULT_USE_MMAP,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, ARG_READAHEAD_SIZE,
+      g_param_spec_uint ("readahead-size", "Read-ahead size",
+          "Size of the windows read ahead of sequential reads and cached for "
+          "seeking reads, e.g. 262144 (0 = read exactly what is asked)", 0, MAX_READAHEAD_SIZE,
+          DEFAULT_READAHEAD_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, ARG_EXPECTED_SIZE,
+      g_param_spec_uint64 ("expected-size", "Expected size",
+          "Size of the file once downloaded, reported as its size and ends "
+          "the stream without eos being set (0 = unknown)", 0, G_MAXUINT64,
+          DEFAULT_EXPECTED_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
+  g_object_class_install_property (gobject_class, ARG_BUFFERING_SIZE,
+      g_param_spec_uint ("buffering-size", "Buffering size",
+          "When reading catches up with the download, post buffering messages "
+          "and wait till this many bytes are ahead again (0 = disabled)", 0,
+          G_MAXUINT, DEFAULT_BUFFERING_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, ARG_SPARSE,
+      g_param_spec_boolean ("sparse", "Sparse",
+          "The file is written out of order, only the ranges given with "
+          "add-range can be read", DEFAULT_SPARSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, ARG_ASYNC_IO,
+      g_param_spec_boolean ("async-io", "Async I/O",
+          "Keep reads of the next blocks in flight (io_uring or threads) "
+          "instead of reading in the streaming thread", DEFAULT_ASYNC_IO,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class, ARG_USE_INOTIFY,
+      g_param_spec_boolean ("use-inotify", "Use inotify",
+          "Wake up on inotify when the file is written, poll its size when "
+          "FALSE or when inotify is not available", DEFAULT_USE_INOTIFY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstPDPushSrc::add-range:
+   * @src: the pdpushsrc
+   * @offset: start of the range in the file
+   * @size: size of the range
+   *
+   * Tells a sparse pdpushsrc the range was written, a read waiting for it
+   * goes on right away.
+   *
+   * Write, then add-range: a waiting reader may read the range before the
+   * signal even returns, so the data has to be in the file (write () or
+   * pwrite () returned, the writes to a mapping done) before emitting it. A
+   * range announced ahead of its data is read as whatever the file holds
+   * there, zeros in a hole.
+   */
+  gst_pd_pushsrc_signals[SIGNAL_ADD_RANGE] =
+      g_signal_new ("add-range", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GstPDPushSrcClass, add_range), NULL, NULL,
+      gst_pd_pushsrc_VOID__UINT64_UINT64, G_TYPE_NONE, 2, G_TYPE_UINT64, G_TYPE_UINT64);
+
+  klass->add_range = gst_pd_pushsrc_add_range;
    
   gstbasesrc_class->start = GST_DEBUG_FUNCPTR (gst_pd_pushsrc_start);
   gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_pd_pushsrc_stop);
+  gstbasesrc_class->unlock = GST_DEBUG_FUNCPTR (gst_pd_pushsrc_unlock);
+  gstbasesrc_class->unlock_stop = GST_DEBUG_FUNCPTR (gst_pd_pushsrc_unlock_stop);
   gstbasesrc_class->is_seekable = GST_DEBUG_FUNCPTR (gst_pd_pushsrc_is_seekable);
   gstbasesrc_class->get_size = GST_DEBUG_FUNCPTR (gst_pd_pushsrc_get_size);
   gstbasesrc_class->query = GST_DEBUG_FUNCPTR (gst_pd_pushsrc_query);
@@ -201,6 +364,29 @@ gst_pd_pushsrc_init (GstPDPushSrc * src, GstPDPushSrcClass * g_class)
   src->uri = NULL;
   src->is_regular = FALSE;
   src->is_eos = FALSE;
+  src->expected_size = DEFAULT_EXPECTED_SIZE;
+  src->buffering_size = DEFAULT_BUFFERING_SIZE;
+  src->buffering = FALSE;
+  src->buffering_percent = -1;
+  src->sparse = DEFAULT_SPARSE;
+  src->ranges = g_array_new (FALSE, FALSE, sizeof (GstPDPushSrcRange));
+  src->async_io = DEFAULT_ASYNC_IO;
+  src->io = NULL;
+  src->poll = gst_poll_new (TRUE);
+  gst_poll_fd_init (&src->pollfd);
+  src->watch = -1;
+  gst_poll_fd_init (&src->wakeupfd);
+  src->wakeup_write = -1;
+  gst_pd_pushsrc_wakeup_init (src);
+  src->use_inotify = DEFAULT_USE_INOTIFY;
+  src->use_mmap = DEFAULT_USE_MMAP;
+  src->can_mmap = FALSE;
+  src->mapping = NULL;
+  src->readahead_size = DEFAULT_READAHEAD_SIZE;
+  src->ra_ring = NULL;
+  src->ra_thread = NULL;
+  src->ra_lock = g_mutex_new ();
+  src->ra_cond = g_cond_new ();
   
   gst_pad_set_checkgetrange_function (basesrc->srcpad, GST_DEBUG_FUNCPTR (gst_pd_pushsrc_checkgetrange));
 
@@ -219,6 +405,20 @@ gst_pd_pushsrc_finalize (GObject * object)
   g_free (src->filename);
   g_free (src->uri);
 
+  if (src->wakeupfd.fd >= 0) {
+    gst_poll_remove_fd (src->poll, &src->wakeupfd);
+    close (src->wakeupfd.fd);
+    close (src->wakeup_write);
+  }
+
+  if (src->poll)
+    gst_poll_free (src->poll);
+
+  g_array_free (src->ranges, TRUE);
+
+  g_mutex_free (src->ra_lock);
+  g_cond_free (src->ra_cond);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 
   GST_LOG ("OUT");
@@ -241,6 +441,11 @@ gst_pd_pushsrc_set_location (GstPDPushSrc * src, const gchar * location)
   g_free (src->filename);
   g_free (src->uri);
 
+  /* ranges were of the old file */
+  GST_OBJECT_LOCK (src);
+  g_array_set_size (src->ranges, 0);
+  GST_OBJECT_UNLOCK (src);
+
   /* clear the filename if we get a NULL (is that possible?) */
   if (location == NULL) {
     src->filename = NULL;
@@ -289,6 +494,31 @@ gst_pd_pushsrc_set_property (GObject * object, guint prop_id, const GValue * val
     case ARG_EOS:
       src->is_eos = g_value_get_boolean (value);
       g_print ("\n\n\nis_eos is becoming %d\n\n\n", src->is_eos);
+      /* wake up a reader waiting for more data */
+      gst_pd_pushsrc_wakeup (src);
+      break;
+    case ARG_USE_MMAP:
+      src->use_mmap = g_value_get_boolean (value);
+      break;
+    case ARG_READAHEAD_SIZE:
+      src->readahead_size = g_value_get_uint (value);
+      break;
+    case ARG_EXPECTED_SIZE:
+      src->expected_size = g_value_get_uint64 (value);
+      /* the download may be complete now */
+      gst_pd_pushsrc_wakeup (src);
+      break;
+    case ARG_BUFFERING_SIZE:
+      src->buffering_size = g_value_get_uint (value);
+      break;
+    case ARG_SPARSE:
+      src->sparse = g_value_get_boolean (value);
+      break;
+    case ARG_ASYNC_IO:
+      src->async_io = g_value_get_boolean (value);
+      break;
+    case ARG_USE_INOTIFY:
+      src->use_inotify = g_value_get_boolean (value);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -315,6 +545,27 @@ gst_pd_pushsrc_get_property (GObject * object, guint prop_id, GValue * value,
     case ARG_EOS:
       g_value_set_boolean (value, src->is_eos);
       break;
+    case ARG_USE_MMAP:
+      g_value_set_boolean (value, src->use_mmap);
+      break;
+    case ARG_READAHEAD_SIZE:
+      g_value_set_uint (value, src->readahead_size);
+      break;
+    case ARG_EXPECTED_SIZE:
+      g_value_set_uint64 (value, src->expected_size);
+      break;
+    case ARG_BUFFERING_SIZE:
+      g_value_set_uint (value, src->buffering_size);
+      break;
+    case ARG_SPARSE:
+      g_value_set_boolean (value, src->sparse);
+      break;
+    case ARG_ASYNC_IO:
+      g_value_set_boolean (value, src->async_io);
+      break;
+    case ARG_USE_INOTIFY:
+      g_value_set_boolean (value, src->use_inotify);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -322,14 +573,592 @@ gst_pd_pushsrc_get_property (GObject * object, guint prop_id, GValue * value,
   GST_LOG ("OUT");
 }
 
+/* watches the file for the writer appending to it, falls back to polling
+ * the file size when inotify is not available or not wanted */
+static void
+gst_pd_pushsrc_watch_start (GstPDPushSrc * src)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+  gint fd = -1;
+
+  if (!src->use_inotify) {
+    GST_DEBUG_OBJECT (src, "use-inotify is off, polling file size");
+    return;
+  }
+
+  fd = inotify_init ();
+  if (fd < 0) {
+    GST_WARNING_OBJECT (src, "inotify_init () failed : %s, polling file size", g_strerror (errno));
+    return;
+  }
+
+  fcntl (fd, F_SETFL, O_NONBLOCK);
+  fcntl (fd, F_SETFD, FD_CLOEXEC);
+
+  src->watch = inotify_add_watch (fd, src->filename, IN_MODIFY | IN_CLOSE_WRITE);
+  if (src->watch < 0) {
+    GST_WARNING_OBJECT (src, "inotify_add_watch () failed : %s, polling file size", g_strerror (errno));
+    close (fd);
+    return;
+  }
+
+  src->pollfd.fd = fd;
+  gst_poll_add_fd (src->poll, &src->pollfd);
+  gst_poll_fd_ctl_read (src->poll, &src->pollfd, TRUE);
+
+  GST_DEBUG_OBJECT (src, "watching %s with inotify", src->filename);
+#else
+  GST_DEBUG_OBJECT (src, "no inotify, polling file size");
+#endif
+}
+
+static void
+gst_pd_pushsrc_watch_stop (GstPDPushSrc * src)
+{
+  if (src->pollfd.fd < 0)
+    return;
+
+  gst_poll_remove_fd (src->poll, &src->pollfd);
+  close (src->pollfd.fd);
+  gst_poll_fd_init (&src->pollfd);
+  src->watch = -1;
+}
+
+/* gst_poll_restart () only restarts a gst_poll_wait () in progress, with the
+ * same timeout, it does not make it return. The writer side (eos,
+ * expected-size, add-range) writes a byte to a pipe in the poll instead, a
+ * byte written before the reader gets to wait makes the wait return at once */
+static void
+gst_pd_pushsrc_wakeup_init (GstPDPushSrc * src)
+{
+  gint fds[2];
+
+  if (pipe (fds) < 0) {
+    GST_WARNING_OBJECT (src, "pipe () failed : %s, waking up on timeouts only", g_strerror (errno));
+    return;
+  }
+
+  fcntl (fds[0], F_SETFL, O_NONBLOCK);
+  fcntl (fds[1], F_SETFL, O_NONBLOCK);
+  fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl (fds[1], F_SETFD, FD_CLOEXEC);
+
+  src->wakeupfd.fd = fds[0];
+  gst_poll_add_fd (src->poll, &src->wakeupfd);
+  gst_poll_fd_ctl_read (src->poll, &src->wakeupfd, TRUE);
+  src->wakeup_write = fds[1];
+}
+
+/* called once what the reader waits on changed */
+static void
+gst_pd_pushsrc_wakeup (GstPDPushSrc * src)
+{
+  if (src->wakeup_write < 0)
+    return;
+
+  /* a full pipe has wakeups pending already */
+  if (write (src->wakeup_write, "w", 1) < 0 && errno != EAGAIN)
+    GST_WARNING_OBJECT (src, "could not wake up the reader : %s", g_strerror (errno));
+}
+
+/* waits till the writer appended to the file, it is up to the caller to
+ * check how much. Woken up right away by inotify, by unlock and by
+ * gst_pd_pushsrc_wakeup () */
+static GstFlowReturn
+gst_pd_pushsrc_wait_data (GstPDPushSrc * src, guint blocksize)
+{
+  GstClockTime start = gst_util_get_timestamp ();
+  GstClockTime timeout;
+  gint ret;
+
+  if (src->pollfd.fd >= 0) {
+    timeout = PD_PUSHSRC_WATCH_INTERVAL;
+  } else {
+    // wait_time = (blocksize * 8) / (min downloadratei.e. 64Kbps)
+    timeout = gst_util_uint64_scale (blocksize * 8, GST_SECOND, PD_PUSHSRC_MIN_RATE);
+    timeout = MIN (timeout, PD_PUSHSRC_MAX_POLL_INTERVAL);
+  }
+
+  GST_DEBUG_OBJECT (src, "Going to wait for %" GST_TIME_FORMAT, GST_TIME_ARGS (timeout));
+
+  ret = gst_poll_wait (src->poll, timeout);
+  if (ret < 0) {
+    if (errno == EBUSY) {
+      GST_DEBUG_OBJECT (src, "flushing, stop waiting");
+      return GST_FLOW_WRONG_STATE;
+    }
+    if (errno != EINTR && errno != EAGAIN) {
+      GST_ERROR_OBJECT (src, "ERROR in gst_poll_wait () : reason - %s...\n", g_strerror (errno));
+      GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL), GST_ERROR_SYSTEM);
+      return GST_FLOW_ERROR;
+    }
+  } else if (ret == 0) {
+    GST_LOG_OBJECT (src, "wait timeout happened...");
+  }
+
+#ifdef HAVE_SYS_INOTIFY_H
+  if (ret > 0 && gst_poll_fd_can_read (src->poll, &src->pollfd)) {
+    gchar events[256 * sizeof (struct inotify_event)];
+
+    /* the events only tell the file changed, drop them all */
+    while (read (src->pollfd.fd, events, sizeof (events)) > 0);
+  }
+#endif
+
+  /* the caller checks what changed, once is enough for every byte written */
+  if (ret > 0 && src->wakeupfd.fd >= 0 && gst_poll_fd_can_read (src->poll, &src->wakeupfd)) {
+    gchar bytes[64];
+
+    while (read (src->wakeupfd.fd, bytes, sizeof (bytes)) > 0);
+  }
+
+  GST_LOG_OBJECT (src, "woke up after %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (gst_util_get_timestamp () - start));
+
+  return GST_FLOW_OK;
+}
+
+#ifdef HAVE_SYS_MMAN_H
+typedef struct
+{
+  gpointer data;
+  gsize size;
+} GstPDPushSrcMapping;
+
+/* free function of a window, called once the last buffer of it is gone */
+static void
+gst_pd_pushsrc_mapping_free (gpointer data)
+{
+  GstPDPushSrcMapping *map = data;
+
+  GST_LOG ("unmapping %p, %" G_GSIZE_FORMAT " bytes", map->data, map->size);
+  munmap (map->data, map->size);
+  g_slice_free (GstPDPushSrcMapping, map);
+}
+
+/* maps a window covering offset .. offset + length. The window reaches past
+ * the end of the file so that data appended later is visible through it,
+ * only the part the file size covers may be touched though */
+static GstBuffer *
+gst_pd_pushsrc_map_window (GstPDPushSrc * src, guint64 offset, guint length)
+{
+  GstPDPushSrcMapping *map;
+  GstBuffer *mapping;
+  guint64 pagesize = sysconf (_SC_PAGESIZE);
+  guint64 start, size;
+  gpointer data;
+
+  start = offset - (offset % pagesize);
+  size = offset + length - start;
+  size = MAX (size + pagesize - 1 - (size + pagesize - 1) % pagesize, PD_PUSHSRC_MAP_WINDOW);
+
+  data = mmap (NULL, size, PROT_READ, MAP_SHARED, src->fd, start);
+  if (data == MAP_FAILED) {
+    GST_WARNING_OBJECT (src, "mmap of %" G_GUINT64_FORMAT " bytes at %" G_GUINT64_FORMAT
+        " failed : %s", size, start, g_strerror (errno));
+    return NULL;
+  }
+
+  GST_LOG_OBJECT (src, "mapped %" G_GUINT64_FORMAT " bytes at %" G_GUINT64_FORMAT " to %p",
+      size, start, data);
+
+  map = g_slice_new (GstPDPushSrcMapping);
+  map->data = data;
+  map->size = size;
+
+  mapping = gst_buffer_new ();
+  GST_BUFFER_DATA (mapping) = data;
+  GST_BUFFER_SIZE (mapping) = size;
+  GST_BUFFER_OFFSET (mapping) = start;
+  GST_BUFFER_MALLOCDATA (mapping) = (guint8 *) map;
+  GST_BUFFER_FREE_FUNC (mapping) = gst_pd_pushsrc_mapping_free;
+  GST_BUFFER_FLAG_SET (mapping, GST_BUFFER_FLAG_READONLY);
+
+  return mapping;
+}
+
+/* hands out a read-only subbuffer of the current window, mapping a new one
+ * when the range is not covered. Buffers keep their window mapped, so an
+ * old window goes away with the last buffer pushed from it */
+static GstFlowReturn
+gst_pd_pushsrc_create_mmap (GstPDPushSrc * src, guint64 offset, guint length, GstBuffer ** buffer)
+{
+  GstBuffer *buf;
+
+  if (src->mapping == NULL || offset < GST_BUFFER_OFFSET (src->mapping) ||
+      offset + length > GST_BUFFER_OFFSET (src->mapping) + GST_BUFFER_SIZE (src->mapping)) {
+    GstBuffer *mapping = gst_pd_pushsrc_map_window (src, offset, length);
+
+    if (mapping == NULL) {
+      GST_WARNING_OBJECT (src, "falling back to read ()");
+      src->can_mmap = FALSE;
+      return GST_FLOW_NOT_SUPPORTED;
+    }
+    if (src->mapping)
+      gst_buffer_unref (src->mapping);
+    src->mapping = mapping;
+  }
+
+  buf = gst_buffer_create_sub (src->mapping, offset - GST_BUFFER_OFFSET (src->mapping), length);
+  GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_READONLY);
+  GST_BUFFER_OFFSET (buf) = offset;
+  GST_BUFFER_OFFSET_END (buf) = offset + length;
+
+  *buffer = buf;
+
+  return GST_FLOW_OK;
+}
+#endif
+
+/* merges offset .. offset + size into the ranges, called by the writer once
+ * the range is in the file, then wakes the reader up */
+static void
+gst_pd_pushsrc_add_range (GstPDPushSrc * src, guint64 offset, guint64 size)
+{
+  GstPDPushSrcRange range;
+  guint lo, hi, i;
+
+  if (size == 0)
+    return;
+
+  range.start = offset;
+  range.stop = offset + size;
+
+  GST_OBJECT_LOCK (src);
+  /* first range ending at or after the new one starts */
+  lo = 0;
+  hi = src->ranges->len;
+  while (lo < hi) {
+    guint mid = (lo + hi) / 2;
+
+    if (g_array_index (src->ranges, GstPDPushSrcRange, mid).stop < range.start)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  /* swallow the ranges it overlaps or touches */
+  for (i = lo; i < src->ranges->len; i++) {
+    GstPDPushSrcRange *r = &g_array_index (src->ranges, GstPDPushSrcRange, i);
+
+    if (r->start > range.stop)
+      break;
+    range.start = MIN (range.start, r->start);
+    range.stop = MAX (range.stop, r->stop);
+  }
+  g_array_remove_range (src->ranges, lo, i - lo);
+  g_array_insert_val (src->ranges, lo, range);
+
+  GST_LOG_OBJECT (src, "added %" G_GUINT64_FORMAT "-%" G_GUINT64_FORMAT ", %u ranges",
+      offset, offset + size, src->ranges->len);
+  GST_OBJECT_UNLOCK (src);
+
+  /* wake up a reader waiting for it */
+  gst_pd_pushsrc_wakeup (src);
+}
+
+/* end of the data readable from offset on, size is the file size */
+static guint64
+gst_pd_pushsrc_available (GstPDPushSrc * src, guint64 offset, guint64 size)
+{
+  guint64 stop = offset;
+  guint lo, hi;
+
+  if (!src->sparse)
+    return size;
+
+  GST_OBJECT_LOCK (src);
+  /* last range starting at or before offset */
+  lo = 0;
+  hi = src->ranges->len;
+  while (lo < hi) {
+    guint mid = (lo + hi) / 2;
+
+    if (g_array_index (src->ranges, GstPDPushSrcRange, mid).start <= offset)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo > 0)
+    stop = MAX (g_array_index (src->ranges, GstPDPushSrcRange, lo - 1).stop, offset);
+  GST_OBJECT_UNLOCK (src);
+
+  return MIN (stop, size);
+}
+
+/* whether the file will not grow anymore */
+static gboolean
+gst_pd_pushsrc_download_complete (GstPDPushSrc * src, guint64 size)
+{
+  if (src->is_eos)
+    return TRUE;
+  if (src->expected_size == 0)
+    return FALSE;
+
+  return gst_pd_pushsrc_available (src, 0, size) >= src->expected_size;
+}
+
+static void
+gst_pd_pushsrc_post_buffering (GstPDPushSrc * src, gint percent)
+{
+  GstMessage *message;
+
+  if (percent == src->buffering_percent)
+    return;
+  src->buffering_percent = percent;
+
+  GST_DEBUG_OBJECT (src, "buffering %d%%", percent);
+
+  message = gst_message_new_buffering (GST_OBJECT_CAST (src), percent);
+  gst_message_set_buffering_stats (message, GST_BUFFERING_DOWNLOAD, -1, -1, -1);
+  gst_element_post_message (GST_ELEMENT_CAST (src), message);
+}
+
+/* how much of buffering-size the download is ahead of position */
+static gint
+gst_pd_pushsrc_buffering_percent (GstPDPushSrc * src, guint64 position, guint64 size)
+{
+  if (size <= position)
+    return 0;
+
+  /* 100 is only posted once buffering is over */
+  return MIN (gst_util_uint64_scale (size - position, 100, src->buffering_size), 99);
+}
+
+/* reads up to size bytes at offset into a new window, as much as the file
+ * has by now. Called from the streaming and the prefetch thread, pread ()
+ * keeps the file position alone */
+static GstBuffer *
+gst_pd_pushsrc_readahead_fill (GstPDPushSrc * src, guint64 offset, guint size)
+{
+  struct stat stat_results;
+  GstBuffer *window;
+  guint64 available;
+  gssize ret;
+
+  if (fstat (src->fd, &stat_results) < 0)
+    return NULL;
+
+  /* never cache what the writer did not fill in yet */
+  available = gst_pd_pushsrc_available (src, offset, stat_results.st_size);
+  if (offset >= available)
+    return NULL;
+
+  size = MIN (size, available - offset);
+  window = gst_buffer_try_new_and_alloc (size);
+  if (window == NULL)
+    return NULL;
+
+  ret = pread (src->fd, GST_BUFFER_DATA (window), size, offset);
+  if (ret <= 0) {
+    GST_WARNING_OBJECT (src, "pread () at %" G_GUINT64_FORMAT " failed : %s", offset,
+        ret < 0 ? g_strerror (errno) : "eof");
+    gst_buffer_unref (window);
+    return NULL;
+  }
+
+  GST_BUFFER_SIZE (window) = ret;
+  GST_BUFFER_OFFSET (window) = offset;
+  GST_LOG_OBJECT (src, "read window of %" G_GSSIZE_FORMAT " bytes at %" G_GUINT64_FORMAT, ret, offset);
+
+  return window;
+}
+
+/* with ra_lock held */
+static GstBuffer *
+gst_pd_pushsrc_readahead_lookup (GstPDPushSrc * src, guint64 offset, guint length)
+{
+  guint i;
+
+  for (i = 0; i < PD_PUSHSRC_RA_WINDOWS; i++) {
+    GstBuffer *window = src->ra_ring[i];
+
+    if (window && GST_BUFFER_OFFSET (window) <= offset &&
+        offset + length <= GST_BUFFER_OFFSET (window) + GST_BUFFER_SIZE (window))
+      return window;
+  }
+
+  return NULL;
+}
+
+/* with ra_lock held, takes the window */
+static void
+gst_pd_pushsrc_readahead_insert (GstPDPushSrc * src, GstBuffer * window)
+{
+  if (src->ra_ring[src->ra_next_slot])
+    gst_buffer_unref (src->ra_ring[src->ra_next_slot]);
+  src->ra_ring[src->ra_next_slot] = window;
+  src->ra_next_slot = (src->ra_next_slot + 1) % PD_PUSHSRC_RA_WINDOWS;
+}
+
+static gpointer
+gst_pd_pushsrc_readahead_thread (gpointer data)
+{
+  GstPDPushSrc *src = GST_PD_PUSHSRC_CAST (data);
+
+  g_mutex_lock (src->ra_lock);
+  while (src->ra_running) {
+    guint64 offset = src->ra_request;
+    GstBuffer *window;
+
+    if (offset == PD_PUSHSRC_RA_NONE) {
+      g_cond_wait (src->ra_cond, src->ra_lock);
+      continue;
+    }
+
+    src->ra_request = PD_PUSHSRC_RA_NONE;
+    src->ra_inflight = offset;
+    g_mutex_unlock (src->ra_lock);
+
+    window = gst_pd_pushsrc_readahead_fill (src, offset, src->readahead_size);
+
+    g_mutex_lock (src->ra_lock);
+    if (window)
+      gst_pd_pushsrc_readahead_insert (src, window);
+    src->ra_inflight = PD_PUSHSRC_RA_NONE;
+    g_cond_broadcast (src->ra_cond);
+  }
+  g_mutex_unlock (src->ra_lock);
+
+  return NULL;
+}
+
+static void
+gst_pd_pushsrc_readahead_start (GstPDPushSrc * src)
+{
+  GError *error = NULL;
+
+  if (src->readahead_size == 0 || !src->is_regular)
+    return;
+
+  src->ra_ring = g_new0 (GstBuffer *, PD_PUSHSRC_RA_WINDOWS);
+  src->ra_next_slot = 0;
+  src->ra_next_offset = 0;
+  src->ra_sequential = 0;
+  src->ra_request = PD_PUSHSRC_RA_NONE;
+  src->ra_inflight = PD_PUSHSRC_RA_NONE;
+  src->ra_hits = src->ra_misses = 0;
+  src->ra_running = TRUE;
+
+  src->ra_thread = g_thread_create (gst_pd_pushsrc_readahead_thread, src, TRUE, &error);
+  if (src->ra_thread == NULL) {
+    GST_WARNING_OBJECT (src, "could not start prefetch thread : %s", error->message);
+    g_error_free (error);
+    src->ra_running = FALSE;
+  }
+}
+
+static void
+gst_pd_pushsrc_readahead_stop (GstPDPushSrc * src)
+{
+  guint i;
+
+  if (src->ra_ring == NULL)
+    return;
+
+  if (src->ra_thread) {
+    g_mutex_lock (src->ra_lock);
+    src->ra_running = FALSE;
+    g_cond_broadcast (src->ra_cond);
+    g_mutex_unlock (src->ra_lock);
+    g_thread_join (src->ra_thread);
+    src->ra_thread = NULL;
+  }
+
+  GST_INFO_OBJECT (src, "read-ahead served %u reads from cache, read %u windows on demand",
+      src->ra_hits, src->ra_misses);
+
+  for (i = 0; i < PD_PUSHSRC_RA_WINDOWS; i++) {
+    if (src->ra_ring[i])
+      gst_buffer_unref (src->ra_ring[i]);
+  }
+  g_free (src->ra_ring);
+  src->ra_ring = NULL;
+}
+
+/* serves the read from a cached window, reading one on a miss. Sequential
+ * reads get the window after the current one prefetched once they are past
+ * its middle, so they should not wait on storage. Seeking reads, like a
+ * demuxer going between the index and the data, are served by the windows
+ * kept around; they read smaller windows as most of a big one would go
+ * unused. GST_FLOW_NOT_SUPPORTED means the caller has to read () */
+static GstFlowReturn
+gst_pd_pushsrc_readahead_create (GstPDPushSrc * src, guint64 offset, guint length, GstBuffer ** buffer)
+{
+  GstBuffer *window, *buf;
+  gboolean sequential = (offset == src->ra_next_offset);
+  guint64 next = PD_PUSHSRC_RA_NONE;
+
+  src->ra_sequential = sequential ? src->ra_sequential + 1 : 0;
+  src->ra_next_offset = offset + length;
+
+  g_mutex_lock (src->ra_lock);
+  /* the prefetch thread is about to have it */
+  while ((window = gst_pd_pushsrc_readahead_lookup (src, offset, length)) == NULL &&
+      src->ra_inflight <= offset && offset < src->ra_inflight + src->readahead_size)
+    g_cond_wait (src->ra_cond, src->ra_lock);
+  if (window) {
+    gst_buffer_ref (window);
+    src->ra_hits++;
+  }
+  g_mutex_unlock (src->ra_lock);
+
+  if (window == NULL) {
+    guint size = sequential ? src->readahead_size : src->readahead_size / 4;
+
+    window = gst_pd_pushsrc_readahead_fill (src, offset, MAX (size, length));
+    if (window == NULL || GST_BUFFER_SIZE (window) < length) {
+      if (window)
+        gst_buffer_unref (window);
+      return GST_FLOW_NOT_SUPPORTED;
+    }
+
+    g_mutex_lock (src->ra_lock);
+    gst_pd_pushsrc_readahead_insert (src, gst_buffer_ref (window));
+    src->ra_misses++;
+    g_mutex_unlock (src->ra_lock);
+  }
+
+  buf = gst_buffer_create_sub (window, offset - GST_BUFFER_OFFSET (window), length);
+  GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_READONLY);
+  GST_BUFFER_OFFSET (buf) = offset;
+  GST_BUFFER_OFFSET_END (buf) = offset + length;
+
+  if (src->ra_sequential > 0 && src->ra_running &&
+      offset + length > GST_BUFFER_OFFSET (window) + GST_BUFFER_SIZE (window) / 2) {
+    g_mutex_lock (src->ra_lock);
+    next = GST_BUFFER_OFFSET (window) + GST_BUFFER_SIZE (window);
+    if (gst_pd_pushsrc_readahead_lookup (src, next, 1) || src->ra_inflight == next ||
+        src->ra_request == next) {
+      next = PD_PUSHSRC_RA_NONE;
+    } else {
+      src->ra_request = next;
+      g_cond_broadcast (src->ra_cond);
+    }
+    g_mutex_unlock (src->ra_lock);
+  }
+
+#ifdef HAVE_POSIX_FADVISE
+  /* have the kernel start on it before the prefetch thread gets to run */
+  if (next != PD_PUSHSRC_RA_NONE)
+    posix_fadvise (src->fd, next, src->readahead_size, POSIX_FADV_WILLNEED);
+#endif
+
+  gst_buffer_unref (window);
+  *buffer = buf;
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_pd_pushsrc_create_read (GstBaseSrc * basesrc, guint64 offset, guint length, GstBuffer ** buffer)
 {
   GST_LOG ("IN");
 
   int ret;
-  GstBuffer *buf;
+  GstBuffer *buf = NULL;
   struct stat stat_results;
+  guint64 available;
   GstPDPushSrc *src;
 
   src = GST_PD_PUSHSRC_CAST (basesrc);
@@ -344,54 +1173,106 @@ gst_pd_pushsrc_create_read (GstBaseSrc * basesrc, guint64 offset, guint length,
 
   GST_LOG_OBJECT (src, "offset + length = %"G_GUINT64_FORMAT " and filesize = %"G_GUINT64_FORMAT, offset + length, stat_results.st_size);
 
-  while ((offset + length) > stat_results.st_size)
+  available = gst_pd_pushsrc_available (src, offset, stat_results.st_size);
+
+  while ((offset + length) > available)
   {
-    fd_set fds;
-    int ret;
-    struct timeval timeout = {0,};
-    guint64 avail_size = 0;
+    GstFlowReturn wait_ret;
 
-    if (src->is_eos)
+    if (gst_pd_pushsrc_download_complete (src, stat_results.st_size))
   	goto eos;
 
-    FD_ZERO (&fds);
-    FD_SET (src->fd, &fds);
+    if (src->buffering_size > 0) {
+      src->buffering = TRUE;
+      gst_pd_pushsrc_post_buffering (src, gst_pd_pushsrc_buffering_percent (src, offset + length, available));
+    }
 
-    timeout.tv_sec = 0;
-    timeout.tv_usec = ((basesrc->blocksize * 8 * 1000) / 64000); // wait_time = (blocksize * 8) / (min downloadratei.e. 64Kbps)
+    wait_ret = gst_pd_pushsrc_wait_data (src, basesrc->blocksize);
+    if (wait_ret != GST_FLOW_OK)
+      return wait_ret;
 
-    GST_DEBUG_OBJECT (src, "Going to wait for %ld msec", timeout.tv_usec);
+    memset (&stat_results, 0, sizeof (stat_results));
+
+    if (fstat (src->fd, &stat_results) < 0)
+      goto could_not_stat;
+
+    available = gst_pd_pushsrc_available (src, offset, stat_results.st_size);
+
+    GST_LOG_OBJECT (src, "Available data size in file = %"G_GUINT64_FORMAT ", from offset up to %"G_GUINT64_FORMAT,
+        (guint64) stat_results.st_size, available);
+  }
+
+  /* after a stall, let the download get ahead again before going on so that
+   * the player can pause once instead of stuttering on every block */
+  if (src->buffering) {
+    while (available - (offset + length) < src->buffering_size &&
+        !gst_pd_pushsrc_download_complete (src, stat_results.st_size)) {
+      GstFlowReturn wait_ret;
+
+      gst_pd_pushsrc_post_buffering (src, gst_pd_pushsrc_buffering_percent (src, offset + length, available));
+
+      wait_ret = gst_pd_pushsrc_wait_data (src, basesrc->blocksize);
+      if (wait_ret != GST_FLOW_OK)
+        return wait_ret;
 
-    ret = select (src->fd + 1, &fds, NULL, NULL, &timeout);
-    if (-1 == ret) 
-    {
-      GST_ERROR_OBJECT (src, "ERROR in select () : reason - %s...\n", strerror(errno));
-      return GST_FLOW_ERROR;
-    }
-    else if (0 == ret)
-    {
-      GST_WARNING_OBJECT (src, "select () timeout happened...");
-    }
-    else
-    {
-      memset (&stat_results, 0, sizeof (stat_results));
-  
       if (fstat (src->fd, &stat_results) < 0)
         goto could_not_stat;
 
-      avail_size = stat_results.st_size;
+      available = gst_pd_pushsrc_available (src, offset, stat_results.st_size);
+    }
+
+    src->buffering = FALSE;
+    gst_pd_pushsrc_post_buffering (src, 100);
+  }
+
+#ifdef HAVE_SYS_MMAN_H
+  if (src->can_mmap && length > 0) {
+    GstFlowReturn mmap_ret = gst_pd_pushsrc_create_mmap (src, offset, length, buffer);
+
+    if (mmap_ret != GST_FLOW_NOT_SUPPORTED) {
+      GST_LOG ("OUT");
+      return mmap_ret;
+    }
+  }
+#endif
+
+  if (src->ra_ring && length > 0) {
+    GstFlowReturn ra_ret = gst_pd_pushsrc_readahead_create (src, offset, length, buffer);
+
+    if (ra_ret != GST_FLOW_NOT_SUPPORTED) {
+      GST_LOG ("OUT");
+      return ra_ret;
+    }
+  }
+
+  if (src->io && length > 0) {
+    guint i;
+
+    GST_LOG_OBJECT (src, "Reading %d bytes at offset 0x%" G_GINT64_MODIFIER "x with %s",
+        length, offset, gst_file_io_get_backend (src->io));
+    ret = gst_file_io_read (src->io, offset, length, &buf);
+    if (G_UNLIKELY (ret < 0))
+      goto could_not_read;
+
+    if (G_UNLIKELY ((guint) ret < length && src->seekable))
+      goto unexpected_eos;
+
+    if (G_UNLIKELY (ret == 0))
+      goto eos;
 
-      GST_LOG_OBJECT (src, "Available data size in file = %"G_GUINT64_FORMAT, avail_size);
+    /* get the next blocks going while this one is processed, as far as
+     * they were downloaded */
+    for (i = 1; i <= PD_PUSHSRC_ASYNC_DEPTH; i++) {
+      guint64 next = offset + (guint64) i * length;
 
-      if ((offset + length) > avail_size)
-      {
-        GST_LOG_OBJECT (src, "Enough data is NOT available...");
-      }
-      else
-      {
-        GST_LOG_OBJECT (src, "Enough data is available...");
-      }
+      if (next + length > available || !gst_file_io_prefetch (src->io, next, length))
+        break;
     }
+
+    *buffer = buf;
+    GST_LOG ("OUT");
+
+    return GST_FLOW_OK;
   }
 
   if (G_UNLIKELY (src->read_position != offset)) {
@@ -455,7 +1336,8 @@ could_not_read:
   {
     GST_ERROR_OBJECT (src, "Could not read...");
     GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL), GST_ERROR_SYSTEM);
-    gst_buffer_unref (buf);
+    if (buf)
+      gst_buffer_unref (buf);
     return GST_FLOW_ERROR;
   }
 unexpected_eos:
@@ -469,7 +1351,8 @@ unexpected_eos:
 eos:
   {
     GST_ERROR_OBJECT (src, "non-regular file hits EOS");
-    gst_buffer_unref (buf);
+    if (buf)
+      gst_buffer_unref (buf);
     return GST_FLOW_UNEXPECTED;
   }
 }
@@ -561,6 +1444,10 @@ gst_pd_pushsrc_get_size (GstBaseSrc * basesrc, guint64 * size)
   /* Naveen : Intentionally, doing this because we dont know the file size...because its keep on increasing in PD case */
   *size = G_MAXUINT64;
 
+  /* unless the application told us */
+  if (src->expected_size > 0)
+    *size = src->expected_size;
+
   GST_DEBUG ("size of the file = %"G_GUINT64_FORMAT, *size);
   
   GST_LOG ("OUT");
@@ -606,6 +1493,8 @@ gst_pd_pushsrc_start (GstBaseSrc * basesrc)
     goto was_socket;
 
   src->read_position = 0;
+  src->buffering = FALSE;
+  src->buffering_percent = -1;
 
   /* record if it's a regular (hence seekable and lengthable) file */
   if (S_ISREG (stat_results.st_mode))
@@ -628,6 +1517,24 @@ gst_pd_pushsrc_start (GstBaseSrc * basesrc)
   /* We can only really do seeking on regular files - for other file types, we
    * don't know their length, so seeking isn't useful/meaningful */
   src->seekable = src->seekable && src->is_regular;
+
+#ifdef HAVE_SYS_MMAN_H
+  src->can_mmap = src->use_mmap && src->is_regular;
+#else
+  if (src->use_mmap)
+    GST_WARNING_OBJECT (src, "mmap is not supported, reading the file");
+#endif
+
+  if (!src->can_mmap && src->async_io && src->is_regular) {
+    src->io = gst_file_io_new (src->fd, PD_PUSHSRC_ASYNC_DEPTH);
+    if (src->io == NULL)
+      GST_WARNING_OBJECT (src, "async I/O not available, reading in create ()");
+  }
+
+  if (!src->can_mmap && src->io == NULL)
+    gst_pd_pushsrc_readahead_start (src);
+
+  gst_pd_pushsrc_watch_start (src);
   GST_LOG ("OUT");
 
   return TRUE;
@@ -690,6 +1597,22 @@ gst_pd_pushsrc_stop (GstBaseSrc * basesrc)
 
   GstPDPushSrc *src = GST_PD_PUSHSRC (basesrc);
 
+  gst_pd_pushsrc_watch_stop (src);
+
+  /* buffers still out keep their window mapped */
+  if (src->mapping) {
+    gst_buffer_unref (src->mapping);
+    src->mapping = NULL;
+  }
+  src->can_mmap = FALSE;
+
+  gst_pd_pushsrc_readahead_stop (src);
+
+  if (src->io) {
+    gst_file_io_free (src->io);
+    src->io = NULL;
+  }
+
   /* close the file */
   close (src->fd);
 
@@ -702,6 +1625,33 @@ gst_pd_pushsrc_stop (GstBaseSrc * basesrc)
   return TRUE;
 }
 
+/* makes a reader waiting for more data return, for flushing & state changes */
+static gboolean
+gst_pd_pushsrc_unlock (GstBaseSrc * basesrc)
+{
+  GST_LOG ("IN");
+
+  GstPDPushSrc *src = GST_PD_PUSHSRC (basesrc);
+
+  gst_poll_set_flushing (src->poll, TRUE);
+  GST_LOG ("OUT");
+
+  return TRUE;
+}
+
+static gboolean
+gst_pd_pushsrc_unlock_stop (GstBaseSrc * basesrc)
+{
+  GST_LOG ("IN");
+
+  GstPDPushSrc *src = GST_PD_PUSHSRC (basesrc);
+
+  gst_poll_set_flushing (src->poll, FALSE);
+  GST_LOG ("OUT");
+
+  return TRUE;
+}
+
 /*** GSTURIHANDLER INTERFACE *************************************************/
 
 static GstURIType
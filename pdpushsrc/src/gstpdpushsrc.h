@@ -27,6 +27,7 @@
 #include <sys/types.h>
 #include <gst/gst.h>
 #include <gst/base/gstbasesrc.h>
+#include "gstfileio.h"
 
 G_BEGIN_DECLS
 
@@ -41,6 +42,12 @@ G_BEGIN_DECLS
 typedef struct _GstPDPushSrc GstPDPushSrc;
 typedef struct _GstPDPushSrcClass GstPDPushSrcClass;
 
+typedef struct
+{
+  guint64 start;
+  guint64 stop;                         /* exclusive */
+} GstPDPushSrcRange;
+
 /**
  * GstFileSrc:
  *
@@ -59,11 +66,53 @@ struct _GstPDPushSrc {
   gboolean is_regular;                  /* whether it's a (symlink to a)                                          regular file */
 
   gboolean is_eos;
+  guint64 expected_size;                /* size of the complete download, 0 if unknown */
+
+  guint buffering_size;                 /* bytes ahead of the reader to prebuffer after a stall */
+  gboolean buffering;                   /* stalled, posting buffering messages */
+  gint buffering_percent;               /* last percentage posted */
+
+  gboolean sparse;                      /* data is where add-range said, not up to the file size */
+  GArray *ranges;                       /* GstPDPushSrcRange, sorted and disjoint */
+
+  GstPoll *poll;                        /* waits for the file to grow, flushing on unlock */
+  GstPollFD pollfd;                     /* inotify fd, -1 when polling the file size */
+  gint watch;                           /* inotify watch of the file */
+  gboolean use_inotify;                 /* FALSE forces polling the file size */
+  GstPollFD wakeupfd;                   /* read end of the wakeup pipe, -1 without one */
+  gint wakeup_write;                    /* write end, a byte wakes the reader up */
+
+  gboolean use_mmap;                    /* hand out windows of a mapping instead of reading */
+  gboolean can_mmap;                    /* use_mmap and the file could be mapped */
+  GstBuffer *mapping;                   /* current window, OFFSET is its file offset */
+
+  /* read-ahead, copy mode only */
+  guint readahead_size;                 /* window size, 0 disables read-ahead */
+  GstBuffer **ra_ring;                  /* cached windows, OFFSET is their file offset */
+  guint ra_next_slot;                   /* slot replaced next */
+  guint64 ra_next_offset;               /* where a sequential read would go on */
+  guint ra_sequential;                  /* sequential reads in a row */
+  guint64 ra_request;                   /* window the prefetch thread has to read */
+  guint64 ra_inflight;                  /* window the prefetch thread is reading */
+  gboolean ra_running;
+  GThread *ra_thread;
+  GMutex *ra_lock;
+  GCond *ra_cond;
+  guint ra_hits;
+  guint ra_misses;
+
+  gboolean async_io;                    /* keep reads in flight instead of reading in create () */
+  GstFileIO *io;
 
 };
 
 struct _GstPDPushSrcClass {
   GstBaseSrcClass parent_class;
+
+  /* actions */
+  /* the range has to be written to the file before it is added, it can be
+   * read right away */
+  void (*add_range) (GstPDPushSrc * src, guint64 offset, guint64 size);
 };
 
 GType gst_pd_pushsrc_get_type (void);
@@ -0,0 +1,689 @@
+/*
+ * pdpushsrc-bench: times the file sources, pdpushsrc reading a file while it
+ * is written & pdpushsrc or drmsrc (--element) reading a complete one
+ *
+ * <element> ! fakesink, the bench being the writer of a temporary file. The
+ * modes are
+ *
+ *   stall : CPU used & wakeups while the reader waits at the end of the data,
+ *           over --stall seconds, pdpushsrc only
+ *   wake  : from the writer publishing a block to the block reaching the sink,
+ *           over --iterations blocks, through add-range (sparse mode), and
+ *           from setting eos to the EOS message, pdpushsrc only
+ *   append: from the writer appending a block to the block reaching the sink,
+ *           over --iterations blocks, woken up by inotify then with
+ *           use-inotify off (polling the file size), pdpushsrc only
+ *   mmap  : throughput & CPU reading a --size MB file in copy mode, then with
+ *           use-mmap, the file being in the page cache for both
+ *   async : time between buffers (the create () latency) reading the same
+ *           file out of the page cache with async-io off then on, while
+ *           --load threads read random MBs of it
+ *
+ *   pdpushsrc-bench --iterations=200 stall wake append
+ *   pdpushsrc-bench --element=drmsrc --size=4096 mmap
+ *   pdpushsrc-bench --load=4 async
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#define BENCH_BLOCK_SIZE 4096
+/* time given to the reader to go back waiting before publishing a block */
+#define BENCH_SETTLE (20 * G_USEC_PER_SEC / 1000)
+#define BENCH_TIMEOUT (5 * GST_SECOND)
+
+static gint n_iterations = 200;
+static gint stall_time = 5;
+static gchar *element_name = "pdpushsrc";
+static gint file_size = 1024;
+static gint read_size = 65536;
+static gint n_load_threads = 2;
+
+static GOptionEntry entries[] = {
+  {"iterations", 'i', 0, G_OPTION_ARG_INT, &n_iterations, "Blocks published in the wake & append modes", "N"},
+  {"stall", 's', 0, G_OPTION_ARG_INT, &stall_time, "Seconds stalled in the stall mode", "S"},
+  {"element", 'e', 0, G_OPTION_ARG_STRING, &element_name, "pdpushsrc or drmsrc, for the read modes", "NAME"},
+  {"size", 'm', 0, G_OPTION_ARG_INT, &file_size, "MB of file for the read modes", "MB"},
+  {"blocksize", 'b', 0, G_OPTION_ARG_INT, &read_size, "Bytes per buffer in the read modes", "N"},
+  {"load", 'l', 0, G_OPTION_ARG_INT, &n_load_threads, "Threads reading concurrently in the async mode", "N"},
+  {NULL}
+};
+
+/* the file of the read modes, written once */
+static gchar *big_file = NULL;
+
+typedef struct
+{
+  gdouble seconds;
+  gdouble cpu;                  /* s */
+  guint64 bytes;
+  GArray *intervals;            /* us between buffers, gdouble */
+  GstClockTime last;
+} BenchRun;
+
+typedef struct
+{
+  GstElement *pipeline;
+  GstElement *src;
+  gchar *location;
+  gint fd;
+
+  GMutex *lock;
+  GCond *cond;
+  guint64 bytes;                /* reached the sink */
+  GstClockTime last;            /* when the last buffer reached the sink */
+} Bench;
+
+static void
+bench_handoff (GstElement *sink, GstBuffer *buf, GstPad *pad, Bench *bench)
+{
+  g_mutex_lock (bench->lock);
+  bench->bytes += GST_BUFFER_SIZE (buf);
+  bench->last = gst_util_get_timestamp ();
+  g_cond_broadcast (bench->cond);
+  g_mutex_unlock (bench->lock);
+}
+
+static gboolean
+bench_write_block (Bench *bench)
+{
+  guint8 block[BENCH_BLOCK_SIZE];
+
+  memset (block, 0x5a, sizeof (block));
+  return write (bench->fd, block, sizeof (block)) == sizeof (block);
+}
+
+/* pdpushsrc on a new temporary file holding one block, playing */
+static Bench *
+bench_new (const gchar *first_prop, ...)
+{
+  Bench *bench = g_new0 (Bench, 1);
+  GstElement *sink = NULL;
+  GError *error = NULL;
+  va_list args;
+
+  bench->fd = g_file_open_tmp ("pdpushsrc-bench-XXXXXX", &bench->location, &error);
+  if (bench->fd < 0) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    g_free (bench);
+    return NULL;
+  }
+  bench_write_block (bench);
+
+  bench->lock = g_mutex_new ();
+  bench->cond = g_cond_new ();
+
+  bench->pipeline = gst_pipeline_new ("bench");
+  bench->src = gst_element_factory_make ("pdpushsrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  if (!bench->src || !sink) {
+    g_printerr ("pdpushsrc or fakesink missing, check GST_PLUGIN_PATH\n");
+    exit (1);
+  }
+
+  g_object_set (bench->src, "location", bench->location, "blocksize", (gulong) BENCH_BLOCK_SIZE, NULL);
+  va_start (args, first_prop);
+  g_object_set_valist (G_OBJECT (bench->src), first_prop, args);
+  va_end (args);
+  g_object_set (sink, "sync", FALSE, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (bench_handoff), bench);
+
+  gst_bin_add_many (GST_BIN (bench->pipeline), bench->src, sink, NULL);
+  gst_element_link (bench->src, sink);
+  gst_element_set_state (bench->pipeline, GST_STATE_PLAYING);
+
+  return bench;
+}
+
+static void
+bench_free (Bench *bench)
+{
+  gst_element_set_state (bench->pipeline, GST_STATE_NULL);
+  gst_object_unref (bench->pipeline);
+  close (bench->fd);
+  g_unlink (bench->location);
+  g_free (bench->location);
+  g_mutex_free (bench->lock);
+  g_cond_free (bench->cond);
+  g_free (bench);
+}
+
+/* time the sink got @bytes at, GST_CLOCK_TIME_NONE after BENCH_TIMEOUT */
+static GstClockTime
+bench_wait_bytes (Bench *bench, guint64 bytes)
+{
+  GstClockTime last = GST_CLOCK_TIME_NONE;
+  GTimeVal deadline;
+
+  g_get_current_time (&deadline);
+  g_time_val_add (&deadline, BENCH_TIMEOUT / GST_USECOND);
+
+  g_mutex_lock (bench->lock);
+  while (bench->bytes < bytes)
+    if (!g_cond_timed_wait (bench->cond, bench->lock, &deadline))
+      break;
+  if (bench->bytes >= bytes)
+    last = bench->last;
+  g_mutex_unlock (bench->lock);
+
+  return last;
+}
+
+static gint
+bench_compare (gconstpointer a, gconstpointer b)
+{
+  gdouble da = *(const gdouble *) a;
+  gdouble db = *(const gdouble *) b;
+
+  return da < db ? -1 : da > db;
+}
+
+/* sorts @samples & prints their percentiles, in us */
+static void
+bench_print_latency (const gchar *what, GArray *samples)
+{
+  gdouble *v = (gdouble *) samples->data;
+  guint n = samples->len;
+
+  g_array_sort (samples, bench_compare);
+  g_print ("  %-10s p50 %8.1f us, p99 %8.1f us, max %8.1f us over %u\n", what,
+      v[n / 2], v[MIN (n - 1, n * 99 / 100)], v[n - 1], n);
+}
+
+static gdouble
+bench_cpu_time (const struct rusage *usage)
+{
+  return usage->ru_utime.tv_sec + usage->ru_utime.tv_usec / 1e6 +
+      usage->ru_stime.tv_sec + usage->ru_stime.tv_usec / 1e6;
+}
+
+/* --size MB of data in a temporary file, for the read modes */
+static const gchar *
+bench_big_file (void)
+{
+  GError *error = NULL;
+  guint8 *chunk = NULL;
+  gint fd;
+  gint i;
+
+  if (big_file)
+    return big_file;
+
+  fd = g_file_open_tmp ("pdpushsrc-bench-XXXXXX", &big_file, &error);
+  if (fd < 0) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return NULL;
+  }
+
+  /* not a hole, the pages have to be read */
+  chunk = g_malloc (1024 * 1024);
+  for (i = 0; i < 1024 * 1024; i++)
+    chunk[i] = i * 31;
+  for (i = 0; i < file_size; i++) {
+    if (write (fd, chunk, 1024 * 1024) != 1024 * 1024) {
+      g_printerr ("could not write %d MB to %s\n", file_size, big_file);
+      g_unlink (big_file);
+      g_free (big_file);
+      big_file = NULL;
+      break;
+    }
+  }
+  g_free (chunk);
+  close (fd);
+
+  return big_file;
+}
+
+static void
+bench_run_handoff (GstElement *sink, GstBuffer *buf, GstPad *pad, BenchRun *run)
+{
+  GstClockTime now = gst_util_get_timestamp ();
+
+  /* only the streaming thread touches @run till EOS */
+  if (run->intervals && GST_CLOCK_TIME_IS_VALID (run->last)) {
+    gdouble interval = (gdouble) (now - run->last) / GST_USECOND;
+
+    g_array_append_val (run->intervals, interval);
+  }
+  run->last = now;
+  run->bytes += GST_BUFFER_SIZE (buf);
+}
+
+/* reads @location to the end with --element, NULL terminated properties of
+ * the element after @run */
+static gboolean
+bench_run_file (const gchar *location, BenchRun *run, const gchar *first_prop, ...)
+{
+  GstElement *pipeline = gst_pipeline_new ("bench");
+  GstElement *src = gst_element_factory_make (element_name, NULL);
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstBus *bus = NULL;
+  GstMessage *msg = NULL;
+  GstClockTime start;
+  struct rusage before, after;
+  gboolean ret = FALSE;
+  va_list args;
+
+  if (!src || !sink) {
+    g_printerr ("%s or fakesink missing, check GST_PLUGIN_PATH\n", element_name);
+    exit (1);
+  }
+
+  g_object_set (src, "location", location, "blocksize", (gulong) read_size, NULL);
+  /* the file is complete, pdpushsrc would wait for more otherwise */
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (src), "eos"))
+    g_object_set (src, "eos", TRUE, NULL);
+  va_start (args, first_prop);
+  g_object_set_valist (G_OBJECT (src), first_prop, args);
+  va_end (args);
+  g_object_set (sink, "sync", FALSE, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (bench_run_handoff), run);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+  gst_element_link (src, sink);
+
+  run->bytes = 0;
+  run->last = GST_CLOCK_TIME_NONE;
+  bus = gst_element_get_bus (pipeline);
+
+  getrusage (RUSAGE_SELF, &before);
+  start = gst_util_get_timestamp ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  run->seconds = (gdouble) (gst_util_get_timestamp () - start) / GST_SECOND;
+  getrusage (RUSAGE_SELF, &after);
+  run->cpu = bench_cpu_time (&after) - bench_cpu_time (&before);
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    GError *error = NULL;
+
+    gst_message_parse_error (msg, &error, NULL);
+    g_printerr ("%s : %s\n", element_name, error->message);
+    g_error_free (error);
+  } else {
+    ret = TRUE;
+  }
+
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return ret;
+}
+
+static void
+bench_print_run (const gchar *what, BenchRun *run)
+{
+  gdouble mb = (gdouble) run->bytes / (1024 * 1024);
+
+  g_print ("  %-10s %8.0f MB/s, %6.2f s CPU, %6.2f ms CPU per 100 MB\n", what,
+      mb / run->seconds, run->cpu, run->cpu * 1e3 * 100 / mb);
+}
+
+static gboolean
+bench_mmap (void)
+{
+  const gchar *location = bench_big_file ();
+  BenchRun copy = { 0, }, map = { 0, };
+
+  if (!location)
+    return FALSE;
+
+  g_print ("mmap  : %s, %d MB in %d bytes buffers, page cache warm\n", element_name,
+      file_size, read_size);
+
+  /* once to get the file in the page cache */
+  if (!bench_run_file (location, &copy, "use-mmap", FALSE, NULL) ||
+      !bench_run_file (location, &copy, "use-mmap", FALSE, NULL) ||
+      !bench_run_file (location, &map, "use-mmap", TRUE, NULL))
+    return FALSE;
+
+  if (copy.bytes != (guint64) file_size * 1024 * 1024 || map.bytes != copy.bytes) {
+    g_printerr ("mmap : read %" G_GUINT64_FORMAT " bytes copying, %" G_GUINT64_FORMAT
+        " mapping, expected %d MB\n", copy.bytes, map.bytes, file_size);
+    return FALSE;
+  }
+
+  bench_print_run ("copy", &copy);
+  bench_print_run ("mmap", &map);
+
+  return TRUE;
+}
+
+typedef struct
+{
+  const gchar *location;
+  volatile gint stop;
+  GThread *threads[64];
+} BenchLoad;
+
+/* drops the file from the page cache, the reads have to go to storage */
+static void
+bench_drop_cache (const gchar *location, guint64 offset, guint64 size)
+{
+#ifdef POSIX_FADV_DONTNEED
+  gint fd = open (location, O_RDONLY);
+
+  if (fd < 0)
+    return;
+  posix_fadvise (fd, offset, size, POSIX_FADV_DONTNEED);
+  close (fd);
+#endif
+}
+
+static gpointer
+bench_load_thread (gpointer data)
+{
+  BenchLoad *load = data;
+  guint8 *chunk = g_malloc (1024 * 1024);
+  GRand *rand = g_rand_new ();
+  gint fd = open (load->location, O_RDONLY);
+
+  while (fd >= 0 && !g_atomic_int_get (&load->stop)) {
+    guint64 offset = (guint64) g_rand_int_range (rand, 0, file_size) * 1024 * 1024;
+
+    if (pread (fd, chunk, 1024 * 1024, offset) < 0)
+      break;
+#ifdef POSIX_FADV_DONTNEED
+    /* read again from storage next time */
+    posix_fadvise (fd, offset, 1024 * 1024, POSIX_FADV_DONTNEED);
+#endif
+  }
+
+  if (fd >= 0)
+    close (fd);
+  g_rand_free (rand);
+  g_free (chunk);
+
+  return NULL;
+}
+
+static gboolean
+bench_async (void)
+{
+  const gchar *location = bench_big_file ();
+  BenchLoad load;
+  gint async_io;
+  gint i;
+
+  if (!location)
+    return FALSE;
+
+  g_print ("async : %s, %d MB in %d bytes buffers out of the page cache, %d load threads\n",
+      element_name, file_size, read_size, n_load_threads);
+
+  for (async_io = FALSE; async_io <= TRUE; async_io++) {
+    BenchRun run = { 0, };
+    gboolean ok;
+
+    run.intervals = g_array_new (FALSE, FALSE, sizeof (gdouble));
+    bench_drop_cache (location, 0, 0);
+
+    memset (&load, 0, sizeof (load));
+    load.location = location;
+    for (i = 0; i < n_load_threads; i++)
+      load.threads[i] = g_thread_create (bench_load_thread, &load, TRUE, NULL);
+
+    ok = bench_run_file (location, &run, "async-io", async_io, NULL);
+
+    g_atomic_int_set (&load.stop, 1);
+    for (i = 0; i < n_load_threads; i++)
+      if (load.threads[i])
+        g_thread_join (load.threads[i]);
+
+    if (!ok || run.intervals->len == 0) {
+      g_array_free (run.intervals, TRUE);
+      return FALSE;
+    }
+
+    bench_print_latency (async_io ? "async-io" : "sync", run.intervals);
+    bench_print_run ("", &run);
+    g_array_free (run.intervals, TRUE);
+  }
+
+  return TRUE;
+}
+
+static gboolean
+bench_stall (void)
+{
+  Bench *bench = bench_new ("eos", FALSE, NULL);
+  struct rusage before, after;
+  gdouble cpu;
+
+  if (!bench)
+    return FALSE;
+
+  if (!GST_CLOCK_TIME_IS_VALID (bench_wait_bytes (bench, BENCH_BLOCK_SIZE))) {
+    g_printerr ("stall : the first block never reached the sink\n");
+    bench_free (bench);
+    return FALSE;
+  }
+
+  /* the reader is now waiting for a second block that never comes */
+  g_usleep (BENCH_SETTLE);
+  getrusage (RUSAGE_SELF, &before);
+  g_usleep (stall_time * G_USEC_PER_SEC);
+  getrusage (RUSAGE_SELF, &after);
+
+  cpu = (bench_cpu_time (&after) - bench_cpu_time (&before)) * 1e3;
+
+  g_print ("stall : %d s waiting at the end of the data, %.2f ms CPU/s, %.1f wakeups/s "
+      "(voluntary context switches)\n", stall_time, cpu / stall_time,
+      (gdouble) (after.ru_nvcsw - before.ru_nvcsw) / stall_time);
+
+  bench_free (bench);
+
+  return TRUE;
+}
+
+static gboolean
+bench_wake (void)
+{
+  Bench *bench = bench_new ("sparse", TRUE, NULL);
+  GArray *samples = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  GstBus *bus = NULL;
+  GstMessage *msg = NULL;
+  GstClockTime start;
+  gboolean ret = FALSE;
+  gdouble latency;
+  gint i;
+
+  if (!bench)
+    return FALSE;
+
+  g_print ("wake  : %d blocks of %d bytes\n", n_iterations, BENCH_BLOCK_SIZE);
+
+  /* the first block, the reader waits on the second one after it */
+  g_signal_emit_by_name (bench->src, "add-range", (guint64) 0, (guint64) BENCH_BLOCK_SIZE);
+  if (!GST_CLOCK_TIME_IS_VALID (bench_wait_bytes (bench, BENCH_BLOCK_SIZE))) {
+    g_printerr ("wake : the first block never reached the sink\n");
+    goto done;
+  }
+
+  for (i = 1; i <= n_iterations; i++) {
+    GstClockTime last;
+
+    /* written but not published, inotify wakes the reader that goes back
+     * waiting for the range */
+    bench_write_block (bench);
+    g_usleep (BENCH_SETTLE);
+
+    start = gst_util_get_timestamp ();
+    g_signal_emit_by_name (bench->src, "add-range", (guint64) i * BENCH_BLOCK_SIZE,
+        (guint64) BENCH_BLOCK_SIZE);
+    last = bench_wait_bytes (bench, (guint64) (i + 1) * BENCH_BLOCK_SIZE);
+    if (!GST_CLOCK_TIME_IS_VALID (last)) {
+      g_printerr ("wake : block %d never reached the sink\n", i);
+      goto done;
+    }
+    latency = (gdouble) (last - start) / GST_USECOND;
+    g_array_append_val (samples, latency);
+  }
+  bench_print_latency ("add-range", samples);
+
+  /* the reader is waiting for a block past the end */
+  g_usleep (BENCH_SETTLE);
+  bus = gst_element_get_bus (bench->pipeline);
+  start = gst_util_get_timestamp ();
+  g_object_set (bench->src, "eos", TRUE, NULL);
+  msg = gst_bus_timed_pop_filtered (bus, BENCH_TIMEOUT, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (!msg || GST_MESSAGE_TYPE (msg) != GST_MESSAGE_EOS) {
+    g_printerr ("wake : no EOS after setting eos\n");
+    goto done;
+  }
+  g_print ("  %-10s %8.1f us\n", "eos", (gdouble) (gst_util_get_timestamp () - start) / GST_USECOND);
+  ret = TRUE;
+
+done:
+  if (msg)
+    gst_message_unref (msg);
+  if (bus)
+    gst_object_unref (bus);
+  g_array_free (samples, TRUE);
+  bench_free (bench);
+
+  return ret;
+}
+
+/* appends --iterations blocks, the reader waiting at the end of the file
+ * before each of them */
+static gboolean
+bench_append_run (gboolean use_inotify, GArray *samples)
+{
+  Bench *bench = bench_new ("use-inotify", use_inotify, NULL);
+  gint i;
+
+  if (!bench)
+    return FALSE;
+
+  if (!GST_CLOCK_TIME_IS_VALID (bench_wait_bytes (bench, BENCH_BLOCK_SIZE))) {
+    g_printerr ("append : the first block never reached the sink\n");
+    bench_free (bench);
+    return FALSE;
+  }
+
+  for (i = 1; i <= n_iterations; i++) {
+    GstClockTime start, last;
+    gdouble latency;
+
+    g_usleep (BENCH_SETTLE);
+    start = gst_util_get_timestamp ();
+    bench_write_block (bench);
+    last = bench_wait_bytes (bench, (guint64) (i + 1) * BENCH_BLOCK_SIZE);
+    if (!GST_CLOCK_TIME_IS_VALID (last)) {
+      g_printerr ("append : block %d never reached the sink\n", i);
+      bench_free (bench);
+      return FALSE;
+    }
+    latency = (gdouble) (last - start) / GST_USECOND;
+    g_array_append_val (samples, latency);
+  }
+
+  bench_free (bench);
+
+  return TRUE;
+}
+
+static gboolean
+bench_append (void)
+{
+  GArray *watched = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  GArray *polled = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  gboolean ret = FALSE;
+
+  g_print ("append: %d blocks of %d bytes\n", n_iterations, BENCH_BLOCK_SIZE);
+
+  if (bench_append_run (TRUE, watched) && bench_append_run (FALSE, polled)) {
+    bench_print_latency ("inotify", watched);
+    bench_print_latency ("polling", polled);
+    ret = TRUE;
+  }
+
+  g_array_free (watched, TRUE);
+  g_array_free (polled, TRUE);
+
+  return ret;
+}
+
+static const struct
+{
+  const gchar *name;
+  gboolean (*run) (void);
+} modes[] = {
+  {"stall", bench_stall},
+  {"wake", bench_wake},
+  {"append", bench_append},
+  {"mmap", bench_mmap},
+  {"async", bench_async},
+};
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *ctx = NULL;
+  GError *error = NULL;
+  guint m;
+  gint i;
+  gint ret = 0;
+
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+
+  ctx = g_option_context_new ("[MODE...] - time pdpushsrc on a file being written, all modes by default");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (n_iterations < 1 || stall_time < 1 || file_size < 1 || read_size < 1) {
+    g_printerr ("need at least 1 iteration, 1 s of stall, 1 MB of file & 1 byte blocks\n");
+    return 1;
+  }
+  if (n_load_threads < 0 || n_load_threads > (gint) G_N_ELEMENTS (((BenchLoad *) NULL)->threads)) {
+    g_printerr ("0 to 64 load threads\n");
+    return 1;
+  }
+
+  for (i = 1; i < argc; i++) {
+    for (m = 0; m < G_N_ELEMENTS (modes); m++)
+      if (!strcmp (argv[i], modes[m].name))
+        break;
+    if (m == G_N_ELEMENTS (modes)) {
+      g_printerr ("unknown mode '%s'\n", argv[i]);
+      return 1;
+    }
+  }
+
+  for (m = 0; m < G_N_ELEMENTS (modes); m++) {
+    gboolean selected = (argc == 1);
+
+    for (i = 1; i < argc; i++)
+      selected |= !strcmp (argv[i], modes[m].name);
+
+    if (selected && !modes[m].run ()) {
+      ret = 1;
+      break;
+    }
+  }
+
+  if (big_file) {
+    g_unlink (big_file);
+    g_free (big_file);
+  }
+
+  return ret;
+}
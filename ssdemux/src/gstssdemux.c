@@ -8,6 +8,7 @@
 #define GLIB_DISABLE_DEPRECATION_WARNINGS
 
 #include <string.h>
+#include <glib/gstdio.h>
 //#include <gst/glib-compat-private.h>
 #include "gstssdemux.h"
 
@@ -18,6 +19,26 @@ enum
   PROP_ALLOW_AUDIO_ONLY,
   PROP_FRAGMENTS_CACHE,
   PROP_BITRATE_SWITCH_TOLERANCE,
+  PROP_PREFETCH_DEPTH,
+  PROP_FRAGMENT_CACHE_SIZE,
+  PROP_CACHE_HITS,
+  PROP_CACHE_MISSES,
+  PROP_CACHE_EVICTIONS,
+  PROP_ABR_POLICY,
+  PROP_RETRY_DELAY,
+  PROP_RETRY_MAX_DELAY,
+  PROP_MAX_RETRIES,
+  PROP_FRAGMENT_RETRIES,
+  PROP_FRAGMENT_RETRY_FAILURES,
+  PROP_PLACEHOLDER_LOCATION,
+  PROP_SWITCH_LATENCY,
+  PROP_FAST_START,
+  PROP_STATS,
+  PROP_STATS_INTERVAL,
+  PROP_TEXT_BATCH,
+  PROP_AUDIO_TRACK,
+  PROP_N_AUDIO_TRACKS,
+  PROP_SNAPSHOT_DIR,
   PROP_LAST
 };
 
@@ -62,6 +83,87 @@ GST_BOILERPLATE_FULL (GstSSDemux, gst_ss_demux, GstElement,
 
 #define DEFAULT_FRAGMENTS_CACHE 0
 #define DEFAULT_BITRATE_SWITCH_TOLERANCE 0.4
+#define DEFAULT_PREFETCH_DEPTH 1
+#define MAX_PREFETCH_DEPTH 32
+#define DEFAULT_FRAGMENT_CACHE_SIZE 0
+#define DEFAULT_ABR_POLICY SS_ABR_POLICY_HYBRID
+#define DEFAULT_RETRY_DELAY GST_SECOND
+#define DEFAULT_RETRY_MAX_DELAY (8 * GST_SECOND)
+#define DEFAULT_MAX_RETRIES 10
+#define DEFAULT_PLACEHOLDER_LOCATION "/opt/home/root/sound_2sec.264"
+#define DEFAULT_FILLER_FRAME_DURATION (GST_SECOND / 25)
+#define DEFAULT_FAST_START FALSE
+#define DEFAULT_STATS_INTERVAL 0
+#define DEFAULT_TEXT_BATCH 4
+#define SS_TEXT_LINK_POLL_USEC G_USEC_PER_SEC
+
+/* upper bounds of the fragment fetch latency histogram, the last bucket
+ * takes everything above */
+#define SS_LATENCY_BUCKETS 7
+static const GstClockTime ss_latency_bounds[SS_LATENCY_BUCKETS - 1] = {
+  100 * GST_MSECOND, 250 * GST_MSECOND, 500 * GST_MSECOND,
+  GST_SECOND, 2 * GST_SECOND, 4 * GST_SECOND
+};
+#define SS_MANIFEST_REFRESH_MIN_INTERVAL GST_SECOND
+#define SS_MANIFEST_DOWNLOAD_TIMEOUT (10 * GST_SECOND)
+
+#define GST_TYPE_SS_DEMUX_ABR_POLICY (gst_ss_demux_abr_policy_get_type ())
+static GType
+gst_ss_demux_abr_policy_get_type (void)
+{
+  static GType abr_policy_type = 0;
+  static const GEnumValue abr_policies[] = {
+    {SS_ABR_POLICY_THROUGHPUT, "Bandwidth estimate", "throughput"},
+    {SS_ABR_POLICY_BUFFER, "Buffer occupancy", "buffer"},
+    {SS_ABR_POLICY_HYBRID, "Bandwidth estimate guarded by buffer occupancy", "hybrid"},
+    {0, NULL, NULL},
+  };
+
+  if (!abr_policy_type)
+    abr_policy_type = g_enum_register_static ("GstSSDemuxAbrPolicy", abr_policies);
+
+  return abr_policy_type;
+}
+
+typedef struct _GstSSDemuxFetcher GstSSDemuxFetcher;
+
+/* state of a fetcher, moved forward by the download pipe through the bus
+ * sync handler & the proxy sink pad, and by the stream task */
+typedef enum
+{
+  SS_FETCHER_IDLE, /* parked in free_fetchers */
+  SS_FETCHER_FETCHING, /* download started, nothing parsed yet */
+  SS_FETCHER_PARSING, /* samples of the fragment are arriving */
+  SS_FETCHER_DRAINING, /* download finished, queued samples are left */
+  SS_FETCHER_RETRY, /* fragment not ready on the server, fetch again at retry_at */
+  SS_FETCHER_FAILED,
+} SS_FETCHER_STATE;
+
+#define SS_FETCHER_IS_BUSY(fetcher) ((fetcher)->state == SS_FETCHER_FETCHING || \
+    (fetcher)->state == SS_FETCHER_PARSING || (fetcher)->state == SS_FETCHER_RETRY)
+
+/* download pipe of one fragment in the prefetch window */
+struct _GstSSDemuxFetcher
+{
+  GstSSDemuxStream *stream;
+  guint id;
+  GstElement *pipe;
+  GstElement *urisrc;
+  GstElement *parser;
+  GstPad *sinkpad; /* proxy pad linked to the piffdemux src pad */
+  gchar *uri;
+  guint64 start_ts;
+  guint bitrate;
+  GQueue *queue; /* parsed samples waiting for their turn, protected by stream lock */
+  GList *collected; /* samples of the fragment kept for the fragment cache */
+  SS_FETCHER_STATE state; /* protected by stream lock */
+  GstClockTime retry_at;
+  guint n_retries; /* retries of the current fragment */
+  GstClockTime fetch_start;
+  guint64 download_rate;
+  gboolean got_live_param;
+  gboolean discard;
+};
 
 struct _GstSSDemuxStream
 {
@@ -72,20 +174,34 @@ struct _GstSSDemuxStream
   SS_STREAM_TYPE type;
   GstTask *stream_task;
   GStaticRecMutex stream_lock;
-  GstElement *pipe;
-  GstElement *urisrc;
-  GstElement *parser;
-  GstElement *sink;
-  GstBus *bus;
+  GstSSDemuxFetcher *fetchers;
+  guint n_fetchers;
+  GQueue *free_fetchers;
+  GQueue *inflight; /* fetchers in fragment order */
+  GstBuffer *filler_data; /* placeholder clip, loaded on the first audio-only fragment */
+  GPtrArray *filler_frames; /* access units of filler_data, sub-buffers */
+  GstCaps *filler_caps;
+  gboolean filling; /* placeholder frames are being sent instead of video */
   GMutex *lock;
   GCond *cond;
+  gboolean flushing;
+  guint track; /* StreamIndex being fetched, in manifest order */
+  GstClockTime resume_ts; /* samples before it are dropped after a track switch */
   guint frag_cnt;
+  guint64 n_retries; /* fragment download retries of this stream */
+
+  /* statistics, protected by lock */
+  guint64 bytes; /* parsed sample bytes downloaded */
+  guint latency_hist[SS_LATENCY_BUCKETS]; /* fragment fetch latency */
+  guint n_switches; /* quality level switches */
+  guint n_stalls; /* waits for a fragment being downloaded after startup */
   GQueue *queue;
-  gchar *uri;
-  guint64 start_ts;
+  guint64 queued_bytes;
+  GstClockTime queued_dur;
+  GstClockTime last_end; /* end of the last sample pushed downstream */
   gboolean sent_ns;
+  gboolean sent_first; /* time to first frame is reported */
   GstCaps *caps;
-  guint64 switch_ts;
   guint64 avg_dur;
 };
 
@@ -98,15 +214,38 @@ static GstStateChangeReturn gst_ss_demux_change_state (GstElement * element, Gst
 static void gst_ss_demux_dispose (GObject * obj);
 static GstFlowReturn gst_ss_demux_chain (GstPad * pad, GstBuffer * buf);
 static void gst_ss_demux_stream_loop (GstSSDemux * demux);
-static gboolean gst_ss_demux_download_bus_cb(GstBus *bus, GstMessage *msg, gpointer data);
+static GstBusSyncReply gst_ss_demux_download_bus_cb(GstBus *bus, GstMessage *msg, gpointer data);
 static void gst_ss_demux_stream_init (GstSSDemux *demux, GstSSDemuxStream *stream, SS_STREAM_TYPE stream_type);
 static void gst_ss_demux_stream_free (GstSSDemux * demux, GstSSDemuxStream * stream);
-static void gst_ssm_demux_on_new_buffer (GstElement * appsink, void* data);
-static gboolean gst_ss_demux_download_fragment (GstSSDemux *demux, GstSSDemuxStream *stream, const gchar * uri, guint64 start_ts);
-static gboolean gst_ss_demux_create_download_pipe (GstSSDemux * demux, GstSSDemuxStream *stream, const gchar * uri, guint64 start_ts);
+static GstFlowReturn gst_ss_demux_fetcher_chain (GstPad * pad, GstBuffer * buf);
+static gboolean gst_ss_demux_fetcher_sink_event (GstPad * pad, GstEvent * event);
+static GstFlowReturn gst_ss_demux_push_buffer (GstSSDemux *demux, GstSSDemuxStream *stream, GstBuffer *inbuf);
+static gboolean gst_ss_demux_fetcher_start (GstSSDemux *demux, GstSSDemuxFetcher *fetcher, gchar * uri, guint64 start_ts, guint bitrate);
+static void gst_ss_demux_fetcher_park (GstSSDemux *demux, GstSSDemuxFetcher *fetcher);
+static void gst_ss_demux_drop_fragments (GstSSDemux *demux, GstSSDemuxStream *stream);
+static void gst_ss_demux_fetcher_fail (GstSSDemuxFetcher *fetcher);
+static void gst_ss_demux_fetcher_update_abr (GstSSDemux *demux, GstSSDemuxFetcher *fetcher);
+static GstStructure *gst_ss_demux_get_stats (GstSSDemux *demux);
+static gboolean gst_ss_demux_text_wanted (GstSSDemux *demux, GstSSDemuxStream *stream);
+static void gst_ss_demux_push_text (GstSSDemux *demux, GstSSDemuxStream *stream, GstSSDemuxFetcher *fetcher, GQueue *pending, gboolean done);
+static GstPadLinkReturn gst_ss_demux_text_link (GstPad * pad, GstPad * peer);
+static void gst_ss_demux_post_stats (GstSSDemux *demux);
+static gboolean gst_ss_demux_fetcher_schedule_retry (GstSSDemux *demux, GstSSDemuxFetcher *fetcher);
+static gboolean gst_ss_demux_fetcher_cache (GstSSDemux *demux, GstSSDemuxFetcher *fetcher, GList *buffers);
+static gboolean gst_ss_demux_create_download_pipe (GstSSDemux * demux, GstSSDemuxFetcher *fetcher, const gchar * uri);
+static void gst_ss_demux_destroy_download_pipe (GstSSDemux * demux, GstSSDemuxFetcher *fetcher);
+static gboolean gst_ss_demux_rearm_download_pipe (GstSSDemux * demux, GstSSDemuxFetcher *fetcher, const gchar * uri, guint64 start_ts);
 static void gst_ss_demux_stop (GstSSDemux * demux, GstSSDemuxStream *stream);
-static gboolean gst_ss_demux_create_dummy_pipe (GstSSDemux * demux, GstSSDemuxStream *stream);
-static gboolean gst_ss_demux_create_dummy_sender(GstSSDemux *demux, GstSSDemuxStream *stream);
+static void gst_ss_demux_stop_streams (GstSSDemux * demux);
+static gboolean gst_ss_demux_send_filler (GstSSDemux *demux, GstSSDemuxStream *stream, guint64 start_ts);
+static void gst_ss_demux_clear_filler (GstSSDemuxStream *stream);
+static void gst_ss_demux_mark_switch (GstSSDemux *demux, GstSSDemuxStream *stream, gboolean filling);
+static gboolean gst_ss_demux_create_parser (GstSSDemux *demux);
+static void gst_ss_demux_start_streams (GstSSDemux *demux);
+static void gst_ss_demux_start_refresh (GstSSDemux * demux);
+static void gst_ss_demux_stop_refresh (GstSSDemux * demux);
+static void gst_ss_demux_set_audio_track (GstSSDemux *demux, guint track);
+static gboolean gst_ss_demux_load_manifest (GstSSDemux *demux);
 
 static void
 gst_ss_demux_base_init (gpointer g_class)
@@ -168,6 +307,134 @@ gst_ss_demux_class_init (GstSSDemuxClass * klass)
           0, 1, DEFAULT_BITRATE_SWITCH_TOLERANCE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /* no.of fragments downloaded in parallel, capped by LookAheadCount in live */
+  g_object_class_install_property (gobject_class, PROP_PREFETCH_DEPTH,
+      g_param_spec_uint ("prefetch-depth", "Prefetch depth",
+          "Number of fragments per stream downloaded in parallel ahead of "
+          "the playback position (applied when the streams are created)",
+          1, MAX_PREFETCH_DEPTH, DEFAULT_PREFETCH_DEPTH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /* memory budget for startup caching & fragment re-use in VOD */
+  g_object_class_install_property (gobject_class, PROP_FRAGMENT_CACHE_SIZE,
+      g_param_spec_uint64 ("fragment-cache-size", "Fragment cache size",
+          "Maximum bytes of parsed fragments kept in memory for re-use after "
+          "seek and for startup caching (0 = disabled)",
+          0, G_MAXUINT64, DEFAULT_FRAGMENT_CACHE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_CACHE_HITS,
+      g_param_spec_uint64 ("cache-hits", "Cache hits",
+          "Number of fragments served from the fragment cache",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_CACHE_MISSES,
+      g_param_spec_uint64 ("cache-misses", "Cache misses",
+          "Number of fragments not found in the fragment cache",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_CACHE_EVICTIONS,
+      g_param_spec_uint64 ("cache-evictions", "Cache evictions",
+          "Number of fragments evicted from the fragment cache",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ABR_POLICY,
+      g_param_spec_enum ("abr-policy", "ABR policy",
+          "Policy used to select the video quality level",
+          GST_TYPE_SS_DEMUX_ABR_POLICY, DEFAULT_ABR_POLICY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /* live fragments requested before the server has them fail with 412 */
+  g_object_class_install_property (gobject_class, PROP_RETRY_DELAY,
+      g_param_spec_uint64 ("retry-delay", "Retry delay",
+          "Delay before the first retry of a fragment that is not yet "
+          "available on the server, doubled on every further retry (in ns)",
+          0, G_MAXUINT64, DEFAULT_RETRY_DELAY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_RETRY_MAX_DELAY,
+      g_param_spec_uint64 ("retry-max-delay", "Retry maximum delay",
+          "Upper bound of the delay between two retries of a fragment (in ns)",
+          0, G_MAXUINT64, DEFAULT_RETRY_MAX_DELAY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_RETRIES,
+      g_param_spec_uint ("max-retries", "Maximum retries",
+          "Number of retries of a fragment before giving up (0 = unlimited)",
+          0, G_MAXUINT, DEFAULT_MAX_RETRIES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FRAGMENT_RETRIES,
+      g_param_spec_uint64 ("fragment-retries", "Fragment retries",
+          "Number of fragment downloads retried since the element was created",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FRAGMENT_RETRY_FAILURES,
+      g_param_spec_uint64 ("fragment-retry-failures", "Fragment retry failures",
+          "Number of fragments given up after running out of retries",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /* video is replaced by this clip in live audio-only mode */
+  g_object_class_install_property (gobject_class, PROP_PLACEHOLDER_LOCATION,
+      g_param_spec_string ("placeholder-location", "Placeholder location",
+          "H.264 byte-stream clip sent in place of video in live audio-only mode",
+          DEFAULT_PLACEHOLDER_LOCATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SWITCH_LATENCY,
+      g_param_spec_uint64 ("switch-latency", "Switch latency",
+          "Time from the last audio-only/AV switch decision to the first video "
+          "buffer of the new mode (in ns)",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /* startup latency over startup quality */
+  g_object_class_install_property (gobject_class, PROP_FAST_START,
+      g_param_spec_boolean ("fast-start", "Fast start",
+          "Start every stream at its lowest bitrate & push the first fragment as soon "
+          "as it is parsed, without waiting for fragments-cache",
+          DEFAULT_FAST_START, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Per stream download statistics (bytes, fetch latency histogram, "
+          "quality level, switches, buffered time, stalls, retries) and "
+          "the number of caps built from manifest codec data, manifest parse "
+          "time",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STATS_INTERVAL,
+      g_param_spec_uint64 ("stats-interval", "Statistics interval",
+          "Minimum interval between \"ssdemux-stats\" element messages, posted "
+          "when fragments complete (in ns, 0 = disabled)",
+          0, G_MAXUINT64, DEFAULT_STATS_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /* text fragments are tiny, several of them are requested together */
+  g_object_class_install_property (gobject_class, PROP_TEXT_BATCH,
+      g_param_spec_uint ("text-batch", "Text batch",
+          "Number of text fragments downloaded together while the subtitle "
+          "pad is linked (applied when the streams are created)",
+          1, MAX_PREFETCH_DEPTH, DEFAULT_TEXT_BATCH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_AUDIO_TRACK,
+      g_param_spec_uint ("audio-track", "Audio track",
+          "Audio StreamIndex to play, in manifest order (e.g. language). "
+          "Can be changed while playing, the new track takes over from the "
+          "current position",
+          0, G_MAXUINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_N_AUDIO_TRACKS,
+      g_param_spec_uint ("n-audio-tracks", "Number of audio tracks",
+          "Number of audio StreamIndex in the manifest",
+          0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SNAPSHOT_DIR,
+      g_param_spec_string ("snapshot-dir", "Snapshot directory",
+          "Directory of the binary snapshots of parsed VOD manifests, keyed by "
+          "uri & manifest content. The manifest is parsed once completely "
+          "received when set (NULL = disabled)",
+          NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_ss_demux_change_state);
 }
@@ -185,6 +452,29 @@ gst_ss_demux_init (GstSSDemux * demux, GstSSDemuxClass * klass)
 
   demux->need_cache = TRUE;
   demux->fragments_cache = DEFAULT_FRAGMENTS_CACHE;
+  demux->prefetch_depth = DEFAULT_PREFETCH_DEPTH;
+  demux->frag_cache_size = DEFAULT_FRAGMENT_CACHE_SIZE;
+  demux->frag_cache = NULL;
+  demux->abr = gst_ss_abr_new (DEFAULT_ABR_POLICY);
+  demux->retry_delay = DEFAULT_RETRY_DELAY;
+  demux->retry_max_delay = DEFAULT_RETRY_MAX_DELAY;
+  demux->max_retries = DEFAULT_MAX_RETRIES;
+  demux->n_retries = 0;
+  demux->n_retry_failures = 0;
+  demux->placeholder_location = g_strdup (DEFAULT_PLACEHOLDER_LOCATION);
+  demux->switch_requested = GST_CLOCK_TIME_NONE;
+  demux->switch_latency = 0;
+  demux->fast_start = DEFAULT_FAST_START;
+  demux->start_time = GST_CLOCK_TIME_NONE;
+  demux->stats_interval = DEFAULT_STATS_INTERVAL;
+  demux->last_stats = GST_CLOCK_TIME_NONE;
+  demux->text_batch = DEFAULT_TEXT_BATCH;
+  demux->audio_track = 0;
+  demux->snapshot_dir = NULL;
+  demux->manifest_data = NULL;
+  demux->manifest_sum = NULL;
+  demux->manifest_parse_time = 0;
+  demux->manifest_from_snapshot = FALSE;
   demux->cancelled = FALSE;
   demux->cookies = NULL;
   demux->ss_mode = SS_MODE_NO_SWITCH;
@@ -197,6 +487,8 @@ gst_ss_demux_dispose (GObject * obj)
   GstSSDemux *demux = GST_SS_DEMUX (obj);
   int n =0;
 
+  gst_ss_demux_stop_refresh (demux);
+
   for (n = 0; n < SS_STREAM_NUM; n++) {
     if (demux->streams[n]) {
       gst_ss_demux_stream_free (demux, demux->streams[n]);
@@ -209,6 +501,32 @@ gst_ss_demux_dispose (GObject * obj)
     demux->parser = NULL;
   }
 
+  if (demux->frag_cache) {
+    gst_ss_fragment_cache_free (demux->frag_cache);
+    demux->frag_cache = NULL;
+  }
+
+  if (demux->abr) {
+    gst_ss_abr_free (demux->abr);
+    demux->abr = NULL;
+  }
+
+  g_free (demux->placeholder_location);
+  demux->placeholder_location = NULL;
+
+  g_free (demux->snapshot_dir);
+  demux->snapshot_dir = NULL;
+
+  if (demux->manifest_data) {
+    g_object_unref (demux->manifest_data);
+    demux->manifest_data = NULL;
+  }
+
+  if (demux->manifest_sum) {
+    g_checksum_free (demux->manifest_sum);
+    demux->manifest_sum = NULL;
+  }
+
   G_OBJECT_CLASS (parent_class)->dispose (obj);
 }
 
@@ -232,6 +550,44 @@ gst_ss_demux_set_property (GObject * object, guint prop_id,
     case PROP_BITRATE_SWITCH_TOLERANCE:
       demux->bitrate_switch_tol = g_value_get_float (value);
       break;
+    case PROP_PREFETCH_DEPTH:
+      demux->prefetch_depth = g_value_get_uint (value);
+      break;
+    case PROP_FRAGMENT_CACHE_SIZE:
+      demux->frag_cache_size = g_value_get_uint64 (value);
+      break;
+    case PROP_ABR_POLICY:
+      gst_ss_abr_set_policy (demux->abr, g_value_get_enum (value));
+      break;
+    case PROP_RETRY_DELAY:
+      demux->retry_delay = g_value_get_uint64 (value);
+      break;
+    case PROP_RETRY_MAX_DELAY:
+      demux->retry_max_delay = g_value_get_uint64 (value);
+      break;
+    case PROP_MAX_RETRIES:
+      demux->max_retries = g_value_get_uint (value);
+      break;
+    case PROP_PLACEHOLDER_LOCATION:
+      g_free (demux->placeholder_location);
+      demux->placeholder_location = g_value_dup_string (value);
+      break;
+    case PROP_FAST_START:
+      demux->fast_start = g_value_get_boolean (value);
+      break;
+    case PROP_STATS_INTERVAL:
+      demux->stats_interval = g_value_get_uint64 (value);
+      break;
+    case PROP_TEXT_BATCH:
+      demux->text_batch = g_value_get_uint (value);
+      break;
+    case PROP_AUDIO_TRACK:
+      gst_ss_demux_set_audio_track (demux, g_value_get_uint (value));
+      break;
+    case PROP_SNAPSHOT_DIR:
+      g_free (demux->snapshot_dir);
+      demux->snapshot_dir = g_value_dup_string (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -257,6 +613,82 @@ gst_ss_demux_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_BITRATE_SWITCH_TOLERANCE:
       g_value_set_float (value, demux->bitrate_switch_tol);
       break;
+    case PROP_PREFETCH_DEPTH:
+      g_value_set_uint (value, demux->prefetch_depth);
+      break;
+    case PROP_FRAGMENT_CACHE_SIZE:
+      g_value_set_uint64 (value, demux->frag_cache_size);
+      break;
+    case PROP_ABR_POLICY:
+      g_value_set_enum (value, demux->abr->policy);
+      break;
+    case PROP_RETRY_DELAY:
+      g_value_set_uint64 (value, demux->retry_delay);
+      break;
+    case PROP_RETRY_MAX_DELAY:
+      g_value_set_uint64 (value, demux->retry_max_delay);
+      break;
+    case PROP_MAX_RETRIES:
+      g_value_set_uint (value, demux->max_retries);
+      break;
+    case PROP_FRAGMENT_RETRIES:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_uint64 (value, demux->n_retries);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_FRAGMENT_RETRY_FAILURES:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_uint64 (value, demux->n_retry_failures);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_PLACEHOLDER_LOCATION:
+      g_value_set_string (value, demux->placeholder_location);
+      break;
+    case PROP_SWITCH_LATENCY:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_uint64 (value, demux->switch_latency);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_FAST_START:
+      g_value_set_boolean (value, demux->fast_start);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_ss_demux_get_stats (demux));
+      break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint64 (value, demux->stats_interval);
+      break;
+    case PROP_TEXT_BATCH:
+      g_value_set_uint (value, demux->text_batch);
+      break;
+    case PROP_AUDIO_TRACK:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_uint (value, demux->audio_track);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_SNAPSHOT_DIR:
+      g_value_set_string (value, demux->snapshot_dir);
+      break;
+    case PROP_N_AUDIO_TRACKS:
+      g_value_set_uint (value, (demux->parser && GST_SSM_PARSE_IS_COMPLETE (demux->parser)) ?
+          gst_ssm_parse_get_n_streams (demux->parser, SS_STREAM_AUDIO) : 0);
+      break;
+    case PROP_CACHE_HITS:
+    case PROP_CACHE_MISSES:
+    case PROP_CACHE_EVICTIONS: {
+      guint64 hits = 0, misses = 0, evictions = 0;
+
+      if (demux->frag_cache)
+        gst_ss_fragment_cache_get_stats (demux->frag_cache, &hits, &misses, &evictions, NULL);
+
+      if (prop_id == PROP_CACHE_HITS)
+        g_value_set_uint64 (value, hits);
+      else if (prop_id == PROP_CACHE_MISSES)
+        g_value_set_uint64 (value, misses);
+      else
+        g_value_set_uint64 (value, evictions);
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -267,55 +699,37 @@ static gboolean
 gst_ss_demux_sink_event (GstPad * pad, GstEvent * event)
 {
   GstSSDemux *demux = GST_SS_DEMUX (gst_pad_get_parent (pad));
-  GstQuery *query;
-  gboolean ret;
-  gchar *uri;
 
   switch (event->type) {
     case GST_EVENT_EOS: {
-      int i = 0;
-      if (demux->manifest == NULL) {
+      if (demux->parser == NULL) {
         GST_WARNING_OBJECT (demux, "Received EOS without a manifest.");
         break;
       }
 
       GST_DEBUG_OBJECT (demux, "Got EOS on the sink pad: mainifest file fetched");
 
-      query = gst_query_new_uri ();
-      ret = gst_pad_peer_query (demux->sinkpad, query);
-      if (ret) {
-        gst_query_parse_uri (query, &uri);
-        demux->parser = gst_ssm_parse_new (uri);
-        g_free (uri);
-      } else {
-        GST_ERROR_OBJECT (demux, "failed to query URI from upstream");
-        return FALSE;
-      }
-      gst_query_unref (query);
-
-      GST_LOG_OBJECT (demux, "data = %p & size = %d", GST_BUFFER_DATA(demux->manifest), GST_BUFFER_SIZE(demux->manifest));
-      if (!gst_ssm_parse_manifest (demux->parser, (char *)GST_BUFFER_DATA(demux->manifest), GST_BUFFER_SIZE(demux->manifest))) {
-        /* In most cases, this will happen if we set a wrong url in the
-         * source element and we have received the 404 HTML response instead of
-         * the playlist */
-        GST_ELEMENT_ERROR (demux, STREAM, DECODE, ("Invalid playlist."),
-            (NULL));
-        return FALSE;
-      }
+      /* streams are already running when the root element was closed in chain */
+      if (!GST_SSM_PARSE_IS_COMPLETE (demux->parser)) {
+        GstClockTime start = gst_util_get_timestamp ();
+        gboolean ret = FALSE;
 
-      for( i = 0; i < SS_STREAM_NUM; i++) {
-        if (gst_ssm_parse_check_stream (demux->parser, i)) {
-          GstSSDemuxStream *stream = g_new0 (GstSSDemuxStream, 1);
-
-          // Add pad emission of the stream
-          gst_ss_demux_stream_init (demux, stream, i);
-          g_static_rec_mutex_init (&stream->stream_lock);
-          stream->stream_task = gst_task_create ((GstTaskFunction) gst_ss_demux_stream_loop, demux);
-          gst_task_set_lock (stream->stream_task, &stream->stream_lock);
-          demux->streams[i] = stream;
-          g_print ("Starting stream - %d task loop...\n", i);
-          gst_task_start (stream->stream_task);
+        if (demux->manifest_data) {
+          ret = gst_ss_demux_load_manifest (demux);
+        } else {
+          ret = gst_ssm_parse_manifest_finish (demux->parser);
+          demux->manifest_parse_time += gst_util_get_timestamp () - start;
+        }
+
+        if (!ret) {
+          /* In most cases, this will happen if we set a wrong url in the
+           * source element and we have received the 404 HTML response instead of
+           * the playlist */
+          GST_ELEMENT_ERROR (demux, STREAM, DECODE, ("Invalid playlist."),
+              (NULL));
+          return FALSE;
         }
+        gst_ss_demux_start_streams (demux);
       }
 
       gst_event_unref (event);
@@ -374,6 +788,7 @@ static gboolean
 gst_ss_demux_handle_src_event (GstPad * pad, GstEvent * event)
 {
   GstSSDemux *demux = GST_SS_DEMUX (gst_pad_get_parent (pad));
+  gboolean res = FALSE;
 
   switch (event->type) {
     case GST_EVENT_SEEK:
@@ -388,18 +803,35 @@ gst_ss_demux_handle_src_event (GstPad * pad, GstEvent * event)
 
       GST_INFO_OBJECT (demux, "Received GST_EVENT_SEEK");
 
-      // TODO: should be able to seek in DVR window
-      if (GST_SSM_PARSE_IS_LIVE_PRESENTATION (demux->parser)) {
-        GST_WARNING_OBJECT (demux, "Received seek event for live stream");
-        return FALSE;
-      }
-
       gst_event_parse_seek (event, &rate, &format, &flags, &start_type, &start,
           &stop_type, &stop);
 
       if (format != GST_FORMAT_TIME) {
         GST_WARNING_OBJECT (demux, "Only time format is supported in seek");
-        return FALSE;
+        goto done;
+      }
+
+      /* the stream tasks can only be taken out of a blocked push by flushing
+       * downstream, a non-flushing seek would wait for them forever */
+      if (!(flags & GST_SEEK_FLAG_FLUSH)) {
+        GST_WARNING_OBJECT (demux, "Only flushing seeks are supported");
+        goto done;
+      }
+
+      if (GST_SSM_PARSE_IS_LIVE_PRESENTATION (demux->parser)) {
+        GstClockTime dvr_start = 0;
+        GstClockTime dvr_stop = 0;
+
+        /* only the fragments still in the DVR window can be fetched */
+        if (start_type != GST_SEEK_TYPE_SET ||
+            !gst_ssm_parse_get_dvr_window (demux->parser, &dvr_start, &dvr_stop)) {
+          GST_WARNING_OBJECT (demux, "Received seek event for live stream without DVR window");
+          goto done;
+        }
+
+        GST_INFO_OBJECT (demux, "DVR window %" GST_TIME_FORMAT " - %" GST_TIME_FORMAT,
+            GST_TIME_ARGS (dvr_start), GST_TIME_ARGS (dvr_stop));
+        start = CLAMP (start, dvr_start, dvr_stop);
       }
 
       GST_DEBUG_OBJECT (demux, "seek event, rate: %f start: %" GST_TIME_FORMAT
@@ -409,43 +841,67 @@ gst_ss_demux_handle_src_event (GstPad * pad, GstEvent * event)
 
       for( i = 0; i < SS_STREAM_NUM; i++) {
         if (stream = demux->streams[i]) {
+          g_mutex_lock (stream->lock);
+          stream->flushing = TRUE;
           g_cond_signal (stream->cond);
+          g_mutex_unlock (stream->lock);
           gst_task_stop (stream->stream_task);
         }
       }
 
-      if (flags & GST_SEEK_FLAG_FLUSH) {
-        GST_INFO_OBJECT (demux, "sending flush start");
+      /* a task waiting at the live edge for the next fragment */
+      gst_ssm_parse_set_flushing (demux->parser, TRUE);
+
+      GST_INFO_OBJECT (demux, "sending flush start");
+
+      for( i = 0; i < SS_STREAM_NUM; i++) {
+        if (stream = demux->streams[i]) {
+          gst_pad_push_event (stream->pad, gst_event_new_flush_start ());
+        }
+      }
 
-        for( i = 0; i < SS_STREAM_NUM; i++) {
-          if (stream = demux->streams[i]) {
-            gst_pad_push_event (stream->pad, gst_event_new_flush_start ());
-          }
+      for( i = 0; i < SS_STREAM_NUM; i++) {
+        if (stream = demux->streams[i]) {
+          /* wait for the task to leave the loop & drop the prefetched fragments */
+          g_static_rec_mutex_lock (&stream->stream_lock);
+          gst_ss_demux_drop_fragments (demux, stream);
+          stream->last_end = GST_CLOCK_TIME_NONE;
+          stream->resume_ts = GST_CLOCK_TIME_NONE;
+          stream->flushing = FALSE;
+          g_static_rec_mutex_unlock (&stream->stream_lock);
         }
       }
 
+      gst_ssm_parse_set_flushing (demux->parser, FALSE);
       gst_ssm_parse_seek_manifest (demux->parser, start);
 
-      if (flags & GST_SEEK_FLAG_FLUSH) {
-        GST_INFO_OBJECT (demux, "sending flush stop");
-        for( i = 0; i < SS_STREAM_NUM; i++) {
-          if (stream = demux->streams[i]) {
-            gst_pad_push_event (stream->pad, gst_event_new_flush_stop ());
-            GST_LOG_OBJECT (stream->pad, "Starting pad TASK again...\n");
-            stream->sent_ns = FALSE;
-            stream->frag_cnt = 0; /*resetting to start buffering on SEEK */
-            gst_task_start (stream->stream_task);
-          }
+      GST_INFO_OBJECT (demux, "sending flush stop");
+      for( i = 0; i < SS_STREAM_NUM; i++) {
+        if (stream = demux->streams[i]) {
+          gst_pad_push_event (stream->pad, gst_event_new_flush_stop ());
+          GST_LOG_OBJECT (stream->pad, "Starting pad TASK again...\n");
+          stream->sent_ns = FALSE;
+          stream->frag_cnt = 0; /*resetting to start buffering on SEEK */
+          gst_task_start (stream->stream_task);
         }
       }
 
-      return TRUE;
+      res = TRUE;
+      break;
     }
     default:
+      /* takes the event */
+      res = gst_pad_event_default (pad, event);
+      event = NULL;
       break;
   }
 
-  return gst_pad_event_default (pad, event);
+done:
+  if (event)
+    gst_event_unref (event);
+  gst_object_unref (demux);
+
+  return res;
 }
 
 static GstStateChangeReturn
@@ -455,6 +911,8 @@ gst_ss_demux_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_READY_TO_PAUSED:
+      /* reference of the time to first frame */
+      GST_SS_DEMUX (element)->start_time = gst_util_get_timestamp ();
       break;
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
       break;
@@ -468,6 +926,8 @@ gst_ss_demux_change_state (GstElement * element, GstStateChange transition)
     case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_ss_demux_stop_refresh (GST_SS_DEMUX (element));
+      gst_ss_demux_stop_streams (GST_SS_DEMUX (element));
       break;
     default:
       break;
@@ -476,212 +936,1262 @@ gst_ss_demux_change_state (GstElement * element, GstStateChange transition)
 }
 
 
-static GstFlowReturn
-gst_ss_demux_chain (GstPad * pad, GstBuffer * buf)
+static gboolean
+gst_ss_demux_create_parser (GstSSDemux *demux)
 {
-  GstSSDemux *demux = GST_SS_DEMUX (gst_pad_get_parent (pad));
+  GstQuery *query;
+  gchar *uri;
 
-  if (demux->manifest == NULL)
-    demux->manifest = buf;
-  else
-    demux->manifest = gst_buffer_join (demux->manifest, buf);
-  gst_object_unref (demux);
+  query = gst_query_new_uri ();
+  if (!gst_pad_peer_query (demux->sinkpad, query)) {
+    GST_ERROR_OBJECT (demux, "failed to query URI from upstream");
+    gst_query_unref (query);
+    return FALSE;
+  }
 
-  return GST_FLOW_OK;
-}
+  gst_query_parse_uri (query, &uri);
+  demux->parser = gst_ssm_parse_new (uri);
 
+  if (demux->parser && demux->snapshot_dir) {
+    demux->manifest_data = gst_adapter_new ();
+    demux->manifest_sum = g_checksum_new (G_CHECKSUM_SHA1);
+    /* relative fragment urls depend on the manifest uri */
+    g_checksum_update (demux->manifest_sum, (const guchar *) uri, strlen (uri) + 1);
+  }
+  g_free (uri);
+  gst_query_unref (query);
+
+  return demux->parser != NULL;
+}
 
+/* parses the manifest received till EOS, from its snapshot when there is
+ * one, and writes the snapshot of a VOD manifest otherwise */
 static gboolean
-gst_ss_demux_get_next_fragment (GstSSDemux * demux, SS_STREAM_TYPE stream_type)
+gst_ss_demux_load_manifest (GstSSDemux *demux)
 {
-  GstSSDemuxStream *stream = demux->streams[stream_type];
-  gchar *next_fragment_uri = NULL;
-  guint64 start_ts = 0;
-
-  if (!gst_ssm_parse_get_next_fragment_url (demux->parser, stream_type, &next_fragment_uri, &start_ts )) {
-    GST_INFO_OBJECT (demux, "This Manifest does not contain more fragments");
-    goto end_of_list;
-  }
+  GstClockTime start = gst_util_get_timestamp ();
+  guint size = gst_adapter_available (demux->manifest_data);
+  gchar *name = NULL;
+  gchar *location = NULL;
+  gboolean ret = FALSE;
 
-  GST_ERROR_OBJECT (demux, "Fetching next fragment %s", next_fragment_uri);
+  name = g_strconcat (g_checksum_get_string (demux->manifest_sum), ".ssm", NULL);
+  location = g_build_filename (demux->snapshot_dir, name, NULL);
+  g_free (name);
 
-  stream->uri = g_strdup(next_fragment_uri);
-  stream->start_ts = start_ts;
+  if (gst_ssm_parse_load_snapshot (demux->parser, location)) {
+    demux->manifest_from_snapshot = TRUE;
+    ret = TRUE;
+  } else if (size) {
+    guint8 *data = gst_adapter_take (demux->manifest_data, size);
 
-  if (!gst_ss_demux_download_fragment (demux, stream, next_fragment_uri, start_ts)) {
-    GST_ERROR_OBJECT (demux, "failed to download fragment...");
-    goto error;
+    ret = gst_ssm_parse_manifest (demux->parser, (char *) data, size);
+    g_free (data);
+  }
+  demux->manifest_parse_time = gst_util_get_timestamp () - start;
+  gst_adapter_clear (demux->manifest_data);
+
+  GST_INFO_OBJECT (demux, "manifest of %u bytes %s in %" GST_TIME_FORMAT, size,
+      demux->manifest_from_snapshot ? "loaded from snapshot" : "parsed",
+      GST_TIME_ARGS (demux->manifest_parse_time));
+
+  if (ret && !demux->manifest_from_snapshot &&
+      !GST_SSM_PARSE_IS_LIVE_PRESENTATION (demux->parser)) {
+    if (g_mkdir_with_parents (demux->snapshot_dir, 0755) < 0 ||
+        !gst_ssm_parse_save_snapshot (demux->parser, location))
+      GST_WARNING_OBJECT (demux, "no manifest snapshot written to %s", demux->snapshot_dir);
   }
 
-  return TRUE;
+  g_free (location);
 
-error:
-  {
-    gst_ss_demux_stop (demux, stream);
-    return FALSE;
-  }
-end_of_list:
-  {
-    GST_INFO_OBJECT (demux, "Reached end of playlist, sending EOS");
-    gst_pad_push_event (stream->pad, gst_event_new_eos ());
-    gst_ss_demux_stop (demux, stream);
-    return TRUE;
-  }
+  return ret;
 }
 
 static void
-gst_ss_demux_stream_loop (GstSSDemux * demux)
+gst_ss_demux_start_streams (GstSSDemux *demux)
 {
-  GThread *self = NULL;
-  int stream_type = 0;
-  GstSSDemuxStream *stream = NULL;
+  int i = 0;
 
-  self = g_thread_self ();
+  /* re-use of fragments only makes sense when the presentation is seekable */
+  if (demux->frag_cache_size && !GST_SSM_PARSE_IS_LIVE_PRESENTATION (demux->parser) && !demux->frag_cache)
+    demux->frag_cache = gst_ss_fragment_cache_new (demux->frag_cache_size);
 
-  for (stream_type = 0; stream_type < SS_STREAM_NUM; stream_type++) {
-    if (demux->streams[stream_type]->stream_task->abidata.ABI.thread == self) {
-      stream = demux->streams[stream_type];
-      break;
+  /* first fragments at the lowest bitrate, ABR ramps up from there */
+  for( i = 0; demux->fast_start && i < SS_STREAM_NUM; i++) {
+    if (gst_ssm_parse_check_stream (demux->parser, i)) {
+      GST_INFO_OBJECT (demux, "fast start, stream %d from the lowest quality level", i);
+      gst_ssm_parse_set_qualitylevel (demux->parser, i, 0);
     }
   }
 
-  /* download next fragment of stream_type */
-  if (!gst_ss_demux_get_next_fragment (demux, stream_type)) {
-    GST_ERROR_OBJECT (demux, "failed to get next fragment...");
-    goto error;
+  for( i = 0; i < SS_STREAM_NUM; i++) {
+    if (gst_ssm_parse_check_stream (demux->parser, i)) {
+      GstSSDemuxStream *stream = g_new0 (GstSSDemuxStream, 1);
+
+      // Add pad emission of the stream
+      gst_ss_demux_stream_init (demux, stream, i);
+      g_static_rec_mutex_init (&stream->stream_lock);
+      stream->stream_task = gst_task_create ((GstTaskFunction) gst_ss_demux_stream_loop, demux);
+      gst_task_set_lock (stream->stream_task, &stream->stream_lock);
+      demux->streams[i] = stream;
+      g_print ("Starting stream - %d task loop...\n", i);
+      gst_task_start (stream->stream_task);
+    }
   }
 
-  return;
-
-error:
-  {
-    gst_task_pause (stream->stream_task);
-    GST_ELEMENT_ERROR (demux, RESOURCE, NOT_FOUND,
-          ("could not download fragments"), (NULL));
-      gst_ss_demux_stop (demux, stream);
-    return;
-  }
+  if (GST_SSM_PARSE_IS_LIVE_PRESENTATION (demux->parser))
+    gst_ss_demux_start_refresh (demux);
 }
 
 static gboolean
-gst_ss_demux_download_fragment (GstSSDemux *demux, GstSSDemuxStream *stream, const gchar * uri, guint64 start_ts)
+gst_ss_demux_create_refresh_pipe (GstSSDemux * demux)
 {
-  GstStateChangeReturn ret;
+  GstElement *urisrc = NULL;
 
-  g_print ("Going to download fragment : %s\n", uri);
-  if (!gst_ss_demux_create_download_pipe (demux, stream, uri, start_ts)) {
-    GST_ERROR_OBJECT (demux, "failed to create download pipeline");
+  demux->refresh_pipe = gst_pipeline_new ("manifest-refresher");
+  if (!demux->refresh_pipe) {
+    GST_ERROR_OBJECT (demux, "failed to create pipeline");
     return FALSE;
   }
 
-  ret = gst_element_set_state (stream->pipe, GST_STATE_PLAYING);
-  if (ret == GST_STATE_CHANGE_FAILURE) {
-    GST_ERROR_OBJECT (demux, "set_state failed...");
-    return FALSE;
+  urisrc = gst_element_make_from_uri (GST_URI_SRC, demux->parser->uri, "manifest-httpsrc");
+  if (!urisrc) {
+    GST_ERROR_OBJECT (demux, "failed to create urisrc");
+    goto error;
+  }
+
+  demux->refresh_sink = gst_element_factory_make ("appsink", "manifest-sink");
+  if (!demux->refresh_sink) {
+    GST_ERROR_OBJECT (demux, "failed to create appsink element");
+    gst_object_unref (urisrc);
+    goto error;
   }
+  g_object_set (G_OBJECT (demux->refresh_sink), "sync", FALSE, NULL);
 
-  if (stream->pipe && demux->ss_mode == SS_MODE_AONLY &&
-    stream->type == SS_STREAM_VIDEO) {
+  gst_bin_add_many (GST_BIN (demux->refresh_pipe), urisrc, demux->refresh_sink, NULL);
+  if (!gst_element_link (urisrc, demux->refresh_sink)) {
+    GST_ERROR_OBJECT (demux, "failed to link elements...");
+    goto error;
+  }
 
-    GST_DEBUG_OBJECT (demux, "Waiting to fetch the URI");
-    g_mutex_lock (stream->lock);
-    g_cond_wait (stream->cond, stream->lock);
-    GST_INFO_OBJECT (stream->pad, "Recived signal to shutdown...");
-    g_mutex_unlock (stream->lock);
+  return TRUE;
+
+error:
+  gst_object_unref (demux->refresh_pipe);
+  demux->refresh_pipe = demux->refresh_sink = NULL;
+  return FALSE;
+}
 
-    /* put live pipeline to PAUSED state to unlink urisrc & piffdemux */
-    gst_element_set_state (stream->pipe, GST_STATE_NULL);
-    gst_element_get_state (stream->pipe, NULL, NULL, GST_CLOCK_TIME_NONE);
+/* downloads the manifest again & parses it into a new parser, the caller
+ * merges it. Runs in the refresh task, the download is bounded by
+ * SS_MANIFEST_DOWNLOAD_TIMEOUT and cut short by gst_ss_demux_stop_refresh() */
+static GstSSMParse *
+gst_ss_demux_download_manifest (GstSSDemux * demux)
+{
+  GstSSMParse *fresh = NULL;
+  GstMessage *msg = NULL;
+  GstBuffer *buf = NULL;
+  GstBus *bus = NULL;
 
-    stream->pipe = NULL;
+  if (gst_element_set_state (demux->refresh_pipe, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+    GST_WARNING_OBJECT (demux, "failed to start manifest download");
+    goto done;
+  }
 
-    stream->switch_ts = stream->start_ts;
+  bus = gst_pipeline_get_bus (GST_PIPELINE (demux->refresh_pipe));
+  msg = gst_bus_timed_pop_filtered (bus, SS_MANIFEST_DOWNLOAD_TIMEOUT,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR | GST_MESSAGE_APPLICATION);
+  if (!msg || GST_MESSAGE_TYPE (msg) != GST_MESSAGE_EOS) {
+    GST_WARNING_OBJECT (demux, "manifest refresh failed : %s",
+        msg ? GST_MESSAGE_TYPE_NAME (msg) : "timeout");
+    goto done;
+  }
 
-    /* create dummy frame sender */
-    if (!gst_ss_demux_create_dummy_sender (demux, stream)) {
-      GST_ERROR_OBJECT (demux, "failed to create dummy sender pipeline...");
-      GST_ELEMENT_ERROR (demux, RESOURCE, FAILED, ("Unable to create dummy pipe."), (NULL));
-      return FALSE;
+  /* appsink keeps the buffers after EOS, they go to the parser one by one */
+  fresh = gst_ssm_parse_new (demux->parser->uri);
+  while (fresh && (buf = gst_app_sink_pull_buffer (GST_APP_SINK (demux->refresh_sink)))) {
+    if (!gst_ssm_parse_manifest_push (fresh, (char *)GST_BUFFER_DATA (buf), GST_BUFFER_SIZE (buf))) {
+      gst_ssm_parse_free (fresh);
+      fresh = NULL;
     }
+    gst_buffer_unref (buf);
   }
 
-  /* wait until:
-   *   - the download succeed (EOS)
-   *   - the download failed (Error message on the fetcher bus)
-   *   - the download was canceled
-   */
-  GST_DEBUG_OBJECT (demux, "Waiting to fetch the URI");
-  g_mutex_lock (stream->lock);
-  g_cond_wait (stream->cond, stream->lock);
-  GST_INFO_OBJECT (stream->pad, "Recived signal to shutdown...");
-  g_mutex_unlock (stream->lock);
+  if (fresh && !gst_ssm_parse_manifest_finish (fresh)) {
+    gst_ssm_parse_free (fresh);
+    fresh = NULL;
+  }
 
-  gst_element_set_state (stream->pipe, GST_STATE_NULL);
-  gst_element_get_state (stream->pipe, NULL, NULL, GST_CLOCK_TIME_NONE);
-  stream->pipe = NULL;
+  if (!fresh)
+    GST_WARNING_OBJECT (demux, "failed to parse refreshed manifest");
 
-  return TRUE;
+done:
+  if (msg)
+    gst_message_unref (msg);
+
+  gst_element_set_state (demux->refresh_pipe, GST_STATE_READY);
+  gst_element_get_state (demux->refresh_pipe, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  if (bus) {
+    /* drop what is left of this download */
+    gst_bus_set_flushing (bus, TRUE);
+    gst_bus_set_flushing (bus, FALSE);
+    gst_object_unref (bus);
+  }
+
+  return fresh;
 }
 
-static gboolean
-gst_ss_demux_create_dummy_sender(GstSSDemux *demux, GstSSDemuxStream *stream)
+/* periodically re-fetches a live manifest & merges its new fragments, so
+ * fragment discovery does not depend only on the piffdemux live-param */
+static void
+gst_ss_demux_refresh_loop (GstSSDemux * demux)
 {
-  GstStateChangeReturn ret;
+  GstClockTime interval = gst_ssm_parse_get_refresh_interval (demux->parser);
+  GstSSMParse *fresh = NULL;
+  GTimeVal deadline;
+  gboolean stop = FALSE;
 
-  if (!gst_ss_demux_create_dummy_pipe (demux, stream)) {
-    GST_ERROR_OBJECT (demux, "failed to create download pipeline");
-    return FALSE;
+  if (!GST_CLOCK_TIME_IS_VALID (interval) || interval < SS_MANIFEST_REFRESH_MIN_INTERVAL)
+    interval = SS_MANIFEST_REFRESH_MIN_INTERVAL;
+
+  g_get_current_time (&deadline);
+  g_time_val_add (&deadline, GST_TIME_AS_USECONDS (interval));
+
+  g_mutex_lock (demux->refresh_lock);
+  while (!demux->refresh_stop) {
+    if (!g_cond_timed_wait (demux->refresh_cond, demux->refresh_lock, &deadline))
+      break;
   }
+  stop = demux->refresh_stop;
+  g_mutex_unlock (demux->refresh_lock);
 
-  ret = gst_element_set_state (stream->pipe, GST_STATE_PLAYING);
-  if (ret == GST_STATE_CHANGE_FAILURE) {
-    GST_ERROR_OBJECT (demux, "set_state failed...");
-    return FALSE;
+  if (stop)
+    return;
+
+  fresh = gst_ss_demux_download_manifest (demux);
+  if (fresh) {
+    guint n_new = gst_ssm_parse_merge_manifest (demux->parser, fresh);
+
+    GST_DEBUG_OBJECT (demux, "manifest refreshed, %u new fragments", n_new);
+    gst_ssm_parse_free (fresh);
   }
+}
 
-#if 0
-  GST_DEBUG_OBJECT (demux, "Waiting to download next video URI");
-  g_mutex_lock (stream->lock);
-  g_cond_wait (stream->cond, stream->lock);
-  if (stream->pipe) {
-    gst_element_set_state (stream->pipe, GST_STATE_NULL);
-    gst_element_get_state (stream->pipe, NULL, NULL, GST_CLOCK_TIME_NONE);
-    stream->pipe = NULL;
+static void
+gst_ss_demux_start_refresh (GstSSDemux * demux)
+{
+  if (demux->refresh_task)
+    return;
+
+  if (!gst_ss_demux_create_refresh_pipe (demux)) {
+    GST_WARNING_OBJECT (demux, "live manifest will not be refreshed");
+    return;
   }
-  g_mutex_unlock (stream->lock);
-#endif
 
-  return TRUE;
+  demux->refresh_lock = g_mutex_new ();
+  demux->refresh_cond = g_cond_new ();
+  demux->refresh_stop = FALSE;
+
+  g_static_rec_mutex_init (&demux->refresh_task_lock);
+  demux->refresh_task = gst_task_create ((GstTaskFunction) gst_ss_demux_refresh_loop, demux);
+  gst_task_set_lock (demux->refresh_task, &demux->refresh_task_lock);
+  gst_task_start (demux->refresh_task);
 }
 
 static void
-gst_ss_demux_append_live_params(GstElement *piffparser, piff_live_param_t *param, gpointer data)
+gst_ss_demux_stop_refresh (GstSSDemux * demux)
 {
-  GstSSDemuxStream *stream = (GstSSDemuxStream *)data;
-  GstSSDemux *demux = stream->parent;
-  int i =0;
-  guint64 timestamp = 0;
-  guint64 duration = 0;
+  GstBus *bus = NULL;
 
-  GST_LOG_OBJECT (demux, "received signal structs count = %d\n", param->count);
+  if (!demux->refresh_task)
+    return;
 
-  for (i = 0 ; i< param->count; i++) {
-    if (param->long_info) {
-      piff_fragment_longtime_info *info = &(param->long_info[i]);
-      timestamp = info->ts;
-      duration = info->duration;
-    } else if (param->info) {
-      piff_fragment_time_info *info = &(param->info[i]);
-      timestamp = info->ts;
-      duration = info->duration;
-    }
+  gst_task_stop (demux->refresh_task);
 
-    GST_LOG_OBJECT (demux, "Received ts = %llu and dur = %llu\n", timestamp, duration);
+  g_mutex_lock (demux->refresh_lock);
+  demux->refresh_stop = TRUE;
+  g_cond_signal (demux->refresh_cond);
+  g_mutex_unlock (demux->refresh_lock);
 
-    if (!gst_ssm_parse_append_next_fragment (demux->parser, stream->type, timestamp, duration)) {
-      GST_ERROR_OBJECT (demux, "failed to append new fragment");
-      GST_ELEMENT_ERROR (demux, RESOURCE, NO_SPACE_LEFT, ("fragment allocation failed..."), (NULL));
-      return;
+  /* wake up a manifest download in progress */
+  bus = gst_pipeline_get_bus (GST_PIPELINE (demux->refresh_pipe));
+  gst_bus_post (bus, gst_message_new_application (GST_OBJECT_CAST (demux),
+      gst_structure_empty_new ("ssdemux-refresh-stop")));
+  gst_object_unref (bus);
+
+  gst_task_join (demux->refresh_task);
+  gst_object_unref (demux->refresh_task);
+  demux->refresh_task = NULL;
+  g_static_rec_mutex_free (&demux->refresh_task_lock);
+
+  gst_element_set_state (demux->refresh_pipe, GST_STATE_NULL);
+  gst_element_get_state (demux->refresh_pipe, NULL, NULL, GST_CLOCK_TIME_NONE);
+  gst_object_unref (demux->refresh_pipe);
+  demux->refresh_pipe = demux->refresh_sink = NULL;
+
+  g_mutex_free (demux->refresh_lock);
+  demux->refresh_lock = NULL;
+  g_cond_free (demux->refresh_cond);
+  demux->refresh_cond = NULL;
+}
+
+/* every manifest buffer goes straight to the push parser and is dropped,
+ * streams are started once the root element is closed, without waiting
+ * for EOS from upstream */
+static GstFlowReturn
+gst_ss_demux_chain (GstPad * pad, GstBuffer * buf)
+{
+  GstSSDemux *demux = GST_SS_DEMUX (gst_pad_get_parent (pad));
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstClockTime start = 0;
+  gboolean pushed = FALSE;
+
+  if (demux->parser == NULL && !gst_ss_demux_create_parser (demux)) {
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+
+  if (GST_SSM_PARSE_IS_COMPLETE (demux->parser))
+    goto done;
+
+  if (demux->manifest_data) {
+    /* parsed at EOS, unless a snapshot of the same manifest exists */
+    g_checksum_update (demux->manifest_sum, GST_BUFFER_DATA (buf), GST_BUFFER_SIZE (buf));
+    gst_adapter_push (demux->manifest_data, gst_buffer_ref (buf));
+    goto done;
+  }
+
+  GST_LOG_OBJECT (demux, "data = %p & size = %d", GST_BUFFER_DATA(buf), GST_BUFFER_SIZE(buf));
+  start = gst_util_get_timestamp ();
+  pushed = gst_ssm_parse_manifest_push (demux->parser, (char *)GST_BUFFER_DATA(buf), GST_BUFFER_SIZE(buf));
+  demux->manifest_parse_time += gst_util_get_timestamp () - start;
+  if (!pushed) {
+    GST_ELEMENT_ERROR (demux, STREAM, DECODE, ("Invalid playlist."),
+        (NULL));
+    ret = GST_FLOW_ERROR;
+    goto done;
+  }
+
+  if (GST_SSM_PARSE_IS_COMPLETE (demux->parser)) {
+    GST_INFO_OBJECT (demux, "manifest root element closed, starting streams before EOS");
+    gst_ss_demux_start_streams (demux);
+  }
+
+done:
+  gst_buffer_unref (buf);
+  gst_object_unref (demux);
+
+  return ret;
+}
+
+
+static void
+gst_ss_demux_end_of_list (GstSSDemux * demux, GstSSDemuxStream * stream)
+{
+  GST_INFO_OBJECT (demux, "Reached end of playlist, sending EOS");
+  gst_pad_push_event (stream->pad, gst_event_new_eos ());
+  gst_ss_demux_stop (demux, stream);
+}
+
+/* keeps up to prefetch-depth fragments of the stream in flight. Blocks for
+ * the next fragment url only when nothing is in flight, so the window never
+ * stalls the fragments already being downloaded */
+static gboolean
+gst_ss_demux_fill_window (GstSSDemux * demux, GstSSDemuxStream * stream)
+{
+  guint window = stream->n_fetchers;
+
+  if (GST_SSM_PARSE_IS_LIVE_PRESENTATION (demux->parser)) {
+    /* only LookAheadCount fragments are announced ahead of the live edge */
+    window = MIN (window, MAX (1, GST_SSM_PARSE_LOOKAHEAD_COUNT (demux->parser)));
+  }
+
+  while (g_queue_get_length (stream->inflight) < window) {
+    GstSSDemuxFetcher *fetcher = NULL;
+    gchar *next_fragment_uri = NULL;
+    guint64 start_ts = 0;
+    guint bitrate = 0;
+
+    if (!g_queue_is_empty (stream->inflight) &&
+        !gst_ssm_parse_has_next_fragment (demux->parser, stream->type))
+      break;
+
+    if (!gst_ssm_parse_get_next_fragment_url (demux->parser, stream->type, &next_fragment_uri, &start_ts, &bitrate)) {
+      if (GST_SSM_PARSE_IS_FLUSHING (demux->parser))
+        break;
+      GST_INFO_OBJECT (demux, "This Manifest does not contain more fragments");
+      if (g_queue_is_empty (stream->inflight))
+        gst_ss_demux_end_of_list (demux, stream);
+      break;
+    }
+
+    GST_DEBUG_OBJECT (stream->pad, "Fetching next fragment %s", next_fragment_uri);
+
+    fetcher = g_queue_pop_head (stream->free_fetchers);
+    if (!gst_ss_demux_fetcher_start (demux, fetcher, next_fragment_uri, start_ts, bitrate)) {
+      GST_ERROR_OBJECT (demux, "failed to download fragment...");
+      g_queue_push_tail (stream->free_fetchers, fetcher);
+      return FALSE;
+    }
+    g_queue_push_tail (stream->inflight, fetcher);
+  }
+
+  return TRUE;
+}
+
+/* waits on the stream condition for the next fetcher event, must be called
+ * with the stream lock. Returns TRUE when the download of an in-flight
+ * fragment is due to be retried */
+static gboolean
+gst_ss_demux_wait_event (GstSSDemuxStream * stream)
+{
+  GstClockTime retry_at = GST_CLOCK_TIME_NONE;
+  GstClockTime now = 0;
+  GTimeVal deadline;
+  GList *walk = NULL;
+
+  for (walk = stream->inflight->head; walk; walk = g_list_next (walk)) {
+    GstSSDemuxFetcher *fetcher = walk->data;
+
+    if (fetcher->state == SS_FETCHER_RETRY)
+      retry_at = MIN (retry_at, fetcher->retry_at);
+  }
+
+  if (!GST_CLOCK_TIME_IS_VALID (retry_at)) {
+    g_cond_wait (stream->cond, stream->lock);
+    return FALSE;
+  }
+
+  now = gst_util_get_timestamp ();
+  if (retry_at <= now)
+    return TRUE;
+
+  g_get_current_time (&deadline);
+  g_time_val_add (&deadline, GST_TIME_AS_USECONDS (retry_at - now));
+  g_cond_timed_wait (stream->cond, stream->lock, &deadline);
+
+  return FALSE;
+}
+
+/* restarts the in-flight downloads whose retry time has come. Runs in the
+ * stream task, the bus sync handler only schedules the retry */
+static void
+gst_ss_demux_retry_fetchers (GstSSDemux * demux, GstSSDemuxStream * stream)
+{
+  GstClockTime now = gst_util_get_timestamp ();
+  GList *walk = NULL;
+
+  for (walk = stream->inflight->head; walk; walk = g_list_next (walk)) {
+    GstSSDemuxFetcher *fetcher = walk->data;
+    gboolean due = FALSE;
+
+    g_mutex_lock (stream->lock);
+    if (fetcher->state == SS_FETCHER_RETRY && fetcher->retry_at <= now) {
+      fetcher->state = SS_FETCHER_FETCHING;
+      due = TRUE;
+    }
+    g_mutex_unlock (stream->lock);
+
+    if (!due)
+      continue;
+
+    /* re-arm the same download pipe with the same fragment */
+    g_print ("Going to download fragment AGAIN : %s\n", fetcher->uri);
+    if (!gst_ss_demux_rearm_download_pipe (demux, fetcher, fetcher->uri, fetcher->start_ts) ||
+        gst_element_set_state (fetcher->pipe, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+      GST_ERROR_OBJECT (demux, "failed to re-arm download pipeline");
+      GST_ELEMENT_ERROR (demux, RESOURCE, READ, ("could not download fragment again"), (NULL));
+      gst_ss_demux_fetcher_fail (fetcher);
+    }
+  }
+}
+
+/* wakes up the text stream task waiting for its pad to be linked */
+static GstPadLinkReturn
+gst_ss_demux_text_link (GstPad * pad, GstPad * peer)
+{
+  GstSSDemuxStream *stream = GST_PAD_ELEMENT_PRIVATE (pad);
+
+  g_mutex_lock (stream->lock);
+  g_cond_signal (stream->cond);
+  g_mutex_unlock (stream->lock);
+
+  return GST_PAD_LINK_OK;
+}
+
+/* text is only downloaded while its pad is linked. Meanwhile the fragment
+ * list follows the other streams, so subtitles resume at the right place */
+static gboolean
+gst_ss_demux_text_wanted (GstSSDemux *demux, GstSSDemuxStream *stream)
+{
+  GstClockTime position = GST_CLOCK_TIME_NONE;
+  GTimeVal deadline;
+  gint i = 0;
+
+  if (gst_pad_is_linked (stream->pad) || !g_queue_is_empty (stream->inflight))
+    return TRUE;
+
+  g_mutex_lock (stream->lock);
+  if (!stream->flushing) {
+    g_get_current_time (&deadline);
+    g_time_val_add (&deadline, SS_TEXT_LINK_POLL_USEC);
+    g_cond_timed_wait (stream->cond, stream->lock, &deadline);
+  }
+  g_mutex_unlock (stream->lock);
+
+  for (i = 0; i < SS_STREAM_NUM; i++) {
+    GstSSDemuxStream *other = demux->streams[i];
+
+    if (other && other != stream && GST_CLOCK_TIME_IS_VALID (other->last_end))
+      position = GST_CLOCK_TIME_IS_VALID (position) ? MIN (position, other->last_end) : other->last_end;
+  }
+
+  if (GST_CLOCK_TIME_IS_VALID (position) &&
+      gst_ssm_parse_skip_fragments (demux->parser, stream->type, position))
+    GST_DEBUG_OBJECT (stream->pad, "not linked, text skipped to %" GST_TIME_FORMAT, GST_TIME_ARGS (position));
+
+  return FALSE;
+}
+
+/* payload of the mdat box of a text fragment, NULL when it has none */
+static GstBuffer *
+gst_ss_demux_text_payload (GstBuffer *fragment)
+{
+  const guint8 *data = GST_BUFFER_DATA (fragment);
+  guint size = GST_BUFFER_SIZE (fragment);
+  guint offset = 0;
+
+  while (offset + 8 <= size) {
+    guint64 box_size = GST_READ_UINT32_BE (data + offset);
+    guint header = 8;
+
+    if (box_size == 1) {
+      if (offset + 16 > size)
+        break;
+      box_size = GST_READ_UINT64_BE (data + offset + 8);
+      header = 16;
+    } else if (box_size == 0) {
+      box_size = size - offset;
+    }
+
+    if (box_size < header || box_size > size - offset)
+      break;
+
+    if (GST_READ_UINT32_LE (data + offset + 4) == GST_MAKE_FOURCC ('m', 'd', 'a', 't')) {
+      if (box_size == header)
+        return NULL;
+      return gst_buffer_create_sub (fragment, offset + header, box_size - header);
+    }
+
+    offset += box_size;
+  }
+
+  return NULL;
+}
+
+/* moves the segment of the sparse text stream up to @position, so that
+ * downstream does not wait for subtitles that are not there */
+static void
+gst_ss_demux_push_text_update (GstSSDemux *demux, GstSSDemuxStream *stream, GstClockTime position)
+{
+  if (!stream->sent_ns || !GST_CLOCK_TIME_IS_VALID (position))
+    return;
+
+  GST_LOG_OBJECT (stream->pad, "text update to %" GST_TIME_FORMAT, GST_TIME_ARGS (position));
+  gst_pad_push_event (stream->pad,
+      gst_event_new_new_segment (TRUE, 1.0, GST_FORMAT_TIME, position, -1, position));
+  stream->last_end = position;
+}
+
+/* text fragments are small, they are pushed as one buffer holding the
+ * payload. Empty or failed fragments only move the segment forward */
+static void
+gst_ss_demux_push_text (GstSSDemux *demux, GstSSDemuxStream *stream, GstSSDemuxFetcher *fetcher, GQueue *pending, gboolean done)
+{
+  GstBuffer *fragment = NULL;
+  GstBuffer *payload = NULL;
+  GstBuffer *buf = NULL;
+  GstClockTime duration = GST_CLOCK_TIME_NONE;
+
+  while ((buf = g_queue_pop_head (pending)))
+    fragment = fragment ? gst_buffer_join (fragment, buf) : buf;
+
+  if (fragment) {
+    if (done)
+      payload = gst_ss_demux_text_payload (fragment);
+    gst_buffer_unref (fragment);
+  }
+
+  duration = gst_ssm_parse_get_fragment_duration (demux->parser, stream->type, fetcher->start_ts);
+
+  if (payload) {
+    GST_BUFFER_TIMESTAMP (payload) = fetcher->start_ts;
+    GST_BUFFER_DURATION (payload) = duration;
+    gst_buffer_set_caps (payload, stream->caps);
+    gst_ss_demux_push_buffer (demux, stream, payload);
+  } else if (GST_CLOCK_TIME_IS_VALID (duration)) {
+    gst_ss_demux_push_text_update (demux, stream, fetcher->start_ts + duration);
+  }
+}
+
+/* pushes whatever the oldest in-flight fragment parsed so far. Fragments are
+ * drained strictly in window order, which is the timestamp order */
+static gboolean
+gst_ss_demux_drain_fetcher (GstSSDemux * demux, GstSSDemuxStream * stream, GstSSDemuxFetcher * fetcher)
+{
+  GQueue pending = G_QUEUE_INIT;
+  GstBuffer *buf = NULL;
+  GList *collected = NULL;
+  gboolean done = FALSE;
+  gboolean failed = FALSE;
+  gboolean flushing = FALSE;
+
+  g_mutex_lock (stream->lock);
+  if (g_queue_is_empty (fetcher->queue) && SS_FETCHER_IS_BUSY (fetcher) &&
+      !stream->flushing && stream->sent_first)
+    stream->n_stalls++;
+  /* a text fragment is only usable once completely downloaded */
+  while ((g_queue_is_empty (fetcher->queue) || stream->type == SS_STREAM_TEXT) &&
+      SS_FETCHER_IS_BUSY (fetcher) && !stream->flushing) {
+    if (gst_ss_demux_wait_event (stream)) {
+      g_mutex_unlock (stream->lock);
+      gst_ss_demux_retry_fetchers (demux, stream);
+      g_mutex_lock (stream->lock);
+    }
+  }
+
+  /* take the parsed samples, pushing is done without holding the lock */
+  while (!g_queue_is_empty (fetcher->queue))
+    g_queue_push_tail (&pending, g_queue_pop_head (fetcher->queue));
+  done = (fetcher->state == SS_FETCHER_DRAINING);
+  failed = (fetcher->state == SS_FETCHER_FAILED);
+  flushing = stream->flushing;
+  if (done && !flushing) {
+    collected = g_list_reverse (fetcher->collected);
+    fetcher->collected = NULL;
+  }
+  g_mutex_unlock (stream->lock);
+
+  if (collected) {
+    if (!gst_ss_demux_fetcher_cache (demux, fetcher, collected))
+      GST_DEBUG_OBJECT (stream->pad, "fragment %s not cached", fetcher->uri);
+  }
+
+  if (!flushing && stream->type == SS_STREAM_TEXT) {
+    /* missing subtitles must not stop the other streams, a failed text
+     * fragment is skipped */
+    gst_ss_demux_push_text (demux, stream, fetcher, &pending, done);
+    done = TRUE;
+    failed = FALSE;
+  }
+
+  if (!flushing && !g_queue_is_empty (&pending))
+    gst_ss_demux_mark_switch (demux, stream, FALSE);
+
+  while ((buf = g_queue_pop_head (&pending))) {
+    if (flushing) {
+      gst_buffer_unref (buf);
+      continue;
+    }
+
+    /* the first fragment of a new track starts before the switch position */
+    if (GST_CLOCK_TIME_IS_VALID (stream->resume_ts) && GST_BUFFER_TIMESTAMP_IS_VALID (buf)) {
+      if (GST_BUFFER_TIMESTAMP (buf) < stream->resume_ts) {
+        gst_buffer_unref (buf);
+        continue;
+      }
+      stream->resume_ts = GST_CLOCK_TIME_NONE;
+      buf = gst_buffer_make_metadata_writable (buf);
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+    }
+
+    gst_ss_demux_push_buffer (demux, stream, buf);
+  }
+
+  if (flushing)
+    return TRUE;
+
+  if (failed) {
+    /* error is already posted from the download bus */
+    GST_WARNING_OBJECT (stream->pad, "download of %s failed", fetcher->uri);
+    gst_ss_demux_stop (demux, stream);
+    return TRUE;
+  }
+
+  if (done) {
+    gst_ss_demux_fetcher_update_abr (demux, fetcher);
+
+    g_queue_pop_head (stream->inflight);
+    gst_ss_demux_fetcher_park (demux, fetcher);
+    g_queue_push_tail (stream->free_fetchers, fetcher);
+
+    // increase the fragment count once the fragment is completely pushed
+    stream->frag_cnt++;
+    GST_DEBUG_OBJECT (demux, "number of fragments downloaded = %d", stream->frag_cnt);
+  }
+
+  return TRUE;
+}
+
+/* in live audio-only mode the video fragment is fetched only to learn the
+ * next fragments of the live window, and placeholder frames are sent instead */
+static gboolean
+gst_ss_demux_fetch_aonly_fragment (GstSSDemux * demux, GstSSDemuxStream * stream)
+{
+  GstSSDemuxFetcher *fetcher = NULL;
+  gchar *next_fragment_uri = NULL;
+  guint64 start_ts = 0;
+  gboolean flushing = FALSE;
+
+  if (!gst_ssm_parse_get_next_fragment_url (demux->parser, stream->type, &next_fragment_uri, &start_ts, NULL)) {
+    if (GST_SSM_PARSE_IS_FLUSHING (demux->parser))
+      return TRUE;
+    GST_INFO_OBJECT (demux, "This Manifest does not contain more fragments");
+    gst_ss_demux_end_of_list (demux, stream);
+    return TRUE;
+  }
+
+  fetcher = g_queue_pop_head (stream->free_fetchers);
+  fetcher->discard = TRUE;
+  if (!gst_ss_demux_fetcher_start (demux, fetcher, next_fragment_uri, start_ts, 0)) {
+    GST_ERROR_OBJECT (demux, "failed to download fragment...");
+    g_queue_push_tail (stream->free_fetchers, fetcher);
+    return FALSE;
+  }
+
+  /* in flight while waiting, so a 412 retry of it is handled as usual */
+  g_queue_push_tail (stream->inflight, fetcher);
+
+  GST_DEBUG_OBJECT (demux, "Waiting for live params of %s", next_fragment_uri);
+  g_mutex_lock (stream->lock);
+  while (!fetcher->got_live_param && SS_FETCHER_IS_BUSY (fetcher) &&
+      !stream->flushing) {
+    if (gst_ss_demux_wait_event (stream)) {
+      g_mutex_unlock (stream->lock);
+      gst_ss_demux_retry_fetchers (demux, stream);
+      g_mutex_lock (stream->lock);
+    }
+  }
+  flushing = stream->flushing;
+  g_mutex_unlock (stream->lock);
+
+  g_queue_remove (stream->inflight, fetcher);
+
+  GST_INFO_OBJECT (stream->pad, "Recived signal to shutdown...");
+  gst_ss_demux_fetcher_park (demux, fetcher);
+  g_queue_push_tail (stream->free_fetchers, fetcher);
+
+  if (flushing)
+    return TRUE;
+
+  if (!gst_ss_demux_send_filler (demux, stream, start_ts)) {
+    GST_ERROR_OBJECT (demux, "failed to send placeholder frames...");
+    GST_ELEMENT_ERROR (demux, RESOURCE, FAILED, ("Unable to send placeholder frames."), (NULL));
+    return FALSE;
+  }
+
+  stream->frag_cnt++;
+
+  return TRUE;
+}
+
+/* parks the fragments in flight & drops the samples cached for startup,
+ * must be called with the stream lock (the task is not in its loop) */
+static void
+gst_ss_demux_drop_fragments (GstSSDemux *demux, GstSSDemuxStream *stream)
+{
+  while (!g_queue_is_empty (stream->inflight)) {
+    GstSSDemuxFetcher *fetcher = g_queue_pop_head (stream->inflight);
+
+    gst_ss_demux_fetcher_park (demux, fetcher);
+    g_queue_push_tail (stream->free_fetchers, fetcher);
+  }
+  while (!g_queue_is_empty (stream->queue))
+    gst_buffer_unref (g_queue_pop_head (stream->queue));
+  stream->queued_bytes = 0;
+  stream->queued_dur = 0;
+}
+
+/* "audio-track" setter, the switch itself is done by the audio stream task */
+static void
+gst_ss_demux_set_audio_track (GstSSDemux *demux, guint track)
+{
+  GstSSDemuxStream *stream = demux->streams[SS_STREAM_AUDIO];
+
+  if (demux->parser && GST_SSM_PARSE_IS_COMPLETE (demux->parser) &&
+      track >= gst_ssm_parse_get_n_streams (demux->parser, SS_STREAM_AUDIO)) {
+    GST_WARNING_OBJECT (demux, "no audio track %u in manifest", track);
+    return;
+  }
+
+  GST_OBJECT_LOCK (demux);
+  demux->audio_track = track;
+  GST_OBJECT_UNLOCK (demux);
+
+  GST_INFO_OBJECT (demux, "audio track %u requested", track);
+
+  if (!stream)
+    return;
+
+  /* wake up the task, the samples of the old track still queued are dropped */
+  g_mutex_lock (stream->lock);
+  if (track != stream->track) {
+    stream->flushing = TRUE;
+    g_cond_signal (stream->cond);
+  }
+  g_mutex_unlock (stream->lock);
+}
+
+/* moves the audio stream to the track requested through "audio-track". The
+ * fragments of the old track in flight are dropped & the new track is
+ * fetched from the fragment containing the first sample not pushed yet, so
+ * it takes over within a fragment duration */
+static void
+gst_ss_demux_switch_track (GstSSDemux *demux, GstSSDemuxStream *stream)
+{
+  GstClockTime position = GST_CLOCK_TIME_NONE;
+  GstCaps *caps = NULL;
+  guint track = 0;
+
+  GST_OBJECT_LOCK (demux);
+  track = demux->audio_track;
+  GST_OBJECT_UNLOCK (demux);
+
+  if (track == stream->track)
+    return;
+
+  if (!g_queue_is_empty (stream->queue))
+    position = GST_BUFFER_TIMESTAMP ((GstBuffer *) g_queue_peek_head (stream->queue));
+  if (!GST_CLOCK_TIME_IS_VALID (position))
+    position = stream->last_end;
+  if (!GST_CLOCK_TIME_IS_VALID (position))
+    position = gst_util_uint64_scale (GST_SSM_PARSE_NS_START (demux->parser), GST_SECOND,
+        GST_SSM_PARSE_GET_TIMESCALE (demux->parser));
+
+  GST_INFO_OBJECT (stream->pad, "switching from audio track %u to %u at %" GST_TIME_FORMAT,
+      stream->track, track, GST_TIME_ARGS (position));
+
+  /* startup caching starts over with the new track */
+  if (!g_queue_is_empty (stream->queue))
+    stream->frag_cnt = 0;
+  gst_ss_demux_drop_fragments (demux, stream);
+
+  if (!gst_ssm_parse_select_stream (demux->parser, stream->type, track, position)) {
+    GST_WARNING_OBJECT (stream->pad, "failed to select audio track %u, staying on %u", track, stream->track);
+    GST_OBJECT_LOCK (demux);
+    if (demux->audio_track == track)
+      demux->audio_track = stream->track;
+    GST_OBJECT_UNLOCK (demux);
+    /* the old track goes on from where it was dropped */
+    gst_ssm_parse_select_stream (demux->parser, stream->type, stream->track, position);
+    track = stream->track;
+  }
+
+  /* another codec or sampling rate is possible */
+  caps = ssm_parse_get_stream_caps (demux->parser, stream->type);
+  if (caps && (!stream->caps || !gst_caps_is_equal (caps, stream->caps))) {
+    GST_DEBUG_OBJECT (stream->pad, "setting caps %" GST_PTR_FORMAT, caps);
+    gst_caps_replace (&stream->caps, caps);
+    gst_pad_set_caps (stream->pad, stream->caps);
+  }
+  if (caps)
+    gst_caps_unref (caps);
+
+  g_mutex_lock (stream->lock);
+  stream->track = track;
+  stream->resume_ts = position;
+  stream->flushing = FALSE;
+  g_mutex_unlock (stream->lock);
+}
+
+static void
+gst_ss_demux_stream_loop (GstSSDemux * demux)
+{
+  GThread *self = NULL;
+  int stream_type = 0;
+  GstSSDemuxStream *stream = NULL;
+
+  self = g_thread_self ();
+
+  for (stream_type = 0; stream_type < SS_STREAM_NUM; stream_type++) {
+    if (demux->streams[stream_type] &&
+        demux->streams[stream_type]->stream_task->abidata.ABI.thread == self) {
+      stream = demux->streams[stream_type];
+      break;
+    }
+  }
+
+  if (!stream)
+    return;
+
+  if (stream->type == SS_STREAM_AUDIO)
+    gst_ss_demux_switch_track (demux, stream);
+
+  if (stream->type == SS_STREAM_VIDEO && demux->ss_mode == SS_MODE_AONLY &&
+      g_queue_is_empty (stream->inflight)) {
+    if (!gst_ss_demux_fetch_aonly_fragment (demux, stream))
+      goto error;
+    return;
+  }
+
+  if (stream->type == SS_STREAM_TEXT && !gst_ss_demux_text_wanted (demux, stream))
+    return;
+
+  /* keep the prefetch window full & push the oldest fragment in order */
+  if (!gst_ss_demux_fill_window (demux, stream)) {
+    GST_ERROR_OBJECT (demux, "failed to get next fragment...");
+    goto error;
+  }
+
+  if (g_queue_is_empty (stream->inflight))
+    return;
+
+  if (!gst_ss_demux_drain_fetcher (demux, stream, g_queue_peek_head (stream->inflight)))
+    goto error;
+
+  gst_ss_demux_post_stats (demux);
+
+  return;
+
+error:
+  {
+    gst_task_pause (stream->stream_task);
+    GST_ELEMENT_ERROR (demux, RESOURCE, NOT_FOUND,
+          ("could not download fragments"), (NULL));
+      gst_ss_demux_stop (demux, stream);
+    return;
+  }
+}
+
+static gboolean
+gst_ss_demux_fetcher_start (GstSSDemux *demux, GstSSDemuxFetcher *fetcher, gchar * uri, guint64 start_ts, guint bitrate)
+{
+  GstSSDemuxStream *stream = fetcher->stream;
+  GstStateChangeReturn ret;
+  GstClockTime setup_start = gst_util_get_timestamp ();
+  GList *cached = NULL;
+
+  g_free (fetcher->uri);
+  fetcher->uri = uri;
+  fetcher->start_ts = start_ts;
+  fetcher->bitrate = bitrate;
+
+  if (demux->frag_cache && !fetcher->discard)
+    cached = gst_ss_fragment_cache_lookup (demux->frag_cache, stream->type, stream->track, bitrate, start_ts);
+
+  g_mutex_lock (stream->lock);
+  fetcher->state = SS_FETCHER_FETCHING;
+  fetcher->retry_at = GST_CLOCK_TIME_NONE;
+  fetcher->n_retries = 0;
+  fetcher->fetch_start = gst_util_get_timestamp ();
+  fetcher->download_rate = 0;
+  fetcher->got_live_param = FALSE;
+  if (cached) {
+    GList *walk = NULL;
+
+    /* fragment is already parsed, no need to download it again */
+    for (walk = cached; walk; walk = g_list_next (walk))
+      g_queue_push_tail (fetcher->queue, walk->data);
+    fetcher->state = SS_FETCHER_DRAINING;
+    g_cond_signal (stream->cond);
+  }
+  g_mutex_unlock (stream->lock);
+
+  if (cached) {
+    GST_DEBUG_OBJECT (stream->pad, "fragment %s served from cache", uri);
+    g_list_free (cached);
+    return TRUE;
+  }
+
+  g_print ("Going to download fragment : %s\n", uri);
+
+  /* download pipe is built once per fetcher and only re-armed per fragment */
+  if (!fetcher->pipe && !gst_ss_demux_create_download_pipe (demux, fetcher, uri)) {
+    GST_ERROR_OBJECT (demux, "failed to create download pipeline");
+    return FALSE;
+  }
+
+  if (!gst_ss_demux_rearm_download_pipe (demux, fetcher, uri, start_ts)) {
+    GST_ERROR_OBJECT (demux, "failed to re-arm download pipeline");
+    return FALSE;
+  }
+
+  ret = gst_element_set_state (fetcher->pipe, GST_STATE_PLAYING);
+  if (ret == GST_STATE_CHANGE_FAILURE) {
+    GST_ERROR_OBJECT (demux, "set_state failed...");
+    return FALSE;
+  }
+
+  GST_DEBUG_OBJECT (stream->pad, "fragment setup took %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (gst_util_get_timestamp () - setup_start));
+
+  return TRUE;
+}
+
+/* parks the download pipe of a fetcher in READY & drops leftovers */
+static void
+gst_ss_demux_fetcher_park (GstSSDemux *demux, GstSSDemuxFetcher *fetcher)
+{
+  GstSSDemuxStream *stream = fetcher->stream;
+
+  if (fetcher->pipe) {
+    /* once in READY no streaming thread is left to report on the old fragment */
+    gst_element_set_state (fetcher->pipe, GST_STATE_READY);
+    gst_element_get_state (fetcher->pipe, NULL, NULL, GST_CLOCK_TIME_NONE);
+  }
+
+  g_mutex_lock (stream->lock);
+  fetcher->state = SS_FETCHER_IDLE;
+  while (!g_queue_is_empty (fetcher->queue))
+    gst_buffer_unref (g_queue_pop_head (fetcher->queue));
+  g_list_foreach (fetcher->collected, (GFunc) gst_buffer_unref, NULL);
+  g_list_free (fetcher->collected);
+  fetcher->collected = NULL;
+  fetcher->discard = FALSE;
+  g_mutex_unlock (stream->lock);
+}
+
+/* hands the samples of a completely downloaded fragment to the cache */
+static gboolean
+gst_ss_demux_fetcher_cache (GstSSDemux *demux, GstSSDemuxFetcher *fetcher, GList *buffers)
+{
+  GstSSDemuxStream *stream = fetcher->stream;
+  guint64 hits = 0, misses = 0, evictions = 0, bytes = 0;
+  gboolean ret = FALSE;
+
+  ret = gst_ss_fragment_cache_insert (demux->frag_cache, stream->type, stream->track, fetcher->bitrate, fetcher->start_ts, buffers);
+
+  gst_ss_fragment_cache_get_stats (demux->frag_cache, &hits, &misses, &evictions, &bytes);
+  GST_LOG_OBJECT (stream->pad, "fragment cache : hits = %"G_GUINT64_FORMAT", misses = %"G_GUINT64_FORMAT
+      ", evictions = %"G_GUINT64_FORMAT", bytes = %"G_GUINT64_FORMAT, hits, misses, evictions, bytes);
+
+  return ret;
+}
+
+/* adds one access unit of the placeholder clip to the filler frames */
+static void
+gst_ss_demux_add_filler_frame (GstSSDemuxStream *stream, guint offset, guint size, gboolean keyframe)
+{
+  GstBuffer *frame = gst_buffer_create_sub (stream->filler_data, offset, size);
+
+  if (!keyframe)
+    GST_BUFFER_FLAG_SET (frame, GST_BUFFER_FLAG_DELTA_UNIT);
+  g_ptr_array_add (stream->filler_frames, frame);
+}
+
+/* splits the placeholder clip (H.264 byte-stream) into access units, so the
+ * frames can be restamped one by one without a parser element */
+static void
+gst_ss_demux_split_filler (GstSSDemuxStream *stream)
+{
+  const guint8 *data = GST_BUFFER_DATA (stream->filler_data);
+  guint size = GST_BUFFER_SIZE (stream->filler_data);
+  guint au_start = 0;
+  guint pos = 0;
+  gboolean has_vcl = FALSE;
+  gboolean keyframe = FALSE;
+
+  while (pos + 3 < size) {
+    guint nal_start = 0;
+    guint8 nal_type = 0;
+
+    if (data[pos] || data[pos + 1] || data[pos + 2] != 1) {
+      pos++;
+      continue;
+    }
+
+    nal_start = (pos && !data[pos - 1]) ? pos - 1 : pos;
+    nal_type = data[pos + 3] & 0x1f;
+
+    /* SEI/SPS/PPS/AUD or a slice with first_mb_in_slice == 0 after a slice
+     * starts the next access unit */
+    if (has_vcl && ((nal_type >= 6 && nal_type <= 9) ||
+        ((nal_type == 1 || nal_type == 5) && pos + 4 < size && (data[pos + 4] & 0x80)))) {
+      gst_ss_demux_add_filler_frame (stream, au_start, nal_start - au_start, keyframe);
+      au_start = nal_start;
+      has_vcl = FALSE;
+      keyframe = FALSE;
+    }
+
+    if (nal_type == 1 || nal_type == 5)
+      has_vcl = TRUE;
+    if (nal_type == 5)
+      keyframe = TRUE;
+
+    pos += 3;
+  }
+
+  if (has_vcl)
+    gst_ss_demux_add_filler_frame (stream, au_start, size - au_start, keyframe);
+}
+
+/* placeholder clip is read & split once, the frames are re-used for every
+ * audio-only fragment */
+static gboolean
+gst_ss_demux_load_filler (GstSSDemux *demux, GstSSDemuxStream *stream)
+{
+  gchar *contents = NULL;
+  gsize length = 0;
+  GError *err = NULL;
+
+  if (stream->filler_frames)
+    return stream->filler_frames->len > 0;
+
+  if (!demux->placeholder_location ||
+      !g_file_get_contents (demux->placeholder_location, &contents, &length, &err)) {
+    GST_ERROR_OBJECT (demux, "failed to load placeholder clip '%s' : %s",
+        GST_STR_NULL (demux->placeholder_location), err ? err->message : "no location");
+    g_clear_error (&err);
+    return FALSE;
+  }
+
+  stream->filler_data = gst_buffer_new ();
+  GST_BUFFER_MALLOCDATA (stream->filler_data) = (guint8 *) contents;
+  GST_BUFFER_DATA (stream->filler_data) = (guint8 *) contents;
+  GST_BUFFER_SIZE (stream->filler_data) = length;
+
+  stream->filler_frames = g_ptr_array_new ();
+  gst_ss_demux_split_filler (stream);
+
+  stream->filler_caps = gst_caps_new_simple ("video/x-h264",
+                  "width", G_TYPE_INT, 640,
+                  "height", G_TYPE_INT, 480,
+                  "stream-format", G_TYPE_STRING, "byte-stream",
+                  NULL);
+
+  GST_INFO_OBJECT (stream->pad, "placeholder clip '%s' : %" G_GSIZE_FORMAT " bytes, %u frames",
+      demux->placeholder_location, length, stream->filler_frames->len);
+
+  return stream->filler_frames->len > 0;
+}
+
+static void
+gst_ss_demux_clear_filler (GstSSDemuxStream *stream)
+{
+  if (stream->filler_frames) {
+    g_ptr_array_foreach (stream->filler_frames, (GFunc) gst_buffer_unref, NULL);
+    g_ptr_array_free (stream->filler_frames, TRUE);
+    stream->filler_frames = NULL;
+  }
+  if (stream->filler_data) {
+    gst_buffer_unref (stream->filler_data);
+    stream->filler_data = NULL;
+  }
+  if (stream->filler_caps) {
+    gst_caps_unref (stream->filler_caps);
+    stream->filler_caps = NULL;
+  }
+}
+
+/* the video pad goes from fragments to placeholder frames or back, records
+ * the time since the ABR engine asked for it */
+static void
+gst_ss_demux_mark_switch (GstSSDemux *demux, GstSSDemuxStream *stream, gboolean filling)
+{
+  GstClockTime latency = GST_CLOCK_TIME_NONE;
+
+  if (stream->filling == filling)
+    return;
+  stream->filling = filling;
+
+  GST_OBJECT_LOCK (demux);
+  if (GST_CLOCK_TIME_IS_VALID (demux->switch_requested)) {
+    latency = gst_util_get_timestamp () - demux->switch_requested;
+    demux->switch_latency = latency;
+    demux->switch_requested = GST_CLOCK_TIME_NONE;
+  }
+  GST_OBJECT_UNLOCK (demux);
+
+  GST_INFO_OBJECT (stream->pad, "switched to %s, latency = %" GST_TIME_FORMAT,
+      filling ? "placeholder frames" : "video fragments", GST_TIME_ARGS (latency));
+}
+
+/* sends placeholder frames in place of the video fragment at @start_ts, at
+ * the frame duration measured by piffdemux so the next real fragment follows
+ * without a gap */
+static gboolean
+gst_ss_demux_send_filler (GstSSDemux *demux, GstSSDemuxStream *stream, guint64 start_ts)
+{
+  GstClockTime frame_dur = stream->avg_dur;
+  GstClockTime frag_dur = GST_CLOCK_TIME_NONE;
+  GstClockTime ts = start_ts;
+  guint i = 0;
+
+  if (!gst_ss_demux_load_filler (demux, stream))
+    return FALSE;
+
+  if (!GST_CLOCK_TIME_IS_VALID (frame_dur) || !frame_dur)
+    frame_dur = DEFAULT_FILLER_FRAME_DURATION;
+
+  frag_dur = gst_ssm_parse_get_fragment_duration (demux->parser, stream->type, start_ts);
+  if (!GST_CLOCK_TIME_IS_VALID (frag_dur))
+    frag_dur = frame_dur * stream->filler_frames->len;
+
+  gst_ss_demux_mark_switch (demux, stream, TRUE);
+
+  /* every fragment starts again from the first (key) frame of the clip */
+  for (i = 0; ts < start_ts + frag_dur; i = (i + 1) % stream->filler_frames->len) {
+    GstBuffer *frame = g_ptr_array_index (stream->filler_frames, i);
+    GstBuffer *buf = NULL;
+    GstFlowReturn fret = GST_FLOW_OK;
+    gboolean flushing = FALSE;
+
+    g_mutex_lock (stream->lock);
+    flushing = stream->flushing;
+    g_mutex_unlock (stream->lock);
+    if (flushing)
+      break;
+
+    /* shares the clip memory, only the metadata is per frame */
+    buf = gst_buffer_create_sub (frame, 0, GST_BUFFER_SIZE (frame));
+    if (GST_BUFFER_FLAG_IS_SET (frame, GST_BUFFER_FLAG_DELTA_UNIT))
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+    GST_BUFFER_TIMESTAMP (buf) = ts;
+    GST_BUFFER_DURATION (buf) = MIN (frame_dur, start_ts + frag_dur - ts);
+    gst_buffer_set_caps (buf, stream->filler_caps);
+    ts += GST_BUFFER_DURATION (buf);
+
+    GST_LOG_OBJECT (stream->pad, "placeholder frame ts : %"GST_TIME_FORMAT" and dur : %"GST_TIME_FORMAT,
+        GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buf)), GST_TIME_ARGS (GST_BUFFER_DURATION (buf)));
+
+    fret = gst_ss_demux_push_buffer (demux, stream, buf);
+    if (fret != GST_FLOW_OK)
+      break;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_ss_demux_append_live_params(GstElement *piffparser, piff_live_param_t *param, gpointer data)
+{
+  GstSSDemuxFetcher *fetcher = (GstSSDemuxFetcher *)data;
+  GstSSDemuxStream *stream = fetcher->stream;
+  GstSSDemux *demux = stream->parent;
+  int i =0;
+  guint64 timestamp = 0;
+  guint64 duration = 0;
+
+  GST_LOG_OBJECT (demux, "received signal structs count = %d\n", param->count);
+
+  for (i = 0 ; i< param->count; i++) {
+    if (param->long_info) {
+      piff_fragment_longtime_info *info = &(param->long_info[i]);
+      timestamp = info->ts;
+      duration = info->duration;
+    } else if (param->info) {
+      piff_fragment_time_info *info = &(param->info[i]);
+      timestamp = info->ts;
+      duration = info->duration;
+    }
+
+    GST_LOG_OBJECT (demux, "Received ts = %llu and dur = %llu\n", timestamp, duration);
+
+    if (!gst_ssm_parse_append_next_fragment (demux->parser, stream->type, timestamp, duration)) {
+      GST_ERROR_OBJECT (demux, "failed to append new fragment");
+      GST_ELEMENT_ERROR (demux, RESOURCE, NO_SPACE_LEFT, ("fragment allocation failed..."), (NULL));
+      return;
     }
   }
 
@@ -700,288 +2210,362 @@ gst_ss_demux_append_live_params(GstElement *piffparser, piff_live_param_t *param
   if ((stream->type == SS_STREAM_VIDEO) && (demux->ss_mode == SS_MODE_AONLY)) {
     g_print ("\n\n\t\tSignalling download pipe shutdonw....\n\n");
 
-    g_object_get (stream->parser, "frame-dur", &stream->avg_dur, NULL);
+    g_object_get (fetcher->parser, "frame-dur", &stream->avg_dur, NULL);
     g_print ("frame duration = %"GST_TIME_FORMAT"\n\n\n", GST_TIME_ARGS(stream->avg_dur));
+    g_mutex_lock (stream->lock);
+    fetcher->got_live_param = TRUE;
     g_cond_signal (stream->cond);
+    g_mutex_unlock (stream->lock);
   }
 
 }
 
 static gboolean
-gst_ss_demux_create_download_pipe (GstSSDemux * demux, GstSSDemuxStream *stream, const gchar * uri, guint64 start_ts)
+gst_ss_demux_create_download_pipe (GstSSDemux * demux, GstSSDemuxFetcher *fetcher, const gchar * uri)
 {
+  GstSSDemuxStream *stream = fetcher->stream;
   gchar *name = NULL;
-  GstCaps *caps = NULL;
+  GstBus *bus = NULL;
+  GstPad *srcpad = NULL;
 
   if (!gst_uri_is_valid (uri))
     return FALSE;
 
-  name = g_strdup_printf("%s-%s", stream->name, "downloader");
+  name = g_strdup_printf("%s-%s-%u", stream->name, "downloader", fetcher->id);
 
-  stream->pipe = gst_pipeline_new (name);
-  if (!stream->pipe) {
+  fetcher->pipe = gst_pipeline_new (name);
+  if (!fetcher->pipe) {
     GST_ERROR_OBJECT (demux, "failed to create pipeline");
-    return FALSE;
+    goto error;
   }
   g_free(name);
+  name = NULL;
 
   name = g_strdup_printf("%s-%s", stream->name, "httpsrc");
   GST_DEBUG ("Creating source element for the URI:%s", uri);
-  stream->urisrc = gst_element_make_from_uri (GST_URI_SRC, uri, name);
-  if (!stream->urisrc) {
+  fetcher->urisrc = gst_element_make_from_uri (GST_URI_SRC, uri, name);
+  if (!fetcher->urisrc) {
     GST_ERROR_OBJECT (demux, "failed to create urisrc");
-    return FALSE;
+    goto error;
   }
   g_free(name);
+  name = NULL;
 
   if (GST_SSM_PARSE_IS_LIVE_PRESENTATION(demux->parser))
-    g_object_set (G_OBJECT (stream->urisrc), "is-live", TRUE, NULL);
+    g_object_set (G_OBJECT (fetcher->urisrc), "is-live", TRUE, NULL);
   else
-    g_object_set (G_OBJECT (stream->urisrc), "is-live", FALSE, NULL);
+    g_object_set (G_OBJECT (fetcher->urisrc), "is-live", FALSE, NULL);
 
-  name = g_strdup_printf("%s-%s", stream->name, "parser");
-  stream->parser = gst_element_factory_make ("piffdemux", name);
-  if (!stream->parser) {
-    GST_ERROR_OBJECT (demux, "failed to create piffdemux element");
-    return FALSE;
-  }
+  gst_bin_add (GST_BIN (fetcher->pipe), fetcher->urisrc);
 
-  caps = ssm_parse_get_stream_caps (demux->parser, stream->type);
-  GST_INFO_OBJECT (stream->pad, "prepare caps = %s", gst_caps_to_string(caps));
+  /* text fragments are taken as downloaded, the payload is extracted in
+   * gst_ss_demux_push_text() */
+  if (stream->type != SS_STREAM_TEXT) {
+    name = g_strdup_printf("%s-%s", stream->name, "parser");
+    fetcher->parser = gst_element_factory_make ("piffdemux", name);
+    if (!fetcher->parser) {
+      GST_ERROR_OBJECT (demux, "failed to create piffdemux element");
+      goto error;
+    }
 
-  g_object_set (G_OBJECT (stream->parser), "caps", caps, NULL);
-  g_object_set (G_OBJECT (stream->parser), "start-ts", start_ts, NULL);
-  g_object_set (G_OBJECT (stream->parser), "duration", GST_SSM_PARSE_GET_DURATION(demux->parser), NULL);
-  g_object_set (G_OBJECT (stream->parser), "is-live", GST_SSM_PARSE_IS_LIVE_PRESENTATION(demux->parser), NULL);
-  g_object_set (G_OBJECT (stream->parser), "lookahead-count", GST_SSM_PARSE_LOOKAHEAD_COUNT(demux->parser), NULL);
-  g_signal_connect (stream->parser, "live-param",  G_CALLBACK (gst_ss_demux_append_live_params), stream);
+    /* caps & start-ts are per fragment, see gst_ss_demux_rearm_download_pipe() */
+    g_object_set (G_OBJECT (fetcher->parser), "duration", GST_SSM_PARSE_GET_DURATION(demux->parser), NULL);
+    g_object_set (G_OBJECT (fetcher->parser), "is-live", GST_SSM_PARSE_IS_LIVE_PRESENTATION(demux->parser), NULL);
+    g_object_set (G_OBJECT (fetcher->parser), "lookahead-count", GST_SSM_PARSE_LOOKAHEAD_COUNT(demux->parser), NULL);
+    g_signal_connect (fetcher->parser, "live-param",  G_CALLBACK (gst_ss_demux_append_live_params), fetcher);
 
-  g_free(name);
+    g_free(name);
+    name = NULL;
 
-  name = g_strdup_printf("%s-%s", stream->name, "sink");
-  stream->sink = gst_element_factory_make ("appsink", name);
-  if (!stream->sink) {
-    GST_ERROR_OBJECT (demux, "failed to create appsink element");
-    return FALSE;
+    gst_bin_add (GST_BIN (fetcher->pipe), fetcher->parser);
+    if (!gst_element_link (fetcher->urisrc, fetcher->parser)) {
+      GST_ERROR ("failed to link elements...");
+      goto error;
+    }
   }
-  g_object_set (G_OBJECT (stream->sink), "emit-signals", TRUE, "sync", FALSE, NULL);
-  g_signal_connect (stream->sink, "new-buffer",  G_CALLBACK (gst_ssm_demux_on_new_buffer), stream);
 
+  /* parsed samples are chained straight into the demuxer from the piffdemux
+   * streaming thread, there is no sink element in the download pipe */
+  name = g_strdup_printf("%s-%s-%u", stream->name, "proxy", fetcher->id);
+  fetcher->sinkpad = gst_pad_new (name, GST_PAD_SINK);
   g_free(name);
-
-  gst_bin_add_many (GST_BIN (stream->pipe), stream->urisrc, stream->parser, stream->sink, NULL);
-  if (!gst_element_link_many (stream->urisrc, stream->parser, stream->sink, NULL)) {
-    GST_ERROR ("failed to link elements...");
-    return FALSE;
+  name = NULL;
+  gst_pad_set_element_private (fetcher->sinkpad, fetcher);
+  gst_pad_set_chain_function (fetcher->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_ss_demux_fetcher_chain));
+  gst_pad_set_event_function (fetcher->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_ss_demux_fetcher_sink_event));
+  gst_pad_set_active (fetcher->sinkpad, TRUE);
+
+  srcpad = gst_element_get_static_pad (fetcher->parser ? fetcher->parser : fetcher->urisrc, "src");
+  if (!srcpad || GST_PAD_LINK_FAILED (gst_pad_link (srcpad, fetcher->sinkpad))) {
+    GST_ERROR_OBJECT (demux, "failed to link the download pipe to the proxy pad");
+    if (srcpad)
+      gst_object_unref (srcpad);
+    goto error;
   }
+  gst_object_unref (srcpad);
 
-  stream->bus = gst_pipeline_get_bus (GST_PIPELINE (stream->pipe));
-  gst_bus_add_watch (stream->bus, (GstBusFunc)gst_ss_demux_download_bus_cb, stream);
-  gst_object_unref (stream->bus);
+  /* messages are handled in the posting thread, no main loop is needed */
+  bus = gst_pipeline_get_bus (GST_PIPELINE (fetcher->pipe));
+  gst_bus_set_sync_handler (bus, (GstBusSyncHandler)gst_ss_demux_download_bus_cb, fetcher);
+  gst_object_unref (bus);
 
   return TRUE;
+
+error:
+  /* a half built pipe must not be re-armed by the next fragment, the
+   * fetcher builds it again from scratch */
+  g_free (name);
+  gst_ss_demux_destroy_download_pipe (demux, fetcher);
+  return FALSE;
 }
 
-#if 0
-static gboolean
-gst_ss_demux_create_dummy_pipe (GstSSDemux * demux, GstSSDemuxStream *stream)
+static void
+gst_ss_demux_destroy_download_pipe (GstSSDemux * demux, GstSSDemuxFetcher *fetcher)
 {
-  gchar *name = NULL;
-  GstCaps *caps = NULL;
-  GstElement *capsfilter = NULL;
-  GstElement *enc = NULL;
-  guint64 avg_dur = -1;
-  guint frame_rate = 0;
+  if (!fetcher->pipe)
+    return;
 
-  name = g_strdup_printf("%s-%s", stream->name, "dummy");
+  gst_element_set_state (fetcher->pipe, GST_STATE_NULL);
+  gst_element_get_state (fetcher->pipe, NULL, NULL, GST_CLOCK_TIME_NONE);
 
-  stream->pipe = gst_pipeline_new (name);
-  if (!stream->pipe) {
-    GST_ERROR_OBJECT (demux, "failed to create pipeline");
-    return FALSE;
-  }
-  g_free(name);
+  if (fetcher->sinkpad) {
+    GstPad *srcpad = gst_pad_get_peer (fetcher->sinkpad);
 
-  /* create dummy sender source */
-  name = g_strdup_printf("%s-%s", stream->name, "dummysrc");
-  stream->urisrc = gst_element_factory_make ("imagereader", name);
-  if (!stream->urisrc) {
-    GST_ERROR_OBJECT (demux,"failed to create filesrc element");
-    return FALSE;
+    if (srcpad) {
+      gst_pad_unlink (srcpad, fetcher->sinkpad);
+      gst_object_unref (srcpad);
+    }
+    gst_pad_set_active (fetcher->sinkpad, FALSE);
+    gst_object_unref (fetcher->sinkpad);
+    fetcher->sinkpad = NULL;
   }
-  g_free(name);
-  g_object_set (G_OBJECT (stream->urisrc), "location", "/opt/home/root/aonly_VGA_1frame_I420.yuv", NULL);
-  g_object_set (G_OBJECT (stream->urisrc), "framerate", 25, NULL);
-  g_object_set (G_OBJECT (stream->urisrc), "num-buffers", 60, NULL);
-
-  /* caps filter */
-  capsfilter = gst_element_factory_make ("capsfilter", NULL);
-  if (!capsfilter) {
-    GST_ERROR_OBJECT (demux, "failed to create capsfilter element");
+
+  gst_object_unref (fetcher->pipe);
+  fetcher->pipe = fetcher->urisrc = fetcher->parser = NULL;
+}
+
+/* points the persistent download pipe to the next fragment. The pipe is
+ * brought back to READY so urisrc & piffdemux drop their per-fragment state,
+ * while the elements, links & bus handler stay alive for the whole session */
+static gboolean
+gst_ss_demux_rearm_download_pipe (GstSSDemux * demux, GstSSDemuxFetcher *fetcher, const gchar * uri, guint64 start_ts)
+{
+  GstSSDemuxStream *stream = fetcher->stream;
+  GstCaps *caps = NULL;
+
+  if (!gst_uri_is_valid (uri))
     return FALSE;
-  }
-  caps = gst_caps_new_simple ("video/x-raw-yuv",
-                  "width", G_TYPE_INT, 640,
-                  "height", G_TYPE_INT, 480,
-                  "framerate",GST_TYPE_FRACTION, 25,1,
-                  "format", GST_TYPE_FOURCC, GST_MAKE_FOURCC ('I', '4', '2', '0'),
-                  NULL);
-  g_object_set (G_OBJECT (capsfilter), "caps", caps,  NULL);
 
-  /* create h264parse element */
-  enc = gst_element_factory_make ("savsenc_h264", "H264 encoder");
-  if (!enc) {
-    GST_ERROR_OBJECT (demux, "failed to create h264 parse element");
+  if (gst_element_set_state (fetcher->pipe, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE) {
+    GST_ERROR_OBJECT (demux, "failed to put download pipe to READY");
     return FALSE;
   }
-  name = g_strdup_printf("%s-%s", stream->name, "sink");
-  stream->sink = gst_element_factory_make ("appsink", name);
-  if (!stream->sink) {
-    GST_ERROR_OBJECT (demux, "failed to create appsink element");
-    return FALSE;
+
+  if (!gst_uri_handler_set_uri (GST_URI_HANDLER (fetcher->urisrc), uri)) {
+    /* e.g. protocol changed in between fragments, fallback to a new pipe */
+    GST_WARNING_OBJECT (demux, "'%s' refused uri %s, rebuilding download pipe",
+        GST_ELEMENT_NAME (fetcher->urisrc), uri);
+    gst_ss_demux_destroy_download_pipe (demux, fetcher);
+    if (!gst_ss_demux_create_download_pipe (demux, fetcher, uri))
+      return FALSE;
   }
-  g_free(name);
-  g_object_set (G_OBJECT (stream->sink), "emit-signals", TRUE, "sync", FALSE, NULL);
-  g_signal_connect (stream->sink, "new-buffer",  G_CALLBACK (gst_ssm_demux_on_new_buffer), stream);
 
-  /* add to pipeline & link all elements */
-  gst_bin_add_many (GST_BIN (stream->pipe), stream->urisrc, capsfilter, enc, stream->sink, NULL);
+  if (!fetcher->parser)
+    return TRUE;
 
-  if (!gst_element_link_many (stream->urisrc, capsfilter, enc, stream->sink, NULL)) {
-    GST_ERROR_OBJECT (demux,"failed to link dummy pipe elements...");
-    return FALSE;
-  }
+  caps = ssm_parse_get_stream_caps (demux->parser, stream->type);
+  GST_INFO_OBJECT (stream->pad, "prepare caps = %" GST_PTR_FORMAT, caps);
 
-  stream->bus = gst_pipeline_get_bus (GST_PIPELINE (stream->pipe));
-  gst_bus_add_watch (stream->bus, (GstBusFunc)gst_ss_demux_download_bus_cb, stream);
-  gst_object_unref (stream->bus);
+  g_object_set (G_OBJECT (fetcher->parser), "caps", caps, NULL);
+  g_object_set (G_OBJECT (fetcher->parser), "start-ts", start_ts, NULL);
+
+  if (caps)
+    gst_caps_unref (caps);
 
   return TRUE;
 }
-#else
-static gboolean
-gst_ss_demux_create_dummy_pipe (GstSSDemux * demux, GstSSDemuxStream *stream)
+
+/* media time buffered ahead of playback: startup queue of the demuxer plus
+ * what was pushed downstream & not played yet */
+static GstClockTime
+gst_ss_demux_get_buffered_duration (GstSSDemux *demux, GstSSDemuxStream *stream)
 {
-  gchar *name = NULL;
-  GstBus *bus = NULL;
-  GstCaps *caps = NULL;
+  GstFormat fmt = GST_FORMAT_TIME;
+  gint64 pos = -1;
+  GstClockTime buffered = stream->queued_dur;
+  GstClockTime last_end = stream->last_end;
 
-  name = g_strdup_printf("%s-%s", stream->name, "dummy");
+  if (GST_CLOCK_TIME_IS_VALID (last_end) &&
+      gst_pad_query_peer_position (stream->pad, &fmt, &pos) &&
+      fmt == GST_FORMAT_TIME && pos >= 0 && last_end > pos)
+    buffered += last_end - pos;
 
-  stream->pipe = gst_pipeline_new (name);
-  if (!stream->pipe) {
-    GST_ERROR_OBJECT (demux, "failed to create pipeline");
-    return FALSE;
-  }
-  g_free(name);
+  return buffered;
+}
 
-  /* create dummy sender source */
-  name = g_strdup_printf("%s-%s", stream->name, "dummysrc");
-  stream->urisrc = gst_element_factory_make ("filesrc", name);
-  if (!stream->urisrc) {
-    GST_ERROR_OBJECT (demux,"failed to create filesrc element");
-    return FALSE;
+/* feeds a download rate sample to the ABR engine & moves the video stream to
+ * the quality level it selects */
+static SS_BW_MODE
+gst_ss_demux_switch_qualitylevel (GstSSDemux *demux, guint64 download_rate)
+{
+  GstSSDemuxStream *stream = demux->streams[SS_STREAM_VIDEO];
+  SS_BW_MODE ret = SS_MODE_NO_SWITCH;
+  GstClockTime buffered = GST_CLOCK_TIME_NONE;
+  guint *bitrates = NULL;
+  guint n_bitrates = 0;
+  gint cur = 0;
+  gint next = 0;
+
+  gst_ss_abr_add_sample (demux->abr, download_rate);
+
+  if (!stream)
+    return SS_MODE_NO_SWITCH;
+
+  bitrates = gst_ssm_parse_get_bitrates (demux->parser, SS_STREAM_VIDEO, &n_bitrates, &cur);
+  if (!bitrates || !n_bitrates) {
+    g_free (bitrates);
+    return SS_MODE_NO_SWITCH;
   }
-  g_free(name);
-  g_object_set (G_OBJECT (stream->urisrc), "location", "/opt/home/root/sound_2sec.264", NULL);
 
-  /* create appsink element */
-  name = g_strdup_printf("%s-%s", stream->name, "parser");
-  stream->parser= gst_element_factory_make ("legacyh264parse", name);
-  if (!stream->parser) {
-    GST_ERROR_OBJECT (demux, "failed to create h264 parse element");
-    return FALSE;
+  buffered = gst_ss_demux_get_buffered_duration (demux, stream);
+  next = gst_ss_abr_select (demux->abr, bitrates, n_bitrates, cur, buffered);
+
+  GST_DEBUG_OBJECT (demux, "estimate = %"G_GUINT64_FORMAT" bps, buffered = %"GST_TIME_FORMAT
+      ", level %d -> %d", gst_ss_abr_get_estimate (demux->abr), GST_TIME_ARGS (buffered), cur, next);
+
+  if (next != cur && gst_ssm_parse_set_qualitylevel (demux->parser, SS_STREAM_VIDEO, next)) {
+    g_mutex_lock (stream->lock);
+    stream->n_switches++;
+    g_mutex_unlock (stream->lock);
+    ret = SS_MODE_AV;
   }
-  g_object_set (G_OBJECT (stream->parser), "output-format", 1, NULL);
 
-  /* create appsink element */
-  name = g_strdup_printf("%s-%s", stream->name, "sink");
-  stream->sink = gst_element_factory_make ("appsink", name);
-  if (!stream->sink) {
-    GST_ERROR_OBJECT (demux, "failed to create appsink element");
-    return FALSE;
+  /* even the lowest level can't be sustained, only audio is affordable */
+  if (next == 0 && GST_SSM_PARSE_IS_LIVE_PRESENTATION (demux->parser) &&
+      gst_ss_abr_get_estimate (demux->abr) < bitrates[0] + BITRATE_SWITCH_LOWER_THRESHOLD * bitrates[0]) {
+    g_print ("Going to audio-only because of LIVE...\n");
+    ret = SS_MODE_AONLY;
   }
-  g_object_set (G_OBJECT (stream->sink), "emit-signals", TRUE, "sync", FALSE, NULL);
 
-  caps = gst_caps_new_simple ("video/x-h264",
-                  "width", G_TYPE_INT, 640,
-                  "height", G_TYPE_INT, 480,
-                  "stream-format", G_TYPE_STRING, "byte-stream",
-                  NULL);
-  g_object_set (G_OBJECT (stream->sink), "caps", caps, NULL);
+  g_free (bitrates);
 
-  g_signal_connect (stream->sink, "new-buffer",  G_CALLBACK (gst_ssm_demux_on_new_buffer), stream);
-  g_free(name);
+  return ret;
+}
 
-  /* add to pipeline & link all elements */
-  gst_bin_add_many (GST_BIN (stream->pipe), stream->urisrc, stream->parser, stream->sink, NULL);
-  if (!gst_element_link_many (stream->urisrc, stream->parser, stream->sink, NULL)) {
-    GST_ERROR_OBJECT (demux,"failed to link elements...");
-    return FALSE;
+/* feeds the download rate of a completed fragment to the ABR engine, from
+ * the stream task */
+static void
+gst_ss_demux_fetcher_update_abr (GstSSDemux *demux, GstSSDemuxFetcher *fetcher)
+{
+  GstSSDemuxStream *stream = fetcher->stream;
+  guint64 download_rate = fetcher->download_rate;
+  SS_BW_MODE old_mode = demux->ss_mode;
+
+  /* served from the fragment cache or not downloaded over http */
+  // TODO: need to remove download_rate> 0 check.. make it generic
+  if (!download_rate)
+    return;
+
+  if ((stream->type == SS_STREAM_VIDEO) && (demux->ss_mode != SS_MODE_AONLY)) {
+    if (demux->fast_start || stream->frag_cnt + 1 >= demux->fragments_cache) {
+      /* for switching, we are considering video download rate only */
+      demux->ss_mode = gst_ss_demux_switch_qualitylevel (demux, download_rate);
+    }
+  } else if (stream->type == SS_STREAM_AUDIO && (demux->ss_mode == SS_MODE_AONLY)) {
+    /* when video is not present using audio download rate to calculate switching */
+     demux->ss_mode = gst_ss_demux_switch_qualitylevel (demux, download_rate);
+     if (demux->ss_mode != SS_MODE_AONLY) {
+       g_print ("\n\nMoving to AV mode by audio considering audio download rate\n\n\n\n");
+     }
   }
 
-  bus = gst_pipeline_get_bus (GST_PIPELINE (stream->pipe));
-  gst_bus_add_watch (bus, (GstBusFunc)gst_ss_demux_download_bus_cb, stream);
-  gst_object_unref (bus);
+#ifdef SIMULATE_AUDIO_ONLY
+  /* when fragment count is multiple of 4, switch to audio only case */
+  if (((stream->frag_cnt + 1) % 4 == 0) && (stream->type == SS_STREAM_VIDEO) &&
+	GST_SSM_PARSE_IS_LIVE_PRESENTATION(demux->parser)) {
+    g_print ("\n\t ######## Forcibly switching to audio only for testing ##########\n");
+    demux->ss_mode = SS_MODE_AONLY;
+  }
+#endif
 
-  return TRUE;
+  /* switch latency is measured up to the first buffer of the new mode */
+  if ((old_mode == SS_MODE_AONLY) != (demux->ss_mode == SS_MODE_AONLY)) {
+    GST_OBJECT_LOCK (demux);
+    demux->switch_requested = gst_util_get_timestamp ();
+    GST_OBJECT_UNLOCK (demux);
+  }
 }
 
-
-#endif
+/* schedules another download of the current fragment of a fetcher, with an
+ * exponential backoff & jitter so the live edge is not hammered by every
+ * client at once. Returns FALSE once the retry budget is spent */
 static gboolean
-gst_ss_demux_download_bus_cb(GstBus *bus, GstMessage *msg, gpointer data)
+gst_ss_demux_fetcher_schedule_retry (GstSSDemux *demux, GstSSDemuxFetcher *fetcher)
 {
-  GstSSDemuxStream *stream = (GstSSDemuxStream *)data;
-  GstSSDemux *demux = stream->parent;
+  GstSSDemuxStream *stream = fetcher->stream;
+  GstClockTime delay = demux->retry_delay;
+  guint i = 0;
 
-  switch (GST_MESSAGE_TYPE(msg)) {
-    case GST_MESSAGE_EOS: {
-      guint64 download_rate = -1;
+  g_mutex_lock (stream->lock);
+  if (fetcher->state == SS_FETCHER_IDLE) {
+    /* parked in between, nothing to retry */
+    g_mutex_unlock (stream->lock);
+    return TRUE;
+  }
 
-      GST_INFO_OBJECT (stream->pad, "received EOS on download pipe..");
-      // increase the fragment count on EOS
-      stream->frag_cnt++;
+  if (demux->max_retries && fetcher->n_retries >= demux->max_retries) {
+    g_mutex_unlock (stream->lock);
+    GST_WARNING_OBJECT (stream->pad, "giving up %s after %u retries", fetcher->uri, fetcher->n_retries);
+    GST_OBJECT_LOCK (demux);
+    demux->n_retry_failures++;
+    GST_OBJECT_UNLOCK (demux);
+    return FALSE;
+  }
 
-      if (g_strrstr (gst_element_get_name(stream->urisrc), "http")) {
-        g_object_get (stream->urisrc, "download-rate", &download_rate, NULL);
-        g_print("*********** '%s' download rate = %d bps **************\n", stream->name, download_rate);
-      }
+  for (i = 0; i < fetcher->n_retries && delay <= demux->retry_max_delay / 2; i++)
+    delay *= 2;
+  delay = MIN (delay, demux->retry_max_delay);
+
+  /* "equal jitter", wait somewhere in between half & the full delay */
+  if (delay > 1)
+    delay = delay / 2 + (GstClockTime) (g_random_double () * (delay / 2));
+
+  fetcher->n_retries++;
+  stream->n_retries++;
+  fetcher->retry_at = gst_util_get_timestamp () + delay;
+  fetcher->state = SS_FETCHER_RETRY;
+  /* the pipe can't be restarted from its own streaming thread, the stream
+   * task does it once retry_at is reached */
+  g_cond_signal (stream->cond);
+  GST_INFO_OBJECT (stream->pad, "retry %u of %s in %" GST_TIME_FORMAT " (%" G_GUINT64_FORMAT " on this stream)",
+      fetcher->n_retries, fetcher->uri, GST_TIME_ARGS (delay), stream->n_retries);
+  g_mutex_unlock (stream->lock);
 
-      // TODO: need to remove download_rate> 0 check.. make it generic
-      if ((stream->type == SS_STREAM_VIDEO) && (demux->ss_mode != SS_MODE_AONLY) && (download_rate >= 0)) {
-        if (stream->frag_cnt >= demux->fragments_cache) {
-          /* for switching, we are considering video download rate only */
-          demux->ss_mode = gst_ssm_parse_switch_qualitylevel (demux->parser, download_rate);
-        }
-      } else if (stream->type == SS_STREAM_AUDIO && (demux->ss_mode == SS_MODE_AONLY)) {
-        /* when video is not present using audio download rate to calculate switching */
-         demux->ss_mode = gst_ssm_parse_switch_qualitylevel (demux->parser, download_rate);
-         if (demux->ss_mode != SS_MODE_AONLY) {
-           g_print ("\n\nMoving to AV mode by audio considering audio download rate\n\n\n\n");
-         }
-      }
+  GST_OBJECT_LOCK (demux);
+  demux->n_retries++;
+  GST_OBJECT_UNLOCK (demux);
 
-      g_cond_signal (stream->cond);
+  return TRUE;
+}
 
-#ifdef SIMULATE_AUDIO_ONLY
-      /* when fragment count is multiple of 4, switch to audio only case */
-      if ((stream->frag_cnt % 4 == 0) && (stream->type == SS_STREAM_VIDEO) &&
-	  	GST_SSM_PARSE_IS_LIVE_PRESENTATION(demux->parser)) {
-        g_print ("\n\t ######## Forcibly switching to audio only for testing ##########\n");
-        demux->ss_mode = SS_MODE_AONLY;
-      }
-  #endif
-      GST_DEBUG_OBJECT (stream->pad, "Signalling eos condition...");
+/* called from the streaming threads of the download pipe. Only records what
+ * happened in the fetcher state & wakes up the stream task, which does the
+ * rest (ABR, retries, cleanup) */
+static GstBusSyncReply
+gst_ss_demux_download_bus_cb(GstBus *bus, GstMessage *msg, gpointer data)
+{
+  GstSSDemuxFetcher *fetcher = (GstSSDemuxFetcher *)data;
+  GstSSDemuxStream *stream = fetcher->stream;
+  GstSSDemux *demux = stream->parent;
 
-      GST_DEBUG_OBJECT (demux, "number of fragments downloaded = %d", stream->frag_cnt);
-      break;
-    }
+  switch (GST_MESSAGE_TYPE(msg)) {
     case GST_MESSAGE_ERROR: {
       GError *error = NULL;
       gchar* debug = NULL;
 
-      g_print ("Error from %s\n", gst_element_get_name (GST_MESSAGE_SRC(msg)));
+      g_print ("Error from %s\n", GST_OBJECT_NAME (GST_MESSAGE_SRC(msg)));
 
       gst_message_parse_error( msg, &error, &debug );
       if (error)
@@ -991,49 +2575,27 @@ gst_ss_demux_download_bus_cb(GstBus *bus, GstMessage *msg, gpointer data)
 
       /* handling error, when client requests url, which is yet to be prepared by server */
       if ((!strncmp(error->message, "Precondition Failed", strlen("Precondition Failed"))) && (5 == error->code)) {
-        GstStateChangeReturn ret;
-
-        /* wait for 1sec & request the url again */
-        // TODO: need to make wait time as generic or Adding loop count to request again & again
         GST_INFO_OBJECT (demux, "ERROR : code = %d, msg = %s, NEED to request again", error->code, error->message);
-        usleep (1000000); // 1 sec
-
-        /* put the current pipeline to NULL state */
-        gst_element_set_state (stream->pipe, GST_STATE_NULL);
-        gst_element_get_state (stream->pipe, NULL, NULL, GST_CLOCK_TIME_NONE);
-        stream->pipe = stream->urisrc = stream->parser = stream->sink = NULL;
-
-        g_print ("Going to download fragment AGAIN : %s\n", stream->uri);
-        if (!gst_ss_demux_create_download_pipe (demux, stream, stream->uri, stream->start_ts)) {
-          GST_ERROR_OBJECT (demux, "failed to create download pipeline");
-          if (!gst_element_post_message (GST_ELEMENT(demux), msg)) {
-            GST_ERROR_OBJECT (demux, "failed to post error");
-            return FALSE;
-          }
-        }
 
-        ret = gst_element_set_state (stream->pipe, GST_STATE_PLAYING);
-        if (ret == GST_STATE_CHANGE_FAILURE) {
-          if (!gst_element_post_message (GST_ELEMENT(demux), msg)) {
-            GST_ERROR_OBJECT (demux, "failed to post error");
-            return FALSE;
-          }
+        if (!gst_ss_demux_fetcher_schedule_retry (demux, fetcher)) {
+          GST_ELEMENT_ERROR (demux, RESOURCE, READ,
+              ("fragment not available after %u retries", demux->max_retries),
+              ("%s", fetcher->uri));
+          gst_ss_demux_fetcher_fail (fetcher);
         }
-
-        } else {
-          if (error)
+      } else if (stream->type == SS_STREAM_TEXT) {
+        /* playback goes on without these subtitles */
+        GST_ELEMENT_WARNING (demux, RESOURCE, READ, ("could not download text fragment"),
+            ("%s : %s", fetcher->uri, error ? error->message : "unknown"));
+        gst_ss_demux_fetcher_fail (fetcher);
+      } else {
+        if (error)
           g_print ("GST_MESSAGE_ERROR: error= %s\n", error->message);
 
-          g_print ("GST_MESSAGE_ERROR: debug = %s\n", debug);
-          if (!gst_element_post_message (GST_ELEMENT(demux), msg)) {
-            GST_ERROR_OBJECT (demux, "failed to post error");
-            gst_ss_demux_stop (demux, stream);
-            g_free( debug);
-            debug = NULL;
-            g_error_free( error);
-            return FALSE;
-        }
-        gst_ss_demux_stop (demux, stream);
+        g_print ("GST_MESSAGE_ERROR: debug = %s\n", debug);
+        if (!gst_element_post_message (GST_ELEMENT(demux), gst_message_ref (msg)))
+          GST_ERROR_OBJECT (demux, "failed to post error");
+        gst_ss_demux_fetcher_fail (fetcher);
       }
 
       g_free( debug);
@@ -1057,31 +2619,257 @@ gst_ss_demux_download_bus_cb(GstBus *bus, GstMessage *msg, gpointer data)
     }
   }
 
-  return TRUE;
+  return GST_BUS_DROP;
 }
 
 static void
-gst_ssm_demux_on_new_buffer (GstElement * appsink, void* data)
+gst_ss_demux_fetcher_fail (GstSSDemuxFetcher *fetcher)
 {
-  GstSSDemuxStream *stream = (GstSSDemuxStream *)data;
-  GstSSDemux *demux = stream->parent;
-  GstBuffer *inbuf = NULL;
+  GstSSDemuxStream *stream = fetcher->stream;
+
+  g_mutex_lock (stream->lock);
+  fetcher->state = SS_FETCHER_FAILED;
+  g_cond_signal (stream->cond);
+  g_mutex_unlock (stream->lock);
+}
+
+/* the proxy pad of a fetcher only queues the parsed samples, they are pushed
+ * in fragment order from the stream task */
+static GstFlowReturn
+gst_ss_demux_fetcher_chain (GstPad * pad, GstBuffer * inbuf)
+{
+  GstSSDemuxFetcher *fetcher = gst_pad_get_element_private (pad);
+  GstSSDemuxStream *stream = fetcher->stream;
   GstFlowReturn fret = GST_FLOW_OK;
 
-  inbuf = gst_app_sink_pull_buffer ((GstAppSink *)appsink);
-  if (!inbuf) {
-    GST_WARNING_OBJECT (demux, "Input buffer not available.,..\n");
+  GST_LOG_OBJECT (stream->pad, "Inbuf : size = %d, ts = %"GST_TIME_FORMAT", dur = %"GST_TIME_FORMAT,
+      GST_BUFFER_SIZE(inbuf), GST_TIME_ARGS(GST_BUFFER_TIMESTAMP(inbuf)), GST_TIME_ARGS(GST_BUFFER_DURATION(inbuf)));
+
+  g_mutex_lock (stream->lock);
+  if (fetcher->state == SS_FETCHER_IDLE || fetcher->state == SS_FETCHER_FAILED) {
+    /* parked or given up in between, stop the download */
+    gst_buffer_unref (inbuf);
+    fret = GST_FLOW_WRONG_STATE;
+  } else {
+    if (fetcher->state == SS_FETCHER_FETCHING)
+      fetcher->state = SS_FETCHER_PARSING;
+    stream->bytes += GST_BUFFER_SIZE (inbuf);
+    if (fetcher->discard) {
+      gst_buffer_unref (inbuf);
+    } else {
+      if (((GstSSDemux *)stream->parent)->frag_cache)
+        fetcher->collected = g_list_prepend (fetcher->collected, gst_buffer_ref (inbuf));
+      g_queue_push_tail (fetcher->queue, inbuf);
+    }
+    g_cond_signal (stream->cond);
+  }
+  g_mutex_unlock (stream->lock);
+
+  return fret;
+}
+
+/* EOS on the proxy pad ends the download of the fragment, other events of
+ * the download pipe stay inside the fetcher */
+static gboolean
+gst_ss_demux_fetcher_sink_event (GstPad * pad, GstEvent * event)
+{
+  GstSSDemuxFetcher *fetcher = gst_pad_get_element_private (pad);
+  GstSSDemuxStream *stream = fetcher->stream;
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    guint64 download_rate = 0;
+
+    GST_INFO_OBJECT (stream->pad, "received EOS on download pipe %u..", fetcher->id);
+
+    if (g_strrstr (GST_ELEMENT_NAME (fetcher->urisrc), "http")) {
+      g_object_get (fetcher->urisrc, "download-rate", &download_rate, NULL);
+      GST_DEBUG_OBJECT (stream->pad, "download rate = %" G_GUINT64_FORMAT " bps", download_rate);
+    }
+
+    g_mutex_lock (stream->lock);
+    if (fetcher->state != SS_FETCHER_IDLE) {
+      GstClockTime latency = gst_util_get_timestamp () - fetcher->fetch_start;
+      guint bucket = 0;
+
+      while (bucket < SS_LATENCY_BUCKETS - 1 && latency > ss_latency_bounds[bucket])
+        bucket++;
+      stream->latency_hist[bucket]++;
+
+      fetcher->download_rate = download_rate;
+      fetcher->state = SS_FETCHER_DRAINING;
+      g_cond_signal (stream->cond);
+    }
+    g_mutex_unlock (stream->lock);
+
+    GST_DEBUG_OBJECT (stream->pad, "Signalling eos condition...");
+  }
+
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+/* sets the field '<stream name>-<key>' of the stats, varargs are the type
+ * & value followed by NULL as for gst_structure_set() */
+static void
+gst_ss_demux_stats_set (GstStructure *s, GstSSDemuxStream *stream, const gchar *key, ...)
+{
+  gchar *field = g_strdup_printf ("%s-%s", stream->name, key);
+  va_list args;
+
+  va_start (args, key);
+  gst_structure_set_valist (s, field, args);
+  va_end (args);
+
+  g_free (field);
+}
+
+static GstStructure *
+gst_ss_demux_get_stats (GstSSDemux *demux)
+{
+  GstStructure *s = gst_structure_new ("ssdemux-stats", NULL);
+  GValue array = { 0, };
+  GValue item = { 0, };
+  gint i = 0;
+  guint b = 0;
+
+  g_value_init (&array, GST_TYPE_ARRAY);
+  g_value_init (&item, G_TYPE_UINT64);
+  for (b = 0; b < SS_LATENCY_BUCKETS - 1; b++) {
+    g_value_set_uint64 (&item, ss_latency_bounds[b]);
+    gst_value_array_append_value (&array, &item);
+  }
+  gst_structure_set_value (s, "latency-bounds", &array);
+  g_value_unset (&item);
+  g_value_unset (&array);
+
+  /* caps are built while the manifest is parsed, this must not grow
+   * once playback has started */
+  if (demux->parser)
+    gst_structure_set (s, "caps-conversions", G_TYPE_UINT,
+        gst_ssm_parse_get_caps_conversions (demux->parser), NULL);
+  gst_structure_set (s, "manifest-parse-time", G_TYPE_UINT64, demux->manifest_parse_time,
+      "manifest-from-snapshot", G_TYPE_BOOLEAN, demux->manifest_from_snapshot, NULL);
+
+  for (i = 0; i < SS_STREAM_NUM; i++) {
+    GstSSDemuxStream *stream = demux->streams[i];
+    guint hist[SS_LATENCY_BUCKETS];
+    guint64 bytes = 0, retries = 0;
+    guint switches = 0, stalls = 0;
+    guint *bitrates = NULL;
+    guint n_bitrates = 0;
+    gint cur = -1;
+
+    if (!stream)
+      continue;
+
+    g_mutex_lock (stream->lock);
+    bytes = stream->bytes;
+    retries = stream->n_retries;
+    switches = stream->n_switches;
+    stalls = stream->n_stalls;
+    memcpy (hist, stream->latency_hist, sizeof (hist));
+    g_mutex_unlock (stream->lock);
+
+    bitrates = gst_ssm_parse_get_bitrates (demux->parser, stream->type, &n_bitrates, &cur);
+
+    gst_ss_demux_stats_set (s, stream, "bytes", G_TYPE_UINT64, bytes, NULL);
+    gst_ss_demux_stats_set (s, stream, "quality-level", G_TYPE_INT, cur, NULL);
+    gst_ss_demux_stats_set (s, stream, "bitrate", G_TYPE_UINT,
+        (bitrates && cur >= 0 && cur < (gint) n_bitrates) ? bitrates[cur] : 0, NULL);
+    gst_ss_demux_stats_set (s, stream, "switches", G_TYPE_UINT, switches, NULL);
+    gst_ss_demux_stats_set (s, stream, "buffered", G_TYPE_UINT64,
+        gst_ss_demux_get_buffered_duration (demux, stream), NULL);
+    gst_ss_demux_stats_set (s, stream, "stalls", G_TYPE_UINT, stalls, NULL);
+    gst_ss_demux_stats_set (s, stream, "retries", G_TYPE_UINT64, retries, NULL);
+    gst_ss_demux_stats_set (s, stream, "track", G_TYPE_UINT, stream->track, NULL);
+    g_free (bitrates);
+
+    /* one count per latency-bounds entry, plus the overflow bucket */
+    g_value_init (&array, GST_TYPE_ARRAY);
+    g_value_init (&item, G_TYPE_UINT);
+    for (b = 0; b < SS_LATENCY_BUCKETS; b++) {
+      g_value_set_uint (&item, hist[b]);
+      gst_value_array_append_value (&array, &item);
+    }
+    {
+      gchar *field = g_strdup_printf ("%s-fetch-latency", stream->name);
+
+      gst_structure_set_value (s, field, &array);
+      g_free (field);
+    }
+    g_value_unset (&item);
+    g_value_unset (&array);
+  }
+
+  return s;
+}
+
+/* posts the stats as element message when stats-interval has elapsed, from
+ * the stream tasks when a fragment is done */
+static void
+gst_ss_demux_post_stats (GstSSDemux *demux)
+{
+  GstClockTime now = gst_util_get_timestamp ();
+  gboolean due = FALSE;
+
+  if (!demux->stats_interval)
     return;
+
+  GST_OBJECT_LOCK (demux);
+  if (!GST_CLOCK_TIME_IS_VALID (demux->last_stats) ||
+      now - demux->last_stats >= demux->stats_interval) {
+    demux->last_stats = now;
+    due = TRUE;
   }
+  GST_OBJECT_UNLOCK (demux);
 
-  GST_LOG_OBJECT (stream->pad, "Inbuf : size = %d, ts = %"GST_TIME_FORMAT", dur = %"GST_TIME_FORMAT,
-      GST_BUFFER_SIZE(inbuf), GST_TIME_ARGS(GST_BUFFER_TIMESTAMP(inbuf)), GST_TIME_ARGS(GST_BUFFER_DURATION(inbuf)));
+  if (due)
+    gst_element_post_message (GST_ELEMENT_CAST (demux),
+        gst_message_new_element (GST_OBJECT_CAST (demux), gst_ss_demux_get_stats (demux)));
+}
+
+/* reports the time from READY->PAUSED to the first buffer of a stream */
+static void
+gst_ss_demux_post_first_frame (GstSSDemux *demux, GstSSDemuxStream *stream)
+{
+  GstClockTime ttff = GST_CLOCK_TIME_NONE;
+  GstStructure *s = NULL;
+
+  stream->sent_first = TRUE;
+
+  if (GST_CLOCK_TIME_IS_VALID (demux->start_time))
+    ttff = gst_util_get_timestamp () - demux->start_time;
+
+  GST_INFO_OBJECT (stream->pad, "time to first frame = %" GST_TIME_FORMAT " (fast-start = %d)",
+      GST_TIME_ARGS (ttff), demux->fast_start);
+
+  s = gst_structure_new ("ssdemux-ttff",
+      "stream", G_TYPE_STRING, stream->name,
+      "time", G_TYPE_UINT64, ttff,
+      "fast-start", G_TYPE_BOOLEAN, demux->fast_start, NULL);
+  gst_element_post_message (GST_ELEMENT_CAST (demux),
+      gst_message_new_element (GST_OBJECT_CAST (demux), s));
+}
+
+static GstFlowReturn
+gst_ss_demux_push_buffer (GstSSDemux *demux, GstSSDemuxStream *stream, GstBuffer *inbuf)
+{
+  GstFlowReturn fret = GST_FLOW_OK;
 
   // Queue the buffers till fragment cache reached... after reaching start pushing data to respective port
-  if ( stream->frag_cnt < demux->fragments_cache ) {
-    GST_LOG_OBJECT (demux, "queuing data till caching finished...");
-    g_queue_push_tail (stream->queue, inbuf);
-    return;
+  if (!demux->fast_start && stream->frag_cnt < demux->fragments_cache) {
+    if (!demux->frag_cache_size ||
+        stream->queued_bytes + GST_BUFFER_SIZE (inbuf) <= demux->frag_cache_size) {
+      GST_LOG_OBJECT (demux, "queuing data till caching finished...");
+      stream->queued_bytes += GST_BUFFER_SIZE (inbuf);
+      if (GST_BUFFER_DURATION_IS_VALID (inbuf))
+        stream->queued_dur += GST_BUFFER_DURATION (inbuf);
+      g_queue_push_tail (stream->queue, inbuf);
+      return GST_FLOW_OK;
+    }
+    /* cache memory budget reached before the fragment count, start playing */
+    GST_INFO_OBJECT (stream->pad, "caching stopped at %"G_GUINT64_FORMAT" bytes", stream->queued_bytes);
   }
 
   if (!stream->sent_ns) {
@@ -1102,40 +2890,49 @@ gst_ssm_demux_on_new_buffer (GstElement * appsink, void* data)
 
     if (!gst_pad_push_event (stream->pad, event)) {
       GST_ERROR_OBJECT (demux, "failed to push newsegment event");
-      return;
+      gst_buffer_unref (inbuf);
+      return GST_FLOW_ERROR;
     }
     stream->sent_ns = TRUE;
   }
 
-  while (!g_queue_is_empty(stream->queue)) {
-    GstBuffer *cache_buf = g_queue_pop_head (stream->queue);
+  stream->queued_bytes = 0;
+  stream->queued_dur = 0;
+  if (!g_queue_is_empty (stream->queue)) {
+    GstBufferList *list = gst_buffer_list_new ();
+    GstBufferListIterator *it = gst_buffer_list_iterate (list);
 
-    fret = gst_pad_push (stream->pad, cache_buf);
+    /* startup cache goes downstream in one go, one group per sample */
+    while (!g_queue_is_empty (stream->queue)) {
+      gst_buffer_list_iterator_add_group (it);
+      gst_buffer_list_iterator_add (it, g_queue_pop_head (stream->queue));
+    }
+    gst_buffer_list_iterator_free (it);
+
+    GST_DEBUG_OBJECT (stream->pad, "pushing %u cached samples as a buffer list",
+        gst_buffer_list_n_groups (list));
+    fret = gst_pad_push_list (stream->pad, list);
     if (fret != GST_FLOW_OK) {
       GST_ERROR_OBJECT (demux, "failed to push data, reason : %s", gst_flow_get_name (fret));
-      goto error;
+      gst_buffer_unref (inbuf);
+      return fret;
     }
   }
 
-  if (stream->type == SS_STREAM_VIDEO && demux->ss_mode == SS_MODE_AONLY) {
-    GST_BUFFER_TIMESTAMP (inbuf) = stream->switch_ts;
-    GST_BUFFER_DURATION (inbuf) = ((float)1/25) * GST_SECOND;
-    stream->switch_ts = GST_BUFFER_TIMESTAMP (inbuf) + GST_BUFFER_DURATION (inbuf);
-    g_print ("Dummy buffers ts : %"GST_TIME_FORMAT" and dur : %"GST_TIME_FORMAT"\n",
-		GST_TIME_ARGS(GST_BUFFER_TIMESTAMP (inbuf)), GST_TIME_ARGS(GST_BUFFER_DURATION (inbuf)));
-
-    g_print ("caps : %s\n", gst_caps_to_string(GST_BUFFER_CAPS(inbuf)));
+  if (GST_BUFFER_TIMESTAMP_IS_VALID (inbuf)) {
+    stream->last_end = GST_BUFFER_TIMESTAMP (inbuf);
+    if (GST_BUFFER_DURATION_IS_VALID (inbuf))
+      stream->last_end += GST_BUFFER_DURATION (inbuf);
   }
 
   /* push data to downstream*/
   fret = gst_pad_push (stream->pad, inbuf);
-  if (fret != GST_FLOW_OK) {
+  if (fret != GST_FLOW_OK)
     GST_ERROR_OBJECT (demux, "failed to push data, reason : %s", gst_flow_get_name (fret));
-    goto error;
-  }
+  else if (!stream->sent_first)
+    gst_ss_demux_post_first_frame (demux, stream);
 
-error:
-  return;
+  return fret;
 }
 
 static void
@@ -1145,23 +2942,61 @@ gst_ss_demux_stop (GstSSDemux * demux, GstSSDemuxStream *stream)
     gst_task_stop (stream->stream_task);
 }
 
+/* stops & joins the stream tasks, wherever they are waiting. The pads are
+ * deactivated already, so a push in progress returns */
+static void
+gst_ss_demux_stop_streams (GstSSDemux * demux)
+{
+  GstSSDemuxStream *stream = NULL;
+  gint i = 0;
+
+  for (i = 0; i < SS_STREAM_NUM; i++) {
+    if ((stream = demux->streams[i]) && stream->stream_task) {
+      g_mutex_lock (stream->lock);
+      stream->flushing = TRUE;
+      g_cond_signal (stream->cond);
+      g_mutex_unlock (stream->lock);
+      gst_task_stop (stream->stream_task);
+    }
+  }
+
+  if (demux->parser)
+    gst_ssm_parse_set_flushing (demux->parser, TRUE);
+
+  for (i = 0; i < SS_STREAM_NUM; i++) {
+    if ((stream = demux->streams[i]) && stream->stream_task)
+      gst_task_join (stream->stream_task);
+  }
+}
+
 static void
 gst_ss_demux_stream_init (GstSSDemux *demux, GstSSDemuxStream *stream, SS_STREAM_TYPE stream_type)
 {
+  guint i = 0;
+
   stream->cond = g_cond_new ();
   stream->lock = g_mutex_new ();
   stream->queue = g_queue_new ();
   stream->parent = demux;
-  stream->pipe = NULL;
-  stream->urisrc = NULL;
-  stream->parser = NULL;
-  stream->sink = NULL;
+  stream->filler_data = NULL;
+  stream->filler_frames = NULL;
+  stream->filler_caps = NULL;
+  stream->filling = FALSE;
   stream->frag_cnt = 0;
+  stream->n_retries = 0;
+  stream->bytes = 0;
+  memset (stream->latency_hist, 0, sizeof (stream->latency_hist));
+  stream->n_switches = 0;
+  stream->n_stalls = 0;
+  stream->queued_bytes = 0;
+  stream->queued_dur = 0;
+  stream->last_end = GST_CLOCK_TIME_NONE;
   stream->type = stream_type ;
-  stream->uri = NULL;
-  stream->start_ts = -1;
   stream->sent_ns = FALSE;
-  stream->switch_ts = GST_CLOCK_TIME_NONE;
+  stream->sent_first = FALSE;
+  stream->flushing = FALSE;
+  stream->track = 0;
+  stream->resume_ts = GST_CLOCK_TIME_NONE;
   stream->avg_dur = GST_CLOCK_TIME_NONE;
 
   if (stream->type == SS_STREAM_VIDEO) {
@@ -1175,14 +3010,30 @@ gst_ss_demux_stream_init (GstSSDemux *demux, GstSSDemuxStream *stream, SS_STREAM
     stream->name = g_strdup("text");
   }
 
+  /* one download pipe per fragment of the prefetch window */
+  stream->n_fetchers = (stream->type == SS_STREAM_TEXT) ? demux->text_batch : demux->prefetch_depth;
+  stream->fetchers = g_new0 (GstSSDemuxFetcher, stream->n_fetchers);
+  stream->free_fetchers = g_queue_new ();
+  stream->inflight = g_queue_new ();
+  for (i = 0; i < stream->n_fetchers; i++) {
+    GstSSDemuxFetcher *fetcher = &stream->fetchers[i];
+
+    fetcher->stream = stream;
+    fetcher->id = i;
+    fetcher->queue = g_queue_new ();
+    fetcher->start_ts = -1;
+    g_queue_push_tail (stream->free_fetchers, fetcher);
+  }
+
   GST_PAD_ELEMENT_PRIVATE (stream->pad) = stream;
 
   gst_pad_use_fixed_caps (stream->pad);
   gst_pad_set_event_function (stream->pad, gst_ss_demux_handle_src_event);
   gst_pad_set_query_function (stream->pad, gst_ss_demux_handle_src_query);
+  if (stream->type == SS_STREAM_TEXT)
+    gst_pad_set_link_function (stream->pad, gst_ss_demux_text_link);
 
   stream->caps = ssm_parse_get_stream_caps (demux->parser, stream->type);
-  g_print ("prepare video caps = %s", gst_caps_to_string(stream->caps));
 
   GST_DEBUG_OBJECT (demux, "setting caps %" GST_PTR_FORMAT, stream->caps);
   gst_pad_set_caps (stream->pad, stream->caps);
@@ -1195,6 +3046,35 @@ gst_ss_demux_stream_init (GstSSDemux *demux, GstSSDemuxStream *stream, SS_STREAM
 static void
 gst_ss_demux_stream_free (GstSSDemux * demux, GstSSDemuxStream * stream)
 {
+  guint i = 0;
+
+  for (i = 0; i < stream->n_fetchers; i++) {
+    GstSSDemuxFetcher *fetcher = &stream->fetchers[i];
+
+    gst_ss_demux_destroy_download_pipe (demux, fetcher);
+    while (!g_queue_is_empty(fetcher->queue)) {
+      gst_buffer_unref (g_queue_pop_head (fetcher->queue));
+    }
+    g_queue_free (fetcher->queue);
+    g_list_foreach (fetcher->collected, (GFunc) gst_buffer_unref, NULL);
+    g_list_free (fetcher->collected);
+    g_free (fetcher->uri);
+  }
+  g_free (stream->fetchers);
+  stream->fetchers = NULL;
+  stream->n_fetchers = 0;
+
+  if (stream->free_fetchers) {
+    g_queue_free (stream->free_fetchers);
+    stream->free_fetchers = NULL;
+  }
+  if (stream->inflight) {
+    g_queue_free (stream->inflight);
+    stream->inflight = NULL;
+  }
+
+  gst_ss_demux_clear_filler (stream);
+
   if (stream->queue) {
     while (!g_queue_is_empty(stream->queue)) {
       gst_buffer_unref (g_queue_pop_head (stream->queue));
@@ -1216,6 +3096,7 @@ gst_ss_demux_stream_free (GstSSDemux * demux, GstSSDemuxStream * stream)
     stream->lock = NULL;
   }
 
+  g_free (stream->name);
   g_free (stream);
 }
 static gboolean
@@ -7,6 +7,8 @@
 #include <gst/app/gstappsrc.h>
 #include <gst/app/gstappsink.h>
 #include "ssmanifestparse.h"
+#include "ssfragmentcache.h"
+#include "ssabr.h"
 #include "piffcommon.h"
 
 G_BEGIN_DECLS
@@ -42,11 +44,50 @@ struct _GstSSDemux
   gboolean allow_audio_only;  /*In LIVE case, allow audio only download when downloadrate is less */
   guint fragments_cache;        /* number of fragments needed to be cached to start playing */
   gfloat bitrate_switch_tol;    /* tolerance with respect to the fragment duration to switch the bitarate*/
+  guint prefetch_depth;         /* number of fragments downloaded in parallel per stream */
+  guint64 frag_cache_size;      /* byte budget of the fragment cache, 0 disables it */
   gboolean need_cache;
   gboolean cancelled;
   guint download_rate;
-  GstBuffer *manifest;
   GstSSMParse *parser; /* manifest parser */
+  GstSSFragmentCache *frag_cache; /* parsed fragments kept for re-use after seek */
+  GstSSAbr *abr; /* quality level selection */
+
+  /* retries of live fragments not yet available (412) */
+  GstClockTime retry_delay;
+  GstClockTime retry_max_delay;
+  guint max_retries;
+  guint64 n_retries; /* protected by object lock */
+  guint64 n_retry_failures; /* protected by object lock */
+
+  /* live audio-only mode */
+  gchar *placeholder_location;
+  GstClockTime switch_requested; /* protected by object lock */
+  GstClockTime switch_latency; /* protected by object lock */
+
+  gboolean fast_start;
+  GstClockTime start_time; /* READY->PAUSED, for the time to first frame */
+
+  GstClockTime stats_interval;
+  GstClockTime last_stats; /* protected by object lock */
+  guint text_batch;
+  guint audio_track; /* requested audio StreamIndex, protected by object lock */
+
+  /* binary snapshots of VOD manifests, skipping the XML parse on warm starts */
+  gchar *snapshot_dir;
+  GstAdapter *manifest_data; /* whole manifest, parsed at EOS when snapshot_dir is set */
+  GChecksum *manifest_sum; /* snapshot key, of the uri & the manifest */
+  GstClockTime manifest_parse_time;
+  gboolean manifest_from_snapshot;
+
+  /* live manifest refresh */
+  GstTask *refresh_task;
+  GStaticRecMutex refresh_task_lock;
+  GMutex *refresh_lock;
+  GCond *refresh_cond;
+  gboolean refresh_stop;
+  GstElement *refresh_pipe;
+  GstElement *refresh_sink;
 
   GstSSDemuxStream *streams[SS_STREAM_NUM];
   SS_BW_MODE ss_mode;
@@ -0,0 +1,176 @@
+#include "ssabr.h"
+
+static gint ss_abr_select_throughput (GstSSAbr *abr, const guint *bitrates, guint n_bitrates, gint cur, GstClockTime buffered);
+static gint ss_abr_select_buffer (GstSSAbr *abr, const guint *bitrates, guint n_bitrates, gint cur, GstClockTime buffered);
+static gint ss_abr_select_hybrid (GstSSAbr *abr, const guint *bitrates, guint n_bitrates, gint cur, GstClockTime buffered);
+
+static const GstSSAbrSelectFunc ss_abr_policies[SS_ABR_POLICY_NUM] = {
+  ss_abr_select_throughput,
+  ss_abr_select_buffer,
+  ss_abr_select_hybrid,
+};
+
+GstSSAbr *
+gst_ss_abr_new (SS_ABR_POLICY policy)
+{
+  GstSSAbr *abr = g_new0 (GstSSAbr, 1);
+
+  gst_ss_abr_set_policy (abr, policy);
+  gst_ss_abr_reset (abr);
+
+  return abr;
+}
+
+void
+gst_ss_abr_free (GstSSAbr *abr)
+{
+  g_free (abr);
+}
+
+void
+gst_ss_abr_reset (GstSSAbr *abr)
+{
+  g_return_if_fail (abr != NULL);
+
+  abr->fast_ewma = abr->slow_ewma = 0;
+  abr->fast_weight = abr->slow_weight = 0;
+  abr->n_samples = 0;
+}
+
+void
+gst_ss_abr_set_policy (GstSSAbr *abr, SS_ABR_POLICY policy)
+{
+  g_return_if_fail (abr != NULL);
+  g_return_if_fail (policy < SS_ABR_POLICY_NUM);
+
+  abr->policy = policy;
+}
+
+/* exponentially weighted moving averages with two half-lives: the fast one
+ * reacts to drops, the slow one keeps a single good sample from moving up */
+void
+gst_ss_abr_add_sample (GstSSAbr *abr, guint64 download_rate)
+{
+  gdouble fast_alpha = SS_ABR_FAST_ALPHA;
+  gdouble slow_alpha = SS_ABR_SLOW_ALPHA;
+
+  g_return_if_fail (abr != NULL);
+
+  if (download_rate == 0 || download_rate == (guint64) -1)
+    return;
+
+  abr->fast_ewma = fast_alpha * download_rate + (1.0 - fast_alpha) * abr->fast_ewma;
+  abr->fast_weight = fast_alpha + (1.0 - fast_alpha) * abr->fast_weight;
+  abr->slow_ewma = slow_alpha * download_rate + (1.0 - slow_alpha) * abr->slow_ewma;
+  abr->slow_weight = slow_alpha + (1.0 - slow_alpha) * abr->slow_weight;
+  abr->n_samples++;
+
+  GST_LOG ("bandwidth sample = %"G_GUINT64_FORMAT" bps, estimate = %"G_GUINT64_FORMAT" bps",
+      download_rate, gst_ss_abr_get_estimate (abr));
+}
+
+/* conservative estimate, minimum of both averages. 0 when no sample yet */
+guint64
+gst_ss_abr_get_estimate (GstSSAbr *abr)
+{
+  gdouble fast, slow;
+
+  g_return_val_if_fail (abr != NULL, 0);
+
+  if (!abr->n_samples)
+    return 0;
+
+  fast = abr->fast_ewma / abr->fast_weight;
+  slow = abr->slow_ewma / abr->slow_weight;
+
+  return (guint64) MIN (fast, slow);
+}
+
+gint
+gst_ss_abr_select (GstSSAbr *abr, const guint *bitrates, guint n_bitrates, gint cur, GstClockTime buffered)
+{
+  g_return_val_if_fail (abr != NULL, cur);
+
+  if (!bitrates || !n_bitrates)
+    return cur;
+
+  cur = CLAMP (cur, 0, (gint) n_bitrates - 1);
+
+  return ss_abr_policies[abr->policy] (abr, bitrates, n_bitrates, cur, buffered);
+}
+
+/* highest level sustained by the estimate. Going up needs the upper margin,
+ * staying needs the lower one only, so small variations don't oscillate */
+static gint
+ss_abr_select_throughput (GstSSAbr *abr, const guint *bitrates, guint n_bitrates, gint cur, GstClockTime buffered)
+{
+  guint64 estimate = gst_ss_abr_get_estimate (abr);
+  gint idx = 0;
+  gint next = 0;
+
+  if (!abr->n_samples)
+    return cur;
+
+  for (idx = 0; idx < (gint) n_bitrates; idx++) {
+    gdouble margin = (idx > cur) ? BITRATE_SWITCH_UPPER_THRESHOLD : BITRATE_SWITCH_LOWER_THRESHOLD;
+
+    if (bitrates[idx] + margin * bitrates[idx] <= estimate)
+      next = idx;
+  }
+
+  return next;
+}
+
+/* buffer based (BBA-0): lowest level inside the reservoir, highest above the
+ * cushion and a linear mapping of the bitrate range in between */
+static gint
+ss_abr_select_buffer (GstSSAbr *abr, const guint *bitrates, guint n_bitrates, gint cur, GstClockTime buffered)
+{
+  guint64 target = 0;
+  gint idx = 0;
+  gint next = 0;
+
+  if (!GST_CLOCK_TIME_IS_VALID (buffered))
+    return cur;
+
+  if (buffered <= SS_ABR_BUFFER_RESERVOIR)
+    return 0;
+
+  if (buffered >= SS_ABR_BUFFER_RESERVOIR + SS_ABR_BUFFER_CUSHION)
+    return n_bitrates - 1;
+
+  target = bitrates[0] + gst_util_uint64_scale (bitrates[n_bitrates - 1] - bitrates[0],
+      buffered - SS_ABR_BUFFER_RESERVOIR, SS_ABR_BUFFER_CUSHION);
+
+  for (idx = 0; idx < (gint) n_bitrates; idx++) {
+    if (bitrates[idx] <= target)
+      next = idx;
+  }
+
+  /* move one level at a time towards the target */
+  if (next > cur)
+    return cur + 1;
+  else if (next < cur)
+    return cur - 1;
+
+  return cur;
+}
+
+/* throughput decision, but no up-switch while the buffer is in the
+ * reservoir and no down-switch while it is above the cushion */
+static gint
+ss_abr_select_hybrid (GstSSAbr *abr, const guint *bitrates, guint n_bitrates, gint cur, GstClockTime buffered)
+{
+  gint next = ss_abr_select_throughput (abr, bitrates, n_bitrates, cur, buffered);
+
+  if (!GST_CLOCK_TIME_IS_VALID (buffered))
+    return next;
+
+  if (buffered <= SS_ABR_BUFFER_RESERVOIR && next > cur)
+    return cur;
+
+  if (buffered >= SS_ABR_BUFFER_RESERVOIR + SS_ABR_BUFFER_CUSHION && next < cur)
+    return cur;
+
+  return next;
+}
@@ -0,0 +1,52 @@
+
+#ifndef __SS_ABR_H__
+#define __SS_ABR_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+typedef struct _GstSSAbr GstSSAbr;
+
+/* hysteresis around a quality level, relative to its bitrate */
+#define BITRATE_SWITCH_UPPER_THRESHOLD 0.4
+#define BITRATE_SWITCH_LOWER_THRESHOLD 0.1
+
+/* smoothing of the bandwidth estimators, half-life of 2 & 6 fragments */
+#define SS_ABR_FAST_ALPHA 0.2929
+#define SS_ABR_SLOW_ALPHA 0.1091
+
+/* buffer levels used by the buffer based policies */
+#define SS_ABR_BUFFER_RESERVOIR (4 * GST_SECOND)
+#define SS_ABR_BUFFER_CUSHION (12 * GST_SECOND)
+
+typedef enum
+{
+  SS_ABR_POLICY_THROUGHPUT, /* bandwidth estimate only */
+  SS_ABR_POLICY_BUFFER, /* buffer occupancy only */
+  SS_ABR_POLICY_HYBRID, /* bandwidth estimate, guarded by buffer occupancy */
+  SS_ABR_POLICY_NUM,
+}SS_ABR_POLICY;
+
+/* returns index in the ascending @bitrates of the level to download next */
+typedef gint (*GstSSAbrSelectFunc) (GstSSAbr *abr, const guint *bitrates, guint n_bitrates, gint cur, GstClockTime buffered);
+
+struct _GstSSAbr
+{
+  SS_ABR_POLICY policy;
+  gdouble fast_ewma; /* bps */
+  gdouble slow_ewma; /* bps */
+  gdouble fast_weight; /* total weight of the samples, to unbias the start */
+  gdouble slow_weight;
+  guint n_samples;
+};
+
+GstSSAbr *gst_ss_abr_new (SS_ABR_POLICY policy);
+void gst_ss_abr_free (GstSSAbr *abr);
+void gst_ss_abr_reset (GstSSAbr *abr);
+void gst_ss_abr_set_policy (GstSSAbr *abr, SS_ABR_POLICY policy);
+void gst_ss_abr_add_sample (GstSSAbr *abr, guint64 download_rate);
+guint64 gst_ss_abr_get_estimate (GstSSAbr *abr);
+gint gst_ss_abr_select (GstSSAbr *abr, const guint *bitrates, guint n_bitrates, gint cur, GstClockTime buffered);
+G_END_DECLS
+#endif /* __SS_ABR_H__ */
@@ -0,0 +1,186 @@
+#include "ssfragmentcache.h"
+
+typedef struct
+{
+  SS_STREAM_TYPE stream_type;
+  guint track; /* StreamIndex of the stream type, e.g. audio language */
+  guint bitrate;
+  guint64 time;
+}GstSSFragmentKey;
+
+typedef struct
+{
+  GstSSFragmentKey key;
+  GList *buffers;
+  guint64 size;
+}GstSSFragmentEntry;
+
+static guint
+ssm_fragment_key_hash (gconstpointer data)
+{
+  const GstSSFragmentKey *key = data;
+
+  return (key->stream_type << 28) ^ (key->track << 24) ^ key->bitrate ^ (guint) key->time ^ (guint) (key->time >> 32);
+}
+
+static gboolean
+ssm_fragment_key_equal (gconstpointer a, gconstpointer b)
+{
+  const GstSSFragmentKey *ka = a;
+  const GstSSFragmentKey *kb = b;
+
+  return ka->stream_type == kb->stream_type && ka->track == kb->track &&
+      ka->bitrate == kb->bitrate && ka->time == kb->time;
+}
+
+static void
+ssm_fragment_entry_free (GstSSFragmentEntry *entry)
+{
+  g_list_foreach (entry->buffers, (GFunc) gst_buffer_unref, NULL);
+  g_list_free (entry->buffers);
+  g_slice_free (GstSSFragmentEntry, entry);
+}
+
+GstSSFragmentCache *
+gst_ss_fragment_cache_new (guint64 max_bytes)
+{
+  GstSSFragmentCache *cache = g_new0 (GstSSFragmentCache, 1);
+
+  cache->lock = g_mutex_new ();
+  /* key is embedded in the entry, the entry is owned by the lru queue */
+  cache->entries = g_hash_table_new (ssm_fragment_key_hash, ssm_fragment_key_equal);
+  cache->lru = g_queue_new ();
+  cache->max_bytes = max_bytes;
+
+  return cache;
+}
+
+void
+gst_ss_fragment_cache_free (GstSSFragmentCache *cache)
+{
+  if (!cache)
+    return;
+
+  g_hash_table_destroy (cache->entries);
+  while (!g_queue_is_empty (cache->lru))
+    ssm_fragment_entry_free (g_queue_pop_head (cache->lru));
+  g_queue_free (cache->lru);
+  g_mutex_free (cache->lock);
+  g_free (cache);
+}
+
+/* takes ownership of the buffers & the list. Returns FALSE when the fragment
+ * can't fit in the budget at all, the buffers are released then */
+gboolean
+gst_ss_fragment_cache_insert (GstSSFragmentCache *cache, SS_STREAM_TYPE stream_type, guint track, guint bitrate, guint64 time, GList *buffers)
+{
+  GstSSFragmentEntry *entry = NULL;
+  GList *walk = NULL;
+  guint64 size = 0;
+
+  g_return_val_if_fail (cache != NULL, FALSE);
+
+  for (walk = buffers; walk; walk = g_list_next (walk))
+    size += GST_BUFFER_SIZE (walk->data);
+
+  entry = g_slice_new0 (GstSSFragmentEntry);
+  entry->key.stream_type = stream_type;
+  entry->key.track = track;
+  entry->key.bitrate = bitrate;
+  entry->key.time = time;
+  entry->buffers = buffers;
+  entry->size = size;
+
+  if (size == 0 || size > cache->max_bytes) {
+    GST_DEBUG ("fragment of %"G_GUINT64_FORMAT" bytes does not fit in cache budget %"G_GUINT64_FORMAT,
+        size, cache->max_bytes);
+    ssm_fragment_entry_free (entry);
+    return FALSE;
+  }
+
+  g_mutex_lock (cache->lock);
+
+  if (g_hash_table_lookup (cache->entries, &entry->key)) {
+    /* same fragment fetched by another path, keep the cached copy */
+    g_mutex_unlock (cache->lock);
+    ssm_fragment_entry_free (entry);
+    return TRUE;
+  }
+
+  /* evict least recently used fragments till the new one fits */
+  while (cache->cur_bytes + size > cache->max_bytes && !g_queue_is_empty (cache->lru)) {
+    GstSSFragmentEntry *old = g_queue_pop_head (cache->lru);
+
+    GST_LOG ("evicting '%s' fragment %"G_GUINT64_FORMAT" @ %u bps",
+        ssm_parse_get_stream_name (old->key.stream_type), old->key.time, old->key.bitrate);
+    g_hash_table_remove (cache->entries, &old->key);
+    cache->cur_bytes -= old->size;
+    cache->evictions++;
+    ssm_fragment_entry_free (old);
+  }
+
+  g_queue_push_tail (cache->lru, entry);
+  g_hash_table_insert (cache->entries, &entry->key, g_queue_peek_tail_link (cache->lru));
+  cache->cur_bytes += size;
+
+  g_mutex_unlock (cache->lock);
+
+  return TRUE;
+}
+
+/* returns a new list holding new references of the cached samples or NULL */
+GList *
+gst_ss_fragment_cache_lookup (GstSSFragmentCache *cache, SS_STREAM_TYPE stream_type, guint track, guint bitrate, guint64 time)
+{
+  GstSSFragmentKey key;
+  GstSSFragmentEntry *entry = NULL;
+  GList *link = NULL;
+  GList *walk = NULL;
+  GList *buffers = NULL;
+
+  g_return_val_if_fail (cache != NULL, NULL);
+
+  key.stream_type = stream_type;
+  key.track = track;
+  key.bitrate = bitrate;
+  key.time = time;
+
+  g_mutex_lock (cache->lock);
+
+  link = g_hash_table_lookup (cache->entries, &key);
+  if (!link) {
+    cache->misses++;
+    g_mutex_unlock (cache->lock);
+    return NULL;
+  }
+
+  /* move to the most recently used end */
+  g_queue_unlink (cache->lru, link);
+  g_queue_push_tail_link (cache->lru, link);
+  cache->hits++;
+
+  entry = link->data;
+  for (walk = entry->buffers; walk; walk = g_list_next (walk))
+    buffers = g_list_prepend (buffers, gst_buffer_ref (walk->data));
+
+  g_mutex_unlock (cache->lock);
+
+  return g_list_reverse (buffers);
+}
+
+void
+gst_ss_fragment_cache_get_stats (GstSSFragmentCache *cache, guint64 *hits, guint64 *misses, guint64 *evictions, guint64 *bytes)
+{
+  g_return_if_fail (cache != NULL);
+
+  g_mutex_lock (cache->lock);
+  if (hits)
+    *hits = cache->hits;
+  if (misses)
+    *misses = cache->misses;
+  if (evictions)
+    *evictions = cache->evictions;
+  if (bytes)
+    *bytes = cache->cur_bytes;
+  g_mutex_unlock (cache->lock);
+}
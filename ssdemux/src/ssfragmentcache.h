@@ -0,0 +1,32 @@
+
+#ifndef __SS_FRAGMENT_CACHE_H__
+#define __SS_FRAGMENT_CACHE_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+#include "ssmanifestparse.h"
+
+G_BEGIN_DECLS
+typedef struct _GstSSFragmentCache GstSSFragmentCache;
+
+/* parsed samples of complete fragments, keyed by (stream, track, bitrate, time)
+ * and bounded by a byte budget with LRU eviction */
+struct _GstSSFragmentCache
+{
+  GMutex *lock;
+  GHashTable *entries; /* key -> GList link in lru */
+  GQueue *lru; /* least recently used first */
+  guint64 max_bytes;
+  guint64 cur_bytes;
+  guint64 hits;
+  guint64 misses;
+  guint64 evictions;
+};
+
+GstSSFragmentCache *gst_ss_fragment_cache_new (guint64 max_bytes);
+void gst_ss_fragment_cache_free (GstSSFragmentCache *cache);
+gboolean gst_ss_fragment_cache_insert (GstSSFragmentCache *cache, SS_STREAM_TYPE stream_type, guint track, guint bitrate, guint64 time, GList *buffers);
+GList *gst_ss_fragment_cache_lookup (GstSSFragmentCache *cache, SS_STREAM_TYPE stream_type, guint track, guint bitrate, guint64 time);
+void gst_ss_fragment_cache_get_stats (GstSSFragmentCache *cache, guint64 *hits, guint64 *misses, guint64 *evictions, guint64 *bytes);
+G_END_DECLS
+#endif /* __SS_FRAGMENT_CACHE_H__ */
@@ -1,9 +1,10 @@
 #include "ssmanifestparse.h"
 
-static gboolean ssm_parse_root_node (GstSSMParse *parser, xmlNodePtr root_node);
-GstCaps * ssm_prepare_video_caps (GstSSMParse *parser, GstSSMStreamNode *stream);
-GstCaps * ssm_prepare_audio_caps (GstSSMParse *parser, GstSSMStreamNode *stream);
-GstCaps *ssm_prepare_text_caps (GstSSMParse *parser, GstSSMStreamNode *stream);
+static gboolean ssm_parse_root_node (GstSSMParse *parser, const xmlChar ** atts);
+static GstCaps *ssm_prepare_video_caps (GstSSMParse *parser, GstSSMQualityNode *quality);
+static GstCaps *ssm_prepare_audio_caps (GstSSMParse *parser, GstSSMQualityNode *quality);
+static GstCaps *ssm_prepare_text_caps (GstSSMParse *parser, GstSSMQualityNode *quality);
+static void ssm_parse_build_quality_caps (GstSSMParse *parser, GstSSMStreamNode *stream, GstSSMQualityNode *quality);
 static gboolean convert_NALUnitDCI_to_PacktizedDCI (unsigned char *nalu_dci, unsigned char **packetized_dci, unsigned int *packetized_dci_len);
 
 #define MANIFEST_LOCK(parser) g_mutex_lock(parser->lock)
@@ -40,26 +41,39 @@ int_from_string (gchar * ptr, gchar ** endptr, gint * val, gint base)
   return end != ptr;
 }
 
+static const gchar *
+ssm_parse_get_xml_prop (const xmlChar ** atts, const gchar * property)
+{
+  if (atts == NULL)
+    return NULL;
+
+  for (; atts[0]; atts += 2) {
+    if (!xmlStrcmp (atts[0], (const xmlChar *) property))
+      return (const gchar *) atts[1];
+  }
+
+  return NULL;
+}
+
 static gboolean
-ssm_parse_get_xml_prop_boolean (GstSSMParse *parser, xmlNode * node,
+ssm_parse_get_xml_prop_boolean (GstSSMParse *parser, const xmlChar ** atts,
     const gchar * property)
 {
-  xmlChar *prop_string;
+  const gchar *prop_string;
   gboolean prop_bool = FALSE;
 
-  prop_string = xmlGetProp (node, (const xmlChar *) property);
+  prop_string = ssm_parse_get_xml_prop (atts, property);
   if (prop_string) {
-    if ((xmlStrcmp (prop_string, (xmlChar *) "false") == 0) ||
-	(xmlStrcmp (prop_string, (xmlChar *) "FALSE") == 0)) {
+    if ((xmlStrcmp ((xmlChar *) prop_string, (xmlChar *) "false") == 0) ||
+	(xmlStrcmp ((xmlChar *) prop_string, (xmlChar *) "FALSE") == 0)) {
       GST_LOG (" - %s: false", property);
-    } else if ((xmlStrcmp (prop_string, (xmlChar *) "true") == 0) ||
-       (xmlStrcmp (prop_string, (xmlChar *) "TRUE") == 0)) {
+    } else if ((xmlStrcmp ((xmlChar *) prop_string, (xmlChar *) "true") == 0) ||
+       (xmlStrcmp ((xmlChar *) prop_string, (xmlChar *) "TRUE") == 0)) {
       GST_LOG(" - %s: true", property);
       prop_bool = TRUE;
     } else {
       GST_WARNING("failed to parse boolean property %s from xml string %s", property, prop_string);
     }
-    xmlFree (prop_string);
   }
 
   return prop_bool;
@@ -67,20 +81,19 @@ ssm_parse_get_xml_prop_boolean (GstSSMParse *parser, xmlNode * node,
 
 static guint
 ssm_parse_get_xml_prop_uint (GstSSMParse *parser,
-    xmlNode * node, const gchar * property, guint default_val)
+    const xmlChar ** atts, const gchar * property, guint default_val)
 {
-  xmlChar *prop_string;
+  const gchar *prop_string;
   guint prop_uint = default_val;
 
-  prop_string = xmlGetProp (node, (const xmlChar *) property);
+  prop_string = ssm_parse_get_xml_prop (atts, property);
   if (prop_string) {
-    if (sscanf ((gchar *) prop_string, "%u", &prop_uint)) {
+    if (sscanf (prop_string, "%u", &prop_uint)) {
       GST_LOG (" - %s: %u", property, prop_uint);
     } else {
       GST_WARNING("failed to parse unsigned integer property %s from xml string %s",
           property, prop_string);
     }
-    xmlFree (prop_string);
   }
 
   return prop_uint;
@@ -88,24 +101,23 @@ ssm_parse_get_xml_prop_uint (GstSSMParse *parser,
 
 static guint64
 ssm_parse_get_xml_prop_uint64 (GstSSMParse *parser,
-    xmlNode * node, const gchar * property, guint64 default_val)
+    const xmlChar ** atts, const gchar * property, guint64 default_val)
 {
-  xmlChar *prop_string;
+  const gchar *prop_string;
   guint64 prop_uint64 = default_val;
 
-  prop_string = xmlGetProp (node, (const xmlChar *) property);
+  prop_string = ssm_parse_get_xml_prop (atts, property);
   if (prop_string) {
-    if (sscanf ((gchar *) prop_string, "%llu", &prop_uint64)) {
+    if (sscanf (prop_string, "%llu", &prop_uint64)) {
       GST_LOG (" - %s: %s[%"G_GUINT64_FORMAT"]", property, prop_string, prop_uint64);
     } else {
       GST_WARNING("failed to parse unsigned integer property %s from xml string %s",
           property, prop_string);
     }
-    xmlFree (prop_string);
   }
 
   return prop_uint64;
-} 
+}
 
 static gint
 ssm_parser_sort_qualitylevels_by_bitrate (gconstpointer a, gconstpointer b)
@@ -121,18 +133,13 @@ gst_ssm_parse_free_quality_node (GstSSMQualityNode *qualitynode)
   if (qualitynode) {
     g_free (qualitynode->codec_data);
     g_free (qualitynode->fourcc);
+    g_free (qualitynode->custom_attrs);
+    if (qualitynode->caps)
+      gst_caps_unref (qualitynode->caps);
     g_slice_free (GstSSMQualityNode, qualitynode);
   }
 }
 
-static void
-gst_ssm_parse_free_fragment_node (GstSSMFragmentNode*fragnode)
-{
-  if (fragnode) {
-    g_slice_free (GstSSMFragmentNode, fragnode);
-  }
-}
-
 
 static void
 gst_ssm_parse_free_stream_node (GstSSMStreamNode *streamnode)
@@ -144,11 +151,9 @@ gst_ssm_parse_free_stream_node (GstSSMStreamNode *streamnode)
       g_list_free (streamnode->quality_lists);
       streamnode->quality_lists = NULL;
     }
-    if (streamnode->fragment_lists) {
-      streamnode->fragment_lists = g_list_first (streamnode->fragment_lists);
-      g_list_foreach (streamnode->fragment_lists, (GFunc) gst_ssm_parse_free_fragment_node, NULL);
-      g_list_free (streamnode->fragment_lists);
-      streamnode->fragment_lists = NULL;
+    if (streamnode->fragments) {
+      g_array_free (streamnode->fragments, TRUE);
+      streamnode->fragments = NULL;
     }
     if (streamnode->StreamType) {
       g_free(streamnode->StreamType);
@@ -158,6 +163,18 @@ gst_ssm_parse_free_stream_node (GstSSMStreamNode *streamnode)
       g_free(streamnode->StreamUrl);
       streamnode->StreamUrl = NULL;
     }
+    if (streamnode->url_template) {
+      guint i;
+
+      for (i = 0; i < streamnode->url_template->len; i++)
+        g_free (g_array_index (streamnode->url_template, GstSSMUrlSegment, i).literal);
+      g_array_free (streamnode->url_template, TRUE);
+      streamnode->url_template = NULL;
+    }
+    if (streamnode->url_buf) {
+      g_string_free (streamnode->url_buf, TRUE);
+      streamnode->url_buf = NULL;
+    }
     if (streamnode->StreamSubType) {
       g_free(streamnode->StreamSubType);
       streamnode->StreamSubType = NULL;
@@ -214,6 +231,20 @@ gst_ssm_parse_free (GstSSMParse *parser)
 
   g_mutex_free(parser->lock);
 
+  if (parser->sax_ctxt) {
+    xmlFreeParserCtxt (parser->sax_ctxt);
+    parser->sax_ctxt = NULL;
+  }
+
+  /* StreamIndex left open by an aborted parse */
+  gst_ssm_parse_free_stream_node (parser->cur_stream);
+  parser->cur_stream = NULL;
+
+  if (parser->protect_content) {
+    g_string_free (parser->protect_content, TRUE);
+    parser->protect_content = NULL;
+  }
+
   // TODO: cleanup memory allocated.....
   if (parser->RootNode) {
     for (i = 0; i < SS_STREAM_NUM; i++) {
@@ -223,6 +254,8 @@ gst_ssm_parse_free (GstSSMParse *parser)
       }
     }
     if (parser->RootNode->ProtectNode) {
+      g_free (parser->RootNode->ProtectNode->SystemID);
+      g_free (parser->RootNode->ProtectNode->Content);
       g_slice_free (GstSSMProtectionNode, parser->RootNode->ProtectNode);
       parser->RootNode->ProtectNode = NULL;
     }
@@ -235,12 +268,11 @@ gst_ssm_parse_free (GstSSMParse *parser)
 
 
 static gboolean
-ssm_parse_quality_node (GstSSMParse *parser, GstSSMStreamNode *stream, xmlNodePtr quality_node)
+ssm_parse_quality_node (GstSSMParse *parser, GstSSMStreamNode *stream, const xmlChar ** atts)
 {
   GstSSMQualityNode *quality_level = NULL;
 
   g_return_val_if_fail (parser != NULL, FALSE);
-  g_return_val_if_fail (quality_node != NULL, FALSE);
   g_return_val_if_fail (stream != NULL, FALSE);
 
   quality_level = g_slice_new0 (GstSSMQualityNode);
@@ -252,99 +284,101 @@ ssm_parse_quality_node (GstSSMParse *parser, GstSSMStreamNode *stream, xmlNodePt
   quality_level->codec_data = NULL;
   quality_level->fourcc = NULL;
 
-  quality_level->index = ssm_parse_get_xml_prop_uint (parser, quality_node, "Index", -1);
+  quality_level->index = ssm_parse_get_xml_prop_uint (parser, atts, "Index", -1);
   GST_DEBUG("Quality Index = %d", quality_level->index);
   if (SS_STREAM_VIDEO == stream->type && (quality_level->index == -1)) {
     GST_ERROR ("Index attribute is not present for VIDEO stream...");
-    return FALSE;
+    goto error;
   }
 
   /* MANDATORY : parsing Bitrate attribute */
-  quality_level->bitrate = ssm_parse_get_xml_prop_uint (parser, quality_node, "Bitrate", -1);
+  quality_level->bitrate = ssm_parse_get_xml_prop_uint (parser, atts, "Bitrate", -1);
   GST_DEBUG("Bitrate = %d", quality_level->bitrate);
   if (quality_level->bitrate == -1) {
     GST_ERROR ("bitrate attribute is not present...");
-    return FALSE;
+    goto error;
   }
 
   /* MANDATORY for video: parsing MaxWidth attribute */
-  quality_level->max_width = ssm_parse_get_xml_prop_uint (parser, quality_node, "MaxWidth", -1);
+  quality_level->max_width = ssm_parse_get_xml_prop_uint (parser, atts, "MaxWidth", -1);
   GST_DEBUG("MaxWidth = %d", quality_level->max_width);
   if (SS_STREAM_VIDEO == stream->type && (quality_level->max_width == -1)) {
     GST_ERROR ("max_width attribute is not present in VIDEO...");
-    return FALSE;
+    goto error;
   }
 
   /* MANDATORY for video: parsing MaxHeight attribute */
-  quality_level->max_height = ssm_parse_get_xml_prop_uint (parser, quality_node, "MaxHeight", -1);
+  quality_level->max_height = ssm_parse_get_xml_prop_uint (parser, atts, "MaxHeight", -1);
   GST_DEBUG("MaxWidth = %d", quality_level->max_height);
   if (SS_STREAM_VIDEO == stream->type && (quality_level->max_height == -1)) {
     GST_ERROR ("max_height attribute is not present in VIDEO...");
-    return FALSE;
+    goto error;
   }
 
   /* MANDATORY for audio: parsing SamplingRate attribute */
-  quality_level->samplingrate = ssm_parse_get_xml_prop_uint (parser, quality_node, "SamplingRate", -1);
+  quality_level->samplingrate = ssm_parse_get_xml_prop_uint (parser, atts, "SamplingRate", -1);
   GST_DEBUG("SamplingRate = %d", quality_level->samplingrate);
   if (SS_STREAM_AUDIO == stream->type && (quality_level->samplingrate == -1)) {
     GST_ERROR ("SamplingRate attribute is not present for AUDIO...");
-    return FALSE;
+    goto error;
   }
 
   /* MANDATORY for audio: parsing Channels attribute */
-  quality_level->channels = ssm_parse_get_xml_prop_uint (parser, quality_node, "Channels", -1);
+  quality_level->channels = ssm_parse_get_xml_prop_uint (parser, atts, "Channels", -1);
   GST_DEBUG("SamplingRate = %d", quality_level->channels);
   if (SS_STREAM_AUDIO == stream->type && (quality_level->channels == -1)) {
     GST_ERROR ("Channels attribute is not present for AUDIO...");
-    return FALSE;
+    goto error;
   }
 
   /* MANDATORY for audio: parsing BitsPerSample attribute */
-  quality_level->bps = ssm_parse_get_xml_prop_uint (parser, quality_node, "BitsPerSample", -1);
+  quality_level->bps = ssm_parse_get_xml_prop_uint (parser, atts, "BitsPerSample", -1);
   GST_DEBUG("BitsPerSample = %d", quality_level->bps);
   if (SS_STREAM_AUDIO == stream->type && (quality_level->bps == -1)) {
     GST_ERROR ("BitsPerSample attribute is not present for AUDIO...");
-    return FALSE;
+    goto error;
   }
 
   /* MANDATORY for audio: parsing PacketSize attribute */
-  quality_level->packet_size = ssm_parse_get_xml_prop_uint (parser, quality_node, "PacketSize", -1);
+  quality_level->packet_size = ssm_parse_get_xml_prop_uint (parser, atts, "PacketSize", -1);
   GST_DEBUG("PacketSize = %d", quality_level->packet_size);
   if (SS_STREAM_AUDIO == stream->type && (quality_level->packet_size == -1)) {
     GST_ERROR ("PacketSize attribute is not present for AUDIO...");
-    return FALSE;
+    goto error;
   }
 
 
   /* MANDATORY for audio: parsing AudioTag attribute */
-  quality_level->audio_tag = ssm_parse_get_xml_prop_uint (parser, quality_node, "AudioTag", -1);
+  quality_level->audio_tag = ssm_parse_get_xml_prop_uint (parser, atts, "AudioTag", -1);
   GST_DEBUG("AudioTag = %d", quality_level->audio_tag);
   if (SS_STREAM_AUDIO == stream->type && (quality_level->audio_tag == -1)) {
     GST_ERROR ("AudioTag attribute is not present for AUDIO...");
-    return FALSE;
+    goto error;
   }
 
   /* MANDATORY for audio & video: parsing FourCC attribute */
-  quality_level->fourcc = (gchar *)xmlGetProp(quality_node, (const xmlChar *) "FourCC");
+  quality_level->fourcc = g_strdup (ssm_parse_get_xml_prop (atts, "FourCC"));
   if (!quality_level->fourcc && ((SS_STREAM_AUDIO == stream->type) || (SS_STREAM_VIDEO == stream->type))) {
     GST_ERROR ("failed to parse fourcc from quality node");
-    return FALSE;
+    goto error;
   }
 
-  if (!((!strncmp ((char *)quality_level->fourcc, "AACL", 4)) || !strncmp ((char *)quality_level->fourcc, "WMAP", 4) ||
+  if (!quality_level->fourcc ||
+  !((!strncmp ((char *)quality_level->fourcc, "AACL", 4)) || !strncmp ((char *)quality_level->fourcc, "WMAP", 4) ||
   (!strncmp ((char *)quality_level->fourcc, "H264", 4)) || !strncmp ((char *)quality_level->fourcc, "WVC1", 4) ||
   (!strncmp ((char *)quality_level->fourcc, "TTML", 4)))) {
     GST_INFO ("Not a proper Fourcc Code...If possible take from SubType\n\n\n");
     if (quality_level->fourcc) {
-      free (quality_level->fourcc);
+      g_free (quality_level->fourcc);
       quality_level->fourcc = NULL;
     }
     GST_DEBUG ("Subtype = %s\n\n",stream->StreamSubType);
     quality_level->fourcc = g_strdup (stream->StreamSubType);
-    if (!((!strncmp ((char *)quality_level->fourcc, "AACL", 4)) || !strncmp ((char *)quality_level->fourcc, "WMAP", 4) ||
+    if (!quality_level->fourcc ||
+    !((!strncmp ((char *)quality_level->fourcc, "AACL", 4)) || !strncmp ((char *)quality_level->fourcc, "WMAP", 4) ||
     (!strncmp ((char *)quality_level->fourcc, "H264", 4)) || !strncmp ((char *)quality_level->fourcc, "WVC1", 4))) {
       GST_ERROR ("Subtype also does not contain valid fourcc code...ERROR\n");
-      return FALSE;
+      goto error;
     }
   }
 
@@ -353,143 +387,221 @@ ssm_parse_quality_node (GstSSMParse *parser, GstSSMStreamNode *stream, xmlNodePt
   // TODO: need to check whether it is required for all video & audio
 
   /* MANDATORY for audio & video: parsing CodecPrivateData attribute */
-  quality_level->codec_data = (gchar *)xmlGetProp(quality_node, (const xmlChar *) "CodecPrivateData");
+  quality_level->codec_data = g_strdup (ssm_parse_get_xml_prop (atts, "CodecPrivateData"));
   if (!quality_level->codec_data && ((SS_STREAM_AUDIO == stream->type) || (SS_STREAM_VIDEO == stream->type))) {
     GST_ERROR ("failed to get codec data from quality node");
-    return FALSE;
+    goto error;
   }
 
   /* Optional for VIDEO H264: parsing NALUnitLengthField attribute */
-  quality_level->NALULengthofLength = ssm_parse_get_xml_prop_uint (parser, quality_node, "NALUnitLengthField", 4);
+  quality_level->NALULengthofLength = ssm_parse_get_xml_prop_uint (parser, atts, "NALUnitLengthField", 4);
   GST_DEBUG("NALUnitLengthField = %d", quality_level->NALULengthofLength);
 
+  ssm_parse_build_quality_caps (parser, stream, quality_level);
+
   stream->quality_lists = g_list_append (stream->quality_lists, quality_level);
+  parser->cur_quality = quality_level;
 
   GST_LOG ("Appened quality level to stream...");
 
   return TRUE;
 
+error:
+  gst_ssm_parse_free_quality_node (quality_level);
+  return FALSE;
 }
 
 static gboolean
-ssm_parse_fragment_node (GstSSMParse *parser, GstSSMStreamNode *stream, xmlNodePtr fragment_node)
+ssm_parse_fragment_node (GstSSMParse *parser, GstSSMStreamNode *stream, const xmlChar ** atts)
 {
-  GstSSMFragmentNode *fragment = NULL;
-  gboolean found_time = FALSE;
-  gboolean found_duration = FALSE;
+  GstSSMFragmentNode frag = { 0, };
+  GstSSMFragmentNode *fragment = &frag;
+  GstSSMFragmentNode *prev_fragment = NULL;
 
   g_return_val_if_fail (parser != NULL, FALSE);
-  g_return_val_if_fail (fragment_node != NULL, FALSE);
   g_return_val_if_fail (stream != NULL, FALSE);
 
-  fragment = g_slice_new0 (GstSSMFragmentNode);
-  if (fragment == NULL) {
-    GST_ERROR ("Allocation of fragment failed!");
-    return FALSE;
-  }
+  if (stream->fragments->len)
+    prev_fragment = GST_SSM_STREAM_FRAGMENT (stream, stream->fragments->len - 1);
 
   /*parsing fragmentnumber attribute */
-  fragment->num = ssm_parse_get_xml_prop_uint (parser, fragment_node, "n", -1);
+  fragment->num = ssm_parse_get_xml_prop_uint (parser, atts, "n", -1);
   GST_DEBUG ("fragment number = %d", fragment->num);
 
   /*parsing duration attribute */
-  fragment->dur = ssm_parse_get_xml_prop_uint64 (parser, fragment_node, "d", -1);
-  if (fragment->dur == -1 && !fragment_node->next) {
-    GST_ERROR ("Fragment Duration for last fragment is mandatory");
-    return FALSE;
-  } else if (fragment->dur != -1) {
+  fragment->dur = ssm_parse_get_xml_prop_uint64 (parser, atts, "d", -1);
+  if (fragment->dur != -1)
     GST_DEBUG ("Fragment duration = %"GST_TIME_FORMAT, GST_TIME_ARGS (fragment->dur));
-    found_duration = TRUE;
-  }
 
   /*parsing time attribute */
-  fragment->time = ssm_parse_get_xml_prop_uint64 (parser, fragment_node, "t", -1);
-  if (fragment->time != -1) {
+  fragment->time = ssm_parse_get_xml_prop_uint64 (parser, atts, "t", -1);
+  if (fragment->time != -1)
     GST_DEBUG ("Fragment time = %"GST_TIME_FORMAT, GST_TIME_ARGS(fragment->time));
-    found_time = TRUE;
-  }
 
-  if (!found_time && !found_duration) {
+  if (fragment->time == -1 && fragment->dur == -1) {
     GST_ERROR ("Both time & duration attributes are NOT present.. ERROR");
     return FALSE;
-  } else if (!found_time && found_duration) {
-    GList *prev_fragment_list = NULL;
-    GstSSMFragmentNode *prev_fragment = NULL;
+  }
 
-    GST_DEBUG ("Only Duration attribute is present...");
-    if (stream->fragment_lists) {
-    prev_fragment_list = g_list_last(stream->fragment_lists);
-    if (NULL == prev_fragment_list) {
-      GST_ERROR ("Error last fragment lists are not present..\n");
+  /*error check for timestamps as specified in spec */
+  if (prev_fragment && fragment->time != -1 && fragment->time < prev_fragment->time) {
+    GST_ERROR ("Error in timestamp sequence...");
+    return FALSE;
+  }
+
+  /* a fragment with only a time attribute ends where this one starts */
+  if (prev_fragment && prev_fragment->dur == -1) {
+    if (fragment->time == -1) {
+      GST_ERROR ("Next fragment time not present to calculate duration of previous fragment...");
       return FALSE;
     }
-    prev_fragment = (GstSSMFragmentNode *)prev_fragment_list->data;
-    fragment->time = prev_fragment->time +  prev_fragment->dur;
-    GST_DEBUG ("Fragment time = %llu", fragment->time);
+    prev_fragment->dur = fragment->time - prev_fragment->time;
+    stream->stream_duration += prev_fragment->dur;
+    GST_DEBUG ("Previous fragment duration = %"G_GUINT64_FORMAT, prev_fragment->dur);
+  }
+
+  if (fragment->time == -1) {
+    GST_DEBUG ("Only Duration attribute is present...");
+    if (prev_fragment) {
+      fragment->time = prev_fragment->time +  prev_fragment->dur;
+      GST_DEBUG ("Fragment time = %llu", fragment->time);
     } else {
       GST_INFO ("Frament list is empty, assuming it as first fragment...");
       fragment->time = 0;
     }
-  } else if (found_time && !found_duration) {
-    xmlNodePtr next_fragment_node = NULL;
-    guint64 next_ts = 0;
+  }
 
-    GST_DEBUG ("Only time attribute is present...");
+  /* duration of a time-only fragment is known at the next <c> */
+  if (fragment->dur != -1)
+    stream->stream_duration += fragment->dur;
 
-    next_fragment_node = fragment_node->next;
-    if (next_fragment_node) {
-      next_ts = ssm_parse_get_xml_prop_uint64 (parser, fragment_node, "t", -1);
-      if (next_ts == -1) {
-        GST_ERROR ("Next fragment time not present to calculate duration of present fragment...");
-        return FALSE;
-      } else {
-        fragment->dur = next_ts - fragment->time;
-        GST_DEBUG ("Current fragment duration = %"GST_TIME_FORMAT, GST_TIME_ARGS(fragment->dur));
-      }
+  fragment->ts = gst_util_uint64_scale (fragment->time, GST_SECOND, parser->RootNode->TimeScale);
+  g_array_append_val (stream->fragments, frag);
+  GST_DEBUG ("Added fragment node to list...");
+  // TODO: Need to invetigate on TrackFragmentIndex Attribute
+
+  return TRUE;
+}
+
+static const struct
+{
+  const gchar *name;
+  SS_URL_SEGMENT_TYPE type;
+} ssm_url_placeholders[] = {
+  {"bitrate", SS_URL_SEGMENT_BITRATE},
+  {"Bitrate", SS_URL_SEGMENT_BITRATE},
+  {"start time", SS_URL_SEGMENT_START_TIME},
+  {"start_time", SS_URL_SEGMENT_START_TIME},
+  {"CustomAttributes", SS_URL_SEGMENT_CUSTOM_ATTRIBUTES},
+};
+
+static void
+ssm_parse_url_template_add (GArray *url_template, SS_URL_SEGMENT_TYPE type, GString *literal)
+{
+  GstSSMUrlSegment segment = { type, NULL };
+
+  if (type == SS_URL_SEGMENT_LITERAL) {
+    if (!literal->len)
+      return;
+    segment.literal = g_strndup (literal->str, literal->len);
+    g_string_truncate (literal, 0);
+  }
+
+  g_array_append_val (url_template, segment);
+}
+
+/* splits the Url pattern of the stream, e.g.
+ * 'QualityLevels({bitrate},{CustomAttributes})/Fragments(video={start time})',
+ * once into literal and placeholder segments, so building a fragment url
+ * does not need to tokenize it again */
+static gboolean
+ssm_parse_compile_url_template (GstSSMStreamNode *stream)
+{
+  const gchar *p = stream->StreamUrl;
+  GString *literal = g_string_new (NULL);
+  gboolean has_start_time = FALSE;
+
+  stream->url_template = g_array_new (FALSE, TRUE, sizeof (GstSSMUrlSegment));
+  stream->url_buf = g_string_sized_new (strlen (stream->StreamUrl) + 64);
+
+  while (*p) {
+    const gchar *end = NULL;
+    gsize len;
+    guint i;
+
+    if (*p != '{' || (end = strchr (p, '}')) == NULL) {
+      g_string_append_c (literal, *p++);
+      continue;
+    }
+
+    len = end - p - 1;
+    for (i = 0; i < G_N_ELEMENTS (ssm_url_placeholders); i++) {
+      if (strlen (ssm_url_placeholders[i].name) == len &&
+          !strncmp (p + 1, ssm_url_placeholders[i].name, len))
+        break;
+    }
+
+    if (i == G_N_ELEMENTS (ssm_url_placeholders)) {
+      GST_WARNING ("unknown placeholder %.*s in Url, used as it is", (int) len + 2, p);
+      g_string_append_len (literal, p, len + 2);
     } else {
-      GST_ERROR ("Next fragment not present to calculate duration of present fragment...");
-      return FALSE;
+      ssm_parse_url_template_add (stream->url_template, SS_URL_SEGMENT_LITERAL, literal);
+      ssm_parse_url_template_add (stream->url_template, ssm_url_placeholders[i].type, NULL);
+      if (ssm_url_placeholders[i].type == SS_URL_SEGMENT_START_TIME)
+        has_start_time = TRUE;
     }
+    p = end + 1;
   }
 
-#if 1
-  /*error check for timestamps as specified in spec */
-  {
-    xmlNodePtr next_fragment_node = NULL;
-    unsigned long long next_ts = 0;
-
-    next_fragment_node = fragment_node->next;
-    if (next_fragment_node) {
-      next_ts = ssm_parse_get_xml_prop_uint64 (parser, fragment_node, "t", -1);
-      if (next_ts != -1) {
-        GST_DEBUG ("Next Fragment time = %llu and Current fragment time = %llu\n", next_ts,  fragment->time);
-
-        if ( next_ts < fragment->time) {
-          GST_ERROR ("Error in timestamp sequence...");
-          return FALSE;
-        }
-      }
-    }
+  ssm_parse_url_template_add (stream->url_template, SS_URL_SEGMENT_LITERAL, literal);
+  g_string_free (literal, TRUE);
+
+  if (!has_start_time) {
+    GST_ERROR ("Url pattern %s has no {start time}", stream->StreamUrl);
+    return FALSE;
   }
-#endif
 
-  stream->stream_duration += fragment->dur;
+  GST_LOG ("compiled Url pattern into %u segments", stream->url_template->len);
 
-  stream->fragment_lists = g_list_append (stream->fragment_lists, fragment);
-  GST_DEBUG ("Added fragment node to list...");
-  // TODO: Need to invetigate on TrackFragmentIndex Attribute
+  return TRUE;
+}
+
+/* appends an Attribute of the CustomAttributes of a QualityLevel */
+static gboolean
+ssm_parse_custom_attribute_node (GstSSMParse *parser, GstSSMQualityNode *quality_level, const xmlChar ** atts)
+{
+  const gchar *name = ssm_parse_get_xml_prop (atts, "Name");
+  const gchar *value = ssm_parse_get_xml_prop (atts, "Value");
+  gchar *attrs;
+
+  if (NULL == name || NULL == value) {
+    GST_WARNING ("Attribute without Name or Value in CustomAttributes, ignored");
+    return TRUE;
+  }
+
+  if (quality_level->custom_attrs)
+    attrs = g_strdup_printf ("%s,%s=%s", quality_level->custom_attrs, name, value);
+  else
+    attrs = g_strdup_printf ("%s=%s", name, value);
+
+  g_free (quality_level->custom_attrs);
+  quality_level->custom_attrs = attrs;
+  GST_DEBUG ("CustomAttributes = %s", quality_level->custom_attrs);
 
   return TRUE;
 }
 
 static gboolean
-ssm_parse_stream_index_node (GstSSMParse *parser, xmlNodePtr stream_node)
+ssm_parse_stream_index_node (GstSSMParse *parser, const xmlChar ** atts)
 {
   GstSSMStreamNode *stream = NULL;
-  xmlNodePtr stream_children = NULL;
 
   g_return_val_if_fail (parser != NULL, FALSE);
-  g_return_val_if_fail (stream_node != NULL, FALSE);
+
+  if (parser->cur_stream) {
+    GST_ERROR ("StreamIndex nested in StreamIndex '%s'", parser->cur_stream->StreamType);
+    return FALSE;
+  }
 
   stream = g_slice_new0 (GstSSMStreamNode);
   if (stream == NULL) {
@@ -497,11 +609,16 @@ ssm_parse_stream_index_node (GstSSMParse *parser, xmlNodePtr stream_node)
     return FALSE;
   }
 
+  /* owned by the parser until the StreamIndex element is closed */
+  parser->cur_stream = stream;
+
   stream->frag_lock = g_mutex_new ();
   stream->frag_cond = g_cond_new ();
+  stream->fragments = g_array_new (FALSE, TRUE, sizeof (GstSSMFragmentNode));
+  stream->frag_index = 0;
 
   /* Type, Chunks, QualityLevels are MUST attributes */
-  stream->StreamType = (gchar *)xmlGetProp(stream_node, (const xmlChar *) "Type");
+  stream->StreamType = g_strdup (ssm_parse_get_xml_prop (atts, "Type"));
   if (NULL == stream->StreamType) {
     GST_ERROR ("Type attribute is not present");
     return FALSE;
@@ -520,78 +637,75 @@ ssm_parse_stream_index_node (GstSSMParse *parser, xmlNodePtr stream_node)
   }
 
   /* Optional SubType Attribute */
-  stream->StreamSubType = (gchar *)xmlGetProp(stream_node, (const xmlChar *) "Subtype");
+  stream->StreamSubType = g_strdup (ssm_parse_get_xml_prop (atts, "Subtype"));
   if (stream->StreamSubType)
     GST_DEBUG ("StreamSubType = %s", stream->StreamSubType);
 
-  stream->StreamTimeScale = ssm_parse_get_xml_prop_uint64 (parser, stream_node, "TimeScale", parser->RootNode->TimeScale);
+  stream->StreamTimeScale = ssm_parse_get_xml_prop_uint64 (parser, atts, "TimeScale", parser->RootNode->TimeScale);
   GST_LOG("StreamTimeScale = %"G_GUINT64_FORMAT, stream->StreamTimeScale);
 
   /* Optional StreamName Attribute */
-  stream->StreamName = (gchar *)xmlGetProp(stream_node, (const xmlChar *) "Name");
+  stream->StreamName = g_strdup (ssm_parse_get_xml_prop (atts, "Name"));
   if (stream->StreamName)
     GST_DEBUG ("StreamName = %s", stream->StreamName);
 
   // TODO: need to understand more on this chunks whether mandatory or not in LIVE case
-  stream->nChunks = ssm_parse_get_xml_prop_uint (parser, stream_node, "Chunks", 0);
+  stream->nChunks = ssm_parse_get_xml_prop_uint (parser, atts, "Chunks", 0);
   if (!stream->nChunks && !parser->RootNode->PresentationIsLive) {
     GST_ERROR ("nChunks is zero in VOD case...ERROR");
     return FALSE;
   }
   GST_DEBUG("nChunks = %d", stream->nChunks);
 
-  stream->nQualityLevels = ssm_parse_get_xml_prop_uint (parser, stream_node, "QualityLevels", 0);
+  stream->nQualityLevels = ssm_parse_get_xml_prop_uint (parser, atts, "QualityLevels", 0);
   GST_DEBUG("nQualityLevels = %d", stream->nQualityLevels);
 
-  stream->StreamUrl = (gchar *)xmlGetProp(stream_node, (const xmlChar *) "Url");
+  stream->StreamUrl = g_strdup (ssm_parse_get_xml_prop (atts, "Url"));
   if (NULL == stream->StreamUrl) {
     GST_ERROR ("Url Pattern attribute is not present");
     return FALSE;
   }
   GST_DEBUG ("Url = %s", stream->StreamUrl);
 
+  if (!ssm_parse_compile_url_template (stream)) {
+    GST_ERROR ("failed to compile Url pattern");
+    return FALSE;
+  }
+
   if (stream->type == SS_STREAM_VIDEO) {
     /* Video stream specific attributes */
-    stream->MaxWidth = ssm_parse_get_xml_prop_uint (parser, stream_node, "MaxWidth", 0);
+    stream->MaxWidth = ssm_parse_get_xml_prop_uint (parser, atts, "MaxWidth", 0);
     GST_DEBUG("MaxWidth = %d", stream->MaxWidth);
 
-    stream->MaxHeight = ssm_parse_get_xml_prop_uint (parser, stream_node, "MaxHeight", 0);
+    stream->MaxHeight = ssm_parse_get_xml_prop_uint (parser, atts, "MaxHeight", 0);
     GST_DEBUG("MaxHeight = %d", stream->MaxHeight);
 
-    stream->DisplayWidth = ssm_parse_get_xml_prop_uint (parser, stream_node, "DisplayWidth", 0);
+    stream->DisplayWidth = ssm_parse_get_xml_prop_uint (parser, atts, "DisplayWidth", 0);
     GST_DEBUG("DisplayWidth = %d", stream->DisplayWidth);
 
-    stream->DisplayHeight = ssm_parse_get_xml_prop_uint (parser, stream_node, "DisplayHeight", 0);
+    stream->DisplayHeight = ssm_parse_get_xml_prop_uint (parser, atts, "DisplayHeight", 0);
     GST_DEBUG("DisplayHeight = %d", stream->DisplayHeight);
   }
 
-  /* get the children nodes */
-  stream_children = stream_node->xmlChildrenNode;
-  if (NULL == stream_children) {
+  return TRUE;
+}
+
+/* called when the StreamIndex element is closed, all its QualityLevel
+ * and c children have been parsed at that point */
+static gboolean
+ssm_parse_stream_index_end (GstSSMParse *parser)
+{
+  GstSSMStreamNode *stream = parser->cur_stream;
+
+  if (NULL == stream->quality_lists && 0 == stream->fragments->len) {
     GST_ERROR ("No Children for StreamIndex Node...\n");
     return FALSE;
   }
 
-  /* Parse StreamIndex Children Nodes i.e. QualityLevel */
-  while (stream_children) {
-    if ( xmlIsBlankNode (stream_children)) {/* skip blank nodes */
-      stream_children = stream_children->next;
-      continue;
-    }
-    if (!xmlStrcmp(stream_children->name, (const xmlChar *) "QualityLevel")) {
-      if (!ssm_parse_quality_node (parser, stream, stream_children)) {
-        GST_ERROR ("failed to parse quality node");
-        return FALSE;
-      }
-    } else if (!xmlStrcmp(stream_children->name, (const xmlChar *) "c")) {
-      if (!ssm_parse_fragment_node (parser, stream, stream_children)) {
-        GST_ERROR ("failed to parse fragment node");
-        return FALSE;
-      }
-    } else {
-      GST_WARNING (" ==== >>>>>> Unknow ChildrenNode in StreamNode : %s", stream_children->name);
-    }
-    stream_children = stream_children->next;
+  if (stream->fragments->len &&
+      GST_SSM_STREAM_FRAGMENT (stream, stream->fragments->len - 1)->dur == -1) {
+    GST_ERROR ("Fragment Duration for last fragment is mandatory");
+    return FALSE;
   }
 
   /* sort the quality lists */
@@ -599,22 +713,28 @@ ssm_parse_stream_index_node (GstSSMParse *parser, xmlNodePtr stream_node)
     stream->quality_lists =  g_list_sort (stream->quality_lists,  (GCompareFunc) ssm_parser_sort_qualitylevels_by_bitrate);
   }
 
+  stream->index = g_list_length (parser->RootNode->streams[stream->type]);
   parser->RootNode->streams[stream->type] = g_list_append (parser->RootNode->streams[stream->type], stream);
+  parser->cur_stream = NULL;
 
-  return TRUE;
+  GST_DEBUG ("parsed '%s' stream with %u fragments", ssm_parse_get_stream_name (stream->type),
+      stream->fragments->len);
 
+  return TRUE;
 }
 
 
 static gboolean
-ssm_parse_protection_node (GstSSMParse *parser, xmlNodePtr protection_node)
+ssm_parse_protection_node (GstSSMParse *parser, const xmlChar ** atts)
 {
-  xmlChar *xml_string = NULL;
-
   g_return_val_if_fail (parser != NULL, FALSE);
-  g_return_val_if_fail (protection_node != NULL, FALSE);
 
-  parser->RootNode->ProtectNode = g_slice_new0 (GstSSMFragmentNode);
+  if (parser->RootNode->ProtectNode) {
+    GST_ERROR ("more than one ProtectionHeader in Protection node...\n");
+    return FALSE;
+  }
+
+  parser->RootNode->ProtectNode = g_slice_new0 (GstSSMProtectionNode);
   if (NULL == parser->RootNode->ProtectNode) {
     GST_ERROR ("Failed to allocate memory...\n");
     return FALSE;
@@ -624,63 +744,66 @@ ssm_parse_protection_node (GstSSMParse *parser, xmlNodePtr protection_node)
   parser->RootNode->ProtectNode->Content = NULL;
   parser->RootNode->ProtectNode->ContentSize = 0;
 
-  if (!xmlStrcmp(protection_node->name, (const xmlChar *) "ProtectionHeader")) {
-    parser->RootNode->ProtectNode->SystemID = (unsigned char *) xmlGetProp(protection_node, (const xmlChar *) "SystemID");
-    if (NULL == parser->RootNode->ProtectNode->SystemID) {
-      GST_ERROR ("System ID is not present... need to decide ERROR or NOT... returning ERROR now\n");
-      return FALSE;
-    }
+  parser->RootNode->ProtectNode->SystemID = g_strdup (ssm_parse_get_xml_prop (atts, "SystemID"));
+  if (NULL == parser->RootNode->ProtectNode->SystemID) {
+    GST_ERROR ("System ID is not present... need to decide ERROR or NOT... returning ERROR now\n");
+    return FALSE;
+  }
 
-    GST_DEBUG ("system ID = %s\n", parser->RootNode->ProtectNode->SystemID);
+  GST_DEBUG ("system ID = %s\n", parser->RootNode->ProtectNode->SystemID);
 
-    if (!strncasecmp ((char *)parser->RootNode->ProtectNode->SystemID,
-           "9A04F079-9840-4286-AB92-E65BE0885F95",
-           36)) {
-      g_print ("======== >>>>>>>. Content is encrypted using PLAYREADY\n");
-    } else {
-      GST_ERROR ("\n\n ******** UN-supported encrypted content... *********\n\n");
-      return FALSE;
-    }
+  if (!strncasecmp ((char *)parser->RootNode->ProtectNode->SystemID,
+         "9A04F079-9840-4286-AB92-E65BE0885F95",
+         36)) {
+    g_print ("======== >>>>>>>. Content is encrypted using PLAYREADY\n");
+  } else {
+    GST_ERROR ("\n\n ******** UN-supported encrypted content... *********\n\n");
+    return FALSE;
+  }
 
-    xml_string = xmlNodeGetContent(protection_node);
-    if (NULL == xml_string) {
-      GST_ERROR ("Content is not present... need to decide ERROR or NOT\n");
-      return FALSE;
-    } else {
-      gsize content_size = 0;
+  /* base64 content arrives through the characters callback */
+  parser->protect_content = g_string_new (NULL);
 
-      g_print ("Content = %s\n", xml_string);
+  return TRUE;
+}
 
-      parser->RootNode->ProtectNode->Content = g_base64_decode ((gchar*)xml_string, &content_size);
-      if (NULL == parser->RootNode->ProtectNode->Content) {
-        GST_ERROR ("Failed to do base64 decoding...\n");
-        free (xml_string);
-        xml_string = NULL;
-        return FALSE;
-      }
+static gboolean
+ssm_parse_protection_content (GstSSMParse *parser)
+{
+  gchar *xml_string = NULL;
+  gsize content_size = 0;
 
-      parser->RootNode->ProtectNode->ContentSize = content_size;
-      free (xml_string);
-      xml_string = NULL;
+  xml_string = g_strstrip (g_string_free (parser->protect_content, FALSE));
+  parser->protect_content = NULL;
 
-      GST_DEBUG ("ProtectionNode content = %s and size = %d\n", parser->RootNode->ProtectNode->Content, content_size);
-    }
-  } else {
-    GST_ERROR ("ProtectionHeader is NOT PRESENT in Protection node...ERROR\n");
+  if ('\0' == *xml_string) {
+    GST_ERROR ("Content is not present... need to decide ERROR or NOT\n");
+    g_free (xml_string);
     return FALSE;
   }
 
+  g_print ("Content = %s\n", xml_string);
+
+  parser->RootNode->ProtectNode->Content = (gchar *) g_base64_decode (xml_string, &content_size);
+  g_free (xml_string);
+  if (NULL == parser->RootNode->ProtectNode->Content) {
+    GST_ERROR ("Failed to do base64 decoding...\n");
+    return FALSE;
+  }
+
+  parser->RootNode->ProtectNode->ContentSize = content_size;
+
+  GST_DEBUG ("ProtectionNode content = %s and size = %d\n", parser->RootNode->ProtectNode->Content, content_size);
   GST_LOG ("successfully parsed protectionheader node...");
   return TRUE;
 }
 
 static gboolean
-ssm_parse_root_node (GstSSMParse *parser, xmlNodePtr root_node)
+ssm_parse_root_node (GstSSMParse *parser, const xmlChar ** atts)
 {
   int i = 0;
 
   g_return_val_if_fail (parser != NULL, FALSE);
-  g_return_val_if_fail (root_node != NULL, FALSE);
 
   parser->RootNode = g_slice_new0 (GstSSMRootNode);
   if (parser->RootNode == NULL) {
@@ -695,7 +818,7 @@ ssm_parse_root_node (GstSSMParse *parser, xmlNodePtr root_node)
   parser->RootNode->ProtectNode = NULL;
 
   /* MANDATORY : parsing MajorVersion attribute */
-  parser->RootNode->MajorVersion = ssm_parse_get_xml_prop_uint (parser, root_node, "MajorVersion", -1);
+  parser->RootNode->MajorVersion = ssm_parse_get_xml_prop_uint (parser, atts, "MajorVersion", -1);
   if (parser->RootNode->MajorVersion != 2) {
     GST_ERROR("Majorversion should be 2");
     return FALSE;
@@ -703,31 +826,31 @@ ssm_parse_root_node (GstSSMParse *parser, xmlNodePtr root_node)
   GST_LOG("SmoothStreamingMedia :: Majorversion = %d", parser->RootNode->MajorVersion);
 
   /* MANDATORY : parsing MinorVersion attribute */
-  parser->RootNode->MinorVersion = ssm_parse_get_xml_prop_uint (parser, root_node, "MinorVersion", 0);
+  parser->RootNode->MinorVersion = ssm_parse_get_xml_prop_uint (parser, atts, "MinorVersion", 0);
   GST_LOG("SmoothStreamingMedia :: MinorVersion = %d", parser->RootNode->MinorVersion);
 
-  parser->RootNode->TimeScale = ssm_parse_get_xml_prop_uint64 (parser, root_node, "TimeScale", 10000000);
+  parser->RootNode->TimeScale = ssm_parse_get_xml_prop_uint64 (parser, atts, "TimeScale", 10000000);
   GST_LOG("SmoothStreamingMedia :: TimeScale = %"G_GUINT64_FORMAT, parser->RootNode->TimeScale);
 
-  parser->RootNode->Duration = ssm_parse_get_xml_prop_uint64 (parser, root_node, "Duration", -1);
+  parser->RootNode->Duration = ssm_parse_get_xml_prop_uint64 (parser, atts, "Duration", -1);
   GST_LOG("SmoothStreamingMedia :: Duration = %"G_GUINT64_FORMAT, parser->RootNode->Duration);
 
-  parser->RootNode->PresentationIsLive = ssm_parse_get_xml_prop_boolean (parser, root_node, "IsLive");
+  parser->RootNode->PresentationIsLive = ssm_parse_get_xml_prop_boolean (parser, atts, "IsLive");
   GST_LOG("SmoothStreamingMedia :: IsLive = %d", parser->RootNode->PresentationIsLive);
 
   /* valid for live presentation only*/
   if (parser->RootNode->PresentationIsLive) {
 
-    parser->RootNode->LookAheadCount = ssm_parse_get_xml_prop_uint (parser, root_node, "LookaheadCount", -1);
+    parser->RootNode->LookAheadCount = ssm_parse_get_xml_prop_uint (parser, atts, "LookaheadCount", -1);
     GST_LOG("SmoothStreamingMedia :: LookaheadCount = %d", parser->RootNode->LookAheadCount);
 
     if (parser->RootNode->LookAheadCount == -1) {
      GST_INFO ("fallback case of lookaheadcount...");
-     parser->RootNode->LookAheadCount = ssm_parse_get_xml_prop_uint (parser, root_node, "LookAheadFragmentCount", -1);
+     parser->RootNode->LookAheadCount = ssm_parse_get_xml_prop_uint (parser, atts, "LookAheadFragmentCount", -1);
      GST_LOG("SmoothStreamingMedia :: LookAheadFragmentCount = %d", parser->RootNode->LookAheadCount);
     }
 
-    parser->RootNode->DVRWindowLength = ssm_parse_get_xml_prop_uint64 (parser, root_node, "DVRWindowLength", 0);
+    parser->RootNode->DVRWindowLength = ssm_parse_get_xml_prop_uint64 (parser, atts, "DVRWindowLength", 0);
     GST_LOG("SmoothStreamingMedia :: DVRWindowLength = %"G_GUINT64_FORMAT, parser->RootNode->DVRWindowLength);
     if (parser->RootNode->DVRWindowLength == 0)
       GST_INFO ("DVR Window Length is zero...means INFINITE");
@@ -736,108 +859,33 @@ ssm_parse_root_node (GstSSMParse *parser, xmlNodePtr root_node)
   return TRUE;
 }
 
-
-gboolean
-gst_ssm_parse_manifest (GstSSMParse *parser, char *data, unsigned int size)
+/* called when the root element is closed */
+static gboolean
+ssm_parse_root_node_end (GstSSMParse *parser)
 {
-  xmlNodePtr root = NULL;
-  xmlNodePtr curnode = NULL;
-  xmlDocPtr doc;
   int i;
 
-  g_return_val_if_fail (parser != NULL, FALSE);
-  g_return_val_if_fail (data != NULL, FALSE);
-  g_return_val_if_fail (size != 0, FALSE);
-
-  /* parse manifest xml file */
-  doc = xmlReadMemory ((gchar *) data, size, NULL, NULL, 0);
-  if (doc == NULL ) {
-    GST_ERROR("failed to parse manifest file...");
-    goto error;
-  }
-
-  /* Get the root element */
-  root = xmlDocGetRootElement(doc);
-  if (root == NULL) {
-    GST_ERROR("no ROOT node in manifest file...");
-    goto error;
-  }
-
-  if (!xmlStrcmp(root->name, (const xmlChar *) "SmoothStreamingMedia"))  {
-    /* parsing of ROOT Node SmoothStreamingMedia attributes */
-    if (!ssm_parse_root_node (parser, root)) {
-      GST_ERROR("failed to parse root node...");
-      goto error;
-    }
-    GST_DEBUG ("Parsing ROOT element is successful");
-  } else {
-    GST_ERROR ("SmoothStreamingMedia ROOT element is not present...");
-    goto error;
-  }
-
-  /* moving to children nodes */
-  curnode = root->xmlChildrenNode;
-
-  while (curnode) {
-    if (xmlIsBlankNode (curnode)) {/* skip blank node */
-      curnode = curnode->next;
-      continue;
-    }
-
-    if (!xmlStrcmp(curnode->name, (const xmlChar *)"StreamIndex")) {
-      /* Parsing Stream Node */
-      if (!ssm_parse_stream_index_node (parser, curnode)) {
-        GST_ERROR ("failed to parse stream index node...");
-        return FALSE;
-      }
-    } else if (!xmlStrcmp(curnode->name, (const xmlChar *) "Protection")) {
-      xmlNodePtr protect_node;
-
-      /* get the children */
-      protect_node = curnode->xmlChildrenNode;
-      if (NULL == protect_node) {
-        GST_ERROR ("No Children for Protection Node...\n");
-        return FALSE;
-      } else {
-        if (!ssm_parse_protection_node (parser, protect_node)) {
-          GST_ERROR ("failed to parse protectionheader node");
-          return FALSE;
-        }
-      }
-    }
-    curnode = curnode->next;
-  }
-
-  /* Move to last fragment when presentation is LIVE */
-  if (parser->RootNode->PresentationIsLive) {
-    for (i = 0; i < SS_STREAM_NUM; i++) {
-      if (parser->RootNode->streams[i]) {
-        GST_INFO ("Live presentation, so moved to last node...");
-        ((GstSSMStreamNode *)(parser->RootNode->streams[i]->data))->fragment_lists =
-			g_list_last (((GstSSMStreamNode *)(parser->RootNode->streams[i]->data))->fragment_lists);
-      }
-    }
-  }
-
   parser->ns_start = 0;
 
   /* get new segment start */
   for (i = 0; i < SS_STREAM_NUM; i++) {
     GstSSMStreamNode *stream = NULL;
-    GList *frag_list = NULL;
     guint64 start_ts = GST_CLOCK_TIME_NONE;
 
     if (parser->RootNode->streams[i]) {
+      stream = (parser->RootNode->streams[i])->data;
+      if (!stream->fragments->len) {
+        GST_ERROR ("'%s' stream has no fragments", ssm_parse_get_stream_name(i));
+        return FALSE;
+      }
+
       /* Move to last fragment when presentation is LIVE */
       if (parser->RootNode->PresentationIsLive) {
         GST_INFO ("Live presentation, so moved to last node...");
-        ((GstSSMStreamNode *)(parser->RootNode->streams[i]->data))->fragment_lists =
-            g_list_last (((GstSSMStreamNode *)(parser->RootNode->streams[i]->data))->fragment_lists);
+        stream->frag_index = stream->fragments->len - 1;
       }
 
-      stream = (parser->RootNode->streams[i])->data;
-      frag_list = stream->fragment_lists;
-      start_ts = ((GstSSMFragmentNode *)frag_list->data)->time;
+      start_ts = GST_SSM_STREAM_FRAGMENT (stream, stream->frag_index)->time;
 
       GST_LOG ("ns_start = %"G_GUINT64_FORMAT" and start_ts[%s] = %"G_GUINT64_FORMAT,
           parser->ns_start, ssm_parse_get_stream_name(i), start_ts);
@@ -849,104 +897,268 @@ gst_ssm_parse_manifest (GstSSMParse *parser, char *data, unsigned int size)
 
   GST_INFO ("ns_start = %"G_GUINT64_FORMAT, parser->ns_start);
 
-  if (doc) {
-    xmlFreeDoc(doc);
-    doc = NULL;
-  }
-
-  GST_DEBUG ("successfully parsed manifest");
+  parser->complete = TRUE;
 
   return TRUE;
-
-error:
-  if (doc) {
-    xmlFreeDoc(doc);
-    doc = NULL;
-  }
-
-  return FALSE;
 }
 
-/* Only supporting url in 'QualityLevels({bitrate})/Fragments(xxxxxx={start time})'
-  * FIXME : Add support for any */
-gboolean
-gst_ssm_parse_get_next_fragment_url (GstSSMParse *parser, SS_STREAM_TYPE stream_type, gchar **uri, guint64 *start_ts)
+static void
+ssm_parse_sax_fail (GstSSMParse *parser)
 {
-  GstSSMStreamNode *stream = NULL;
-  GList *frag_list = NULL;
-  GPtrArray *strs;
-  guint64 time = 0;
-  gchar **splitter1 = NULL;
-  gchar **splitter2 = NULL;
-  gchar **splitter3 = NULL;
-
-  MANIFEST_LOCK(parser);
-  stream = (parser->RootNode->streams[stream_type])->data; //get current video stream
-  g_mutex_lock (stream->frag_lock);
+  parser->sax_error = TRUE;
+  xmlStopParser (parser->sax_ctxt);
+}
 
-  if (stream->fraglist_eos) {
-    if (parser->RootNode->PresentationIsLive) {
-      /* Live Presentation need to wait for next uri */
-      g_print ("waiting for next URI in LIVE presentation...\n");
-      g_cond_wait (stream->frag_cond, stream->frag_lock);
-      g_print ("Received signal after appending new URI...move to next now\n");
-     ((GstSSMStreamNode *)(parser->RootNode->streams[stream_type]->data))->fragment_lists =
-	 g_list_next (((GstSSMStreamNode *)(parser->RootNode->streams[stream_type]->data))->fragment_lists);
+static void
+ssm_parse_sax_start_element (void *ctx, const xmlChar * name, const xmlChar ** atts)
+{
+  GstSSMParse *parser = (GstSSMParse *) ctx;
+  gboolean ret = TRUE;
+
+  if (parser->sax_error || parser->complete)
+    return;
+
+  if (NULL == parser->RootNode) {
+    if (!xmlStrcmp (name, (const xmlChar *) "SmoothStreamingMedia")) {
+      /* parsing of ROOT Node SmoothStreamingMedia attributes */
+      ret = ssm_parse_root_node (parser, atts);
+      if (!ret)
+        GST_ERROR ("failed to parse root node...");
     } else {
-      /* VOD presentation reached EOS */
-      GST_INFO("Fragment list is empty in VOD case...");
-      g_mutex_unlock (stream->frag_lock);
-      MANIFEST_UNLOCK(parser);
-      return FALSE;
+      GST_ERROR ("SmoothStreamingMedia ROOT element is not present...");
+      ret = FALSE;
     }
+  } else if (!xmlStrcmp (name, (const xmlChar *) "StreamIndex")) {
+    ret = ssm_parse_stream_index_node (parser, atts);
+    if (!ret)
+      GST_ERROR ("failed to parse stream index node...");
+  } else if (parser->cur_stream && !xmlStrcmp (name, (const xmlChar *) "QualityLevel")) {
+    ret = ssm_parse_quality_node (parser, parser->cur_stream, atts);
+    if (!ret)
+      GST_ERROR ("failed to parse quality node");
+  } else if (parser->cur_quality && !xmlStrcmp (name, (const xmlChar *) "Attribute")) {
+    ret = ssm_parse_custom_attribute_node (parser, parser->cur_quality, atts);
+  } else if (parser->cur_stream && !xmlStrcmp (name, (const xmlChar *) "c")) {
+    ret = ssm_parse_fragment_node (parser, parser->cur_stream, atts);
+    if (!ret)
+      GST_ERROR ("failed to parse fragment node");
+  } else if (!xmlStrcmp (name, (const xmlChar *) "Protection")) {
+    parser->in_protection = TRUE;
+  } else if (parser->in_protection && !xmlStrcmp (name, (const xmlChar *) "ProtectionHeader")) {
+    ret = ssm_parse_protection_node (parser, atts);
+    if (!ret)
+      GST_ERROR ("failed to parse protectionheader node");
+  } else {
+    GST_LOG ("skipping element %s", name);
   }
 
-  stream = (parser->RootNode->streams[stream_type])->data; //get current video stream
-
-  frag_list = stream->fragment_lists;
+  if (!ret)
+    ssm_parse_sax_fail (parser);
+}
 
-  strs = g_ptr_array_new ();
+static void
+ssm_parse_sax_end_element (void *ctx, const xmlChar * name)
+{
+  GstSSMParse *parser = (GstSSMParse *) ctx;
+  gboolean ret = TRUE;
+
+  if (parser->sax_error || parser->complete)
+    return;
+
+  if (parser->cur_quality && !xmlStrcmp (name, (const xmlChar *) "QualityLevel")) {
+    parser->cur_quality = NULL;
+  } else if (parser->cur_stream && !xmlStrcmp (name, (const xmlChar *) "StreamIndex")) {
+    ret = ssm_parse_stream_index_end (parser);
+  } else if (parser->protect_content && !xmlStrcmp (name, (const xmlChar *) "ProtectionHeader")) {
+    ret = ssm_parse_protection_content (parser);
+  } else if (parser->in_protection && !xmlStrcmp (name, (const xmlChar *) "Protection")) {
+    parser->in_protection = FALSE;
+    if (NULL == parser->RootNode->ProtectNode) {
+      GST_ERROR ("ProtectionHeader is NOT PRESENT in Protection node...ERROR\n");
+      ret = FALSE;
+    }
+  } else if (!xmlStrcmp (name, (const xmlChar *) "SmoothStreamingMedia")) {
+    ret = ssm_parse_root_node_end (parser);
+  }
 
-  /* adding presentation uri */
-  g_ptr_array_add (strs, g_strdup(parser->presentation_uri));
+  if (!ret)
+    ssm_parse_sax_fail (parser);
+}
 
-  splitter1 = g_strsplit (stream->StreamUrl, "{", 3);
+static void
+ssm_parse_sax_characters (void *ctx, const xmlChar * ch, int len)
+{
+  GstSSMParse *parser = (GstSSMParse *) ctx;
 
-  /* add stream url till first '{' */
-  g_ptr_array_add (strs, g_strdup(splitter1[0]));
+  /* only the ProtectionHeader carries text content */
+  if (parser->protect_content)
+    g_string_append_len (parser->protect_content, (const gchar *) ch, len);
+}
 
-  /* adding bitrate param */
-  g_ptr_array_add (strs, g_strdup_printf ("%d", ((GstSSMQualityNode *)stream->quality_lists->data)->bitrate));
+/* Feed the next piece of the manifest to the SAX push parser. The RootNode
+ * is filled while elements are closed, GST_SSM_PARSE_IS_COMPLETE() turns TRUE
+ * as soon as the root element is closed. Data after that is ignored. */
+gboolean
+gst_ssm_parse_manifest_push (GstSSMParse *parser, const char *data, unsigned int size)
+{
+  int err;
 
-  /* tokenize based on '}' */
-  splitter2 = g_strsplit (splitter1[1], "}", 2);
+  g_return_val_if_fail (parser != NULL, FALSE);
 
-  g_ptr_array_add (strs, g_strdup(splitter2[1]));
+  if (parser->sax_error)
+    return FALSE;
 
-  time = ((GstSSMFragmentNode *)frag_list->data)->time;
+  if (parser->complete)
+    return TRUE;
 
-  /* adding fragment time */
-  g_ptr_array_add (strs, g_strdup_printf ("%llu", time));
+  if (NULL == parser->sax_ctxt) {
+    xmlSAXHandler sax;
 
-  *start_ts = gst_util_uint64_scale (time, GST_SECOND, parser->RootNode->TimeScale);
+    memset (&sax, 0, sizeof (sax));
+    sax.startElement = ssm_parse_sax_start_element;
+    sax.endElement = ssm_parse_sax_end_element;
+    sax.characters = ssm_parse_sax_characters;
 
-  /* tokenize based on '}' */
-  splitter3 = g_strsplit (splitter1[2], "}", 2);
+    parser->sax_ctxt = xmlCreatePushParserCtxt (&sax, parser, NULL, 0, parser->uri);
+    if (NULL == parser->sax_ctxt) {
+      GST_ERROR ("failed to create manifest parser...");
+      parser->sax_error = TRUE;
+      return FALSE;
+    }
+  }
 
-  g_ptr_array_add (strs, g_strdup(splitter3[1]));
+  err = xmlParseChunk (parser->sax_ctxt, data, size, 0);
+  if (err != XML_ERR_OK || parser->sax_error) {
+    GST_ERROR ("failed to parse manifest file... (%d)", err);
+    parser->sax_error = TRUE;
+    return FALSE;
+  }
 
-  /* add a terminating NULL */
-  g_ptr_array_add (strs, NULL);
+  if (parser->complete) {
+    xmlFreeParserCtxt (parser->sax_ctxt);
+    parser->sax_ctxt = NULL;
+    GST_DEBUG ("successfully parsed manifest");
+  }
 
-  if (frag_list = g_list_next (((GstSSMStreamNode *)(parser->RootNode->streams[stream_type]->data))->fragment_lists)) {
-    ((GstSSMStreamNode *)(parser->RootNode->streams[stream_type]->data))->fragment_lists = frag_list;
-  } else {
-    GST_INFO ("Reached end of fragment list...\n");
-    ((GstSSMStreamNode *)(parser->RootNode->streams[stream_type]->data))->fraglist_eos = TRUE;
+  return TRUE;
+}
+
+/* Terminate the push parse at the end of the manifest data */
+gboolean
+gst_ssm_parse_manifest_finish (GstSSMParse *parser)
+{
+  g_return_val_if_fail (parser != NULL, FALSE);
+
+  if (parser->sax_ctxt) {
+    if (!parser->sax_error && !parser->complete)
+      xmlParseChunk (parser->sax_ctxt, NULL, 0, 1);
+    xmlFreeParserCtxt (parser->sax_ctxt);
+    parser->sax_ctxt = NULL;
+  }
+
+  if (!parser->complete) {
+    GST_ERROR ("manifest ended before the ROOT element was closed...");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+gboolean
+gst_ssm_parse_manifest (GstSSMParse *parser, char *data, unsigned int size)
+{
+  g_return_val_if_fail (parser != NULL, FALSE);
+  g_return_val_if_fail (data != NULL, FALSE);
+  g_return_val_if_fail (size != 0, FALSE);
+
+  if (!gst_ssm_parse_manifest_push (parser, data, size))
+    return FALSE;
+
+  return gst_ssm_parse_manifest_finish (parser);
+}
+
+static void
+ssm_parse_build_fragment_url (GstSSMParse *parser, GstSSMStreamNode *stream,
+    GstSSMQualityNode *quality_level, guint64 time)
+{
+  GString *url = stream->url_buf;
+  guint i;
+
+  g_string_assign (url, parser->presentation_uri);
+
+  for (i = 0; i < stream->url_template->len; i++) {
+    GstSSMUrlSegment *segment = &g_array_index (stream->url_template, GstSSMUrlSegment, i);
+
+    switch (segment->type) {
+      case SS_URL_SEGMENT_LITERAL:
+        g_string_append (url, segment->literal);
+        break;
+      case SS_URL_SEGMENT_BITRATE:
+        g_string_append_printf (url, "%u", quality_level ? quality_level->bitrate : 0);
+        break;
+      case SS_URL_SEGMENT_START_TIME:
+        g_string_append_printf (url, "%"G_GUINT64_FORMAT, time);
+        break;
+      case SS_URL_SEGMENT_CUSTOM_ATTRIBUTES:
+        if (quality_level && quality_level->custom_attrs)
+          g_string_append (url, quality_level->custom_attrs);
+        break;
+    }
   }
+}
+
+gboolean
+gst_ssm_parse_get_next_fragment_url (GstSSMParse *parser, SS_STREAM_TYPE stream_type, gchar **uri, guint64 *start_ts, guint *bitrate)
+{
+  GstSSMStreamNode *stream = NULL;
+  GstSSMQualityNode *quality_level = NULL;
+  GstSSMFragmentNode *fragment = NULL;
+
+  stream = (parser->RootNode->streams[stream_type])->data; //get current video stream
+  g_mutex_lock (stream->frag_lock);
+
+  if (GST_SSM_STREAM_FRAGLIST_EOS (stream) && !parser->flushing) {
+    if (parser->RootNode->PresentationIsLive) {
+      /* Live Presentation need to wait for next uri */
+      g_print ("waiting for next URI in LIVE presentation...\n");
+      while (GST_SSM_STREAM_FRAGLIST_EOS (stream) && !parser->flushing)
+        g_cond_wait (stream->frag_cond, stream->frag_lock);
+      if (!parser->flushing)
+        g_print ("Received signal after appending new URI...move to next now\n");
+    } else {
+      /* VOD presentation reached EOS */
+      GST_INFO("Fragment list is empty in VOD case...");
+      g_mutex_unlock (stream->frag_lock);
+      return FALSE;
+    }
+  }
+
+  /* a seek or a stop is waiting for the stream task to return */
+  if (parser->flushing) {
+    GST_INFO ("'%s' stream is flushing, no next fragment", ssm_parse_get_stream_name (stream_type));
+    g_mutex_unlock (stream->frag_lock);
+    return FALSE;
+  }
+
+  /* taken only after the live wait, so quality switches & caps queries of
+   * other streams are not blocked while waiting for the next fragment */
+  MANIFEST_LOCK(parser);
+
+  if (stream->quality_lists)
+    quality_level = (GstSSMQualityNode *)stream->quality_lists->data;
 
-  *uri = g_strjoinv (NULL, (gchar **) strs->pdata);
-  g_strfreev ((gchar **) g_ptr_array_free (strs, FALSE));
+  fragment = GST_SSM_STREAM_FRAGMENT (stream, stream->frag_index);
+
+  ssm_parse_build_fragment_url (parser, stream, quality_level, fragment->time);
+  *uri = g_strndup (stream->url_buf->str, stream->url_buf->len);
+
+  if (bitrate)
+    *bitrate = quality_level ? quality_level->bitrate : 0;
+  *start_ts = fragment->ts;
+
+  stream->frag_index++;
+  if (GST_SSM_STREAM_FRAGLIST_EOS (stream))
+    GST_INFO ("Reached end of fragment list...\n");
 
   g_mutex_unlock (stream->frag_lock);
 
@@ -955,262 +1167,361 @@ gst_ssm_parse_get_next_fragment_url (GstSSMParse *parser, SS_STREAM_TYPE stream_
   return TRUE;
 }
 
+/* wakes up gst_ssm_parse_get_next_fragment_url() waiting at the live edge
+ * & makes it fail until flushing is cleared, so the stream tasks can be
+ * stopped */
+void
+gst_ssm_parse_set_flushing (GstSSMParse *parser, gboolean flushing)
+{
+  gint i = 0;
+
+  g_return_if_fail (parser != NULL);
+
+  parser->flushing = flushing;
+  if (!flushing || !parser->RootNode)
+    return;
+
+  for (i = 0; i < SS_STREAM_NUM; i++) {
+    GList *walk = NULL;
+
+    /* the tracks not selected too, a task may be switching to one */
+    for (walk = parser->RootNode->streams[i]; walk; walk = walk->next) {
+      GstSSMStreamNode *stream = walk->data;
+
+      g_mutex_lock (stream->frag_lock);
+      g_cond_broadcast (stream->frag_cond);
+      g_mutex_unlock (stream->frag_lock);
+    }
+  }
+}
+
+/* tells whether gst_ssm_parse_get_next_fragment_url() can return without
+ * waiting, i.e. fragments are left in the list of the stream */
+gboolean
+gst_ssm_parse_has_next_fragment (GstSSMParse *parser, SS_STREAM_TYPE stream_type)
+{
+  GstSSMStreamNode *stream = NULL;
+  gboolean has_next = FALSE;
+
+  g_return_val_if_fail (parser != NULL, FALSE);
+
+  stream = (parser->RootNode->streams[stream_type])->data;
+
+  g_mutex_lock (stream->frag_lock);
+  has_next = !GST_SSM_STREAM_FRAGLIST_EOS (stream);
+  g_mutex_unlock (stream->frag_lock);
+
+  return has_next;
+}
+
+/* caps of the current quality level of the stream, a new ref to the caps
+ * built at parse time (unref after use, don't modify) */
 GstCaps *
 ssm_parse_get_stream_caps (GstSSMParse *parser, SS_STREAM_TYPE stream_type)
 {
   GstSSMStreamNode *stream = NULL;
-  MANIFEST_LOCK(parser);
+  GstSSMQualityNode *cur_quality_node = NULL;
+  GstCaps *caps = NULL;
 
+  MANIFEST_LOCK(parser);
   stream = parser->RootNode->streams[stream_type]->data;
-  GstCaps *caps = NULL;
-  if (stream_type == SS_STREAM_VIDEO) {
-    caps =  ssm_prepare_video_caps (parser, stream);
-  } else if (stream_type == SS_STREAM_AUDIO) {
-    caps =  ssm_prepare_audio_caps (parser, stream);
-  } else if (stream_type == SS_STREAM_TEXT) {
-    caps =  ssm_prepare_text_caps (parser, stream);
-  }
+  if (stream->quality_lists)
+    cur_quality_node = (GstSSMQualityNode *)(stream->quality_lists->data);
+  if (cur_quality_node && cur_quality_node->caps)
+    caps = gst_caps_ref (cur_quality_node->caps);
   MANIFEST_UNLOCK(parser);
+
   return caps;
 }
 
-GstCaps *
-ssm_prepare_video_caps (GstSSMParse *parser, GstSSMStreamNode *stream)
+/* number of times caps were built from the quality level attributes */
+guint
+gst_ssm_parse_get_caps_conversions (GstSSMParse *parser)
+{
+  g_return_val_if_fail (parser != NULL, 0);
+
+  return parser->n_caps_conversions;
+}
+
+/* caps are built once per quality level, fragments only take a ref */
+static void
+ssm_parse_build_quality_caps (GstSSMParse *parser, GstSSMStreamNode *stream, GstSSMQualityNode *quality)
 {
-  GstSSMQualityNode *cur_quality_node =  (GstSSMQualityNode *)(stream->quality_lists->data);
+  if (SS_STREAM_VIDEO == stream->type)
+    quality->caps = ssm_prepare_video_caps (parser, quality);
+  else if (SS_STREAM_AUDIO == stream->type)
+    quality->caps = ssm_prepare_audio_caps (parser, quality);
+  else if (SS_STREAM_TEXT == stream->type)
+    quality->caps = ssm_prepare_text_caps (parser, quality);
+  if (!quality->caps)
+    GST_WARNING ("no caps for %s quality level %u", ssm_parse_get_stream_name (stream->type), quality->index);
+}
+
+/* hex string of CodecPrivateData to binary */
+static GstBuffer *
+ssm_parse_hex_codec_data (const gchar *hex)
+{
+  guint len = strlen (hex) >> 1;
   GstBuffer *codec_data = NULL;
-  GstCaps *caps = NULL;
+  guint idx = 0;
 
-  codec_data = gst_buffer_new ();
+  codec_data = gst_buffer_new_and_alloc (len);
   if (!codec_data) {
-    GST_ERROR ("failed to allocate buffer");
+    GST_ERROR ("Failed to allocate memory..\n");
     return NULL;
   }
 
-  if (!strncmp ((char *)cur_quality_node->fourcc, "H264", 4)) {
-    /* converting NALU codec data to 3GPP codec data format */
-    if (!convert_NALUnitDCI_to_PacktizedDCI (cur_quality_node->codec_data, &(GST_BUFFER_DATA(codec_data)), &GST_BUFFER_SIZE(codec_data))) {
-      GST_ERROR ("Error in converting NALUDCI to Packetized DCI...\n");
+  for (idx = 0; idx < len; idx++) {
+    gchar tmp[3] = { hex[2 * idx], hex[2 * idx + 1], '\0' };
+    gint val = 0;
+
+    if (!int_from_string (tmp, NULL, &val, 16)) {
+      GST_ERROR ("Failed to int from string...");
+      gst_buffer_unref (codec_data);
       return NULL;
     }
-    GST_BUFFER_MALLOCDATA(codec_data) = GST_BUFFER_DATA(codec_data);
-  } else if (!strncmp ((char *)cur_quality_node->fourcc, "WVC1", 4)) {
-    unsigned char *codec_data = cur_quality_node->codec_data;
-    unsigned int DCI_len = strlen ((char *)cur_quality_node->codec_data);
-    gchar tmp[3] = {0, };
-    gint val = 0;
-    gint codec_data_len = 0;
-    gint idx = 0;
+    (GST_BUFFER_DATA(codec_data))[idx] = val;
+  }
 
-    codec_data_len = (DCI_len >>1);
+  return codec_data;
+}
 
-    codec_data = gst_buffer_new_and_alloc (codec_data_len);
+static GstCaps *
+ssm_prepare_video_caps (GstSSMParse *parser, GstSSMQualityNode *quality)
+{
+  GstBuffer *codec_data = NULL;
+  GstCaps *caps = NULL;
+
+  parser->n_caps_conversions++;
+
+  if (!strncmp ((char *)quality->fourcc, "H264", 4)) {
+    codec_data = gst_buffer_new ();
     if (!codec_data) {
-      GST_ERROR ("Failed to allocate memory..\n");
-      return FALSE;
+      GST_ERROR ("failed to allocate buffer");
+      return NULL;
     }
 
-    /* copy codec data */
-    while (DCI_len) {
-      memset (tmp, 0x00, 3);
-      strncpy ((char*)tmp, (char*)codec_data, 2);
-      tmp[2] = '\0';
-      if (!int_from_string ((char*)tmp, NULL, &val, 16)) {
-        GST_ERROR ("Failed to int from string...");
-        return NULL;
-      }
-      (GST_BUFFER_DATA(codec_data))[idx] = val;
-      codec_data += 2;
-      DCI_len = DCI_len - 2;
-      idx++;
+    /* converting NALU codec data to 3GPP codec data format */
+    if (!convert_NALUnitDCI_to_PacktizedDCI ((unsigned char *)quality->codec_data, &(GST_BUFFER_DATA(codec_data)), &GST_BUFFER_SIZE(codec_data))) {
+      GST_ERROR ("Error in converting NALUDCI to Packetized DCI...\n");
+      gst_buffer_unref (codec_data);
+      return NULL;
     }
-  }
+    GST_BUFFER_MALLOCDATA(codec_data) = GST_BUFFER_DATA(codec_data);
 
-  if (!strncmp ((char *)cur_quality_node->fourcc, "H264", 4)) {
     /* prepare H264 caps */
     caps = gst_caps_new_simple ("video/x-h264",
-                  "width", G_TYPE_INT, cur_quality_node->max_width,
-                  "height", G_TYPE_INT, cur_quality_node->max_height,
+                  "width", G_TYPE_INT, quality->max_width,
+                  "height", G_TYPE_INT, quality->max_height,
                   "framerate", GST_TYPE_FRACTION, 30, 1,
                   "stream-format", G_TYPE_STRING, "avc",
                   "alignment", G_TYPE_STRING, "au",
                   "codec_data", GST_TYPE_BUFFER, codec_data,
                   NULL);
-  } else if (!strncmp ((char *)cur_quality_node->fourcc, "WVC1", 4)) {
+  } else if (!strncmp ((char *)quality->fourcc, "WVC1", 4)) {
+    codec_data = ssm_parse_hex_codec_data (quality->codec_data);
+    if (!codec_data)
+      return NULL;
+
     /* prepare VC1 caps */
     caps = gst_caps_new_simple ("video/x-wmv",
-                  "width", G_TYPE_INT, cur_quality_node->max_width,
-                    "height", G_TYPE_INT, cur_quality_node->max_height,
-                    "framerate", GST_TYPE_FRACTION, 30, 1,
-                    "wmvversion", G_TYPE_INT, 3,
-                    "format", GST_TYPE_FOURCC, GST_MAKE_FOURCC ('W', 'V', 'C', '1'),
-                    "codec_data", GST_TYPE_BUFFER, codec_data,
-                    NULL);
+                  "width", G_TYPE_INT, quality->max_width,
+                  "height", G_TYPE_INT, quality->max_height,
+                  "framerate", GST_TYPE_FRACTION, 30, 1,
+                  "wmvversion", G_TYPE_INT, 3,
+                  "format", GST_TYPE_FOURCC, GST_MAKE_FOURCC ('W', 'V', 'C', '1'),
+                  "codec_data", GST_TYPE_BUFFER, codec_data,
+                  NULL);
   } else {
-    char *s;
     /* prepare gst generic caps caps */
     GST_ERROR ("Wrong VIDEO fourcc...");
-    s = g_strdup_printf ("video/x-gst-fourcc-%s", "unknown");
-    caps = gst_caps_new_simple (s,
-                     "width", G_TYPE_INT, cur_quality_node->max_width,
-                     "height", G_TYPE_INT, cur_quality_node->max_height,
-                     "framerate", GST_TYPE_FRACTION, 30, 1,
-                      "codec_data", GST_TYPE_BUFFER, codec_data,
-                     NULL);
+    caps = gst_caps_new_simple ("video/x-gst-fourcc-unknown",
+                  "width", G_TYPE_INT, quality->max_width,
+                  "height", G_TYPE_INT, quality->max_height,
+                  "framerate", GST_TYPE_FRACTION, 30, 1,
+                  NULL);
   }
 
-  GST_INFO ( "prepared video caps : %s\n", gst_caps_to_string(caps));
+  if (codec_data)
+    gst_buffer_unref (codec_data);
 
-   return caps;
+  GST_INFO ("prepared video caps : %" GST_PTR_FORMAT, caps);
+
+  return caps;
 }
 
-GstCaps *
-ssm_prepare_audio_caps (GstSSMParse *parser, GstSSMStreamNode *stream)
+static GstCaps *
+ssm_prepare_audio_caps (GstSSMParse *parser, GstSSMQualityNode *quality)
 {
-  GstSSMQualityNode *cur_quality_node =  (GstSSMQualityNode *)(stream->quality_lists->data);
   GstBuffer *codec_data = NULL;
   GstCaps *caps = NULL;
 
-  if ((!strncmp ((char *)cur_quality_node->fourcc, "AACL", 4)) || !strncmp ((char *)cur_quality_node->fourcc, "WMAP", 4)) {
-    guint DCI_len = strlen ((char *)cur_quality_node->codec_data);
-    gchar tmp[3] = {0, };
-    gint val = 0;
-    gint codec_data_len = (DCI_len >>1);
-    gint idx = 0;
+  parser->n_caps_conversions++;
 
-    codec_data = gst_buffer_new_and_alloc (codec_data_len);
-    if (NULL == codec_data) {
-      GST_ERROR ("Failed to allocate memory..\n");
+  if ((!strncmp ((char *)quality->fourcc, "AACL", 4)) || !strncmp ((char *)quality->fourcc, "WMAP", 4)) {
+    codec_data = ssm_parse_hex_codec_data (quality->codec_data);
+    if (!codec_data)
       return NULL;
-    }
-
-    /* copy codec data */
-    while (DCI_len) {
-      memset (tmp, 0x00, 3);
-      strncpy ((char*)tmp, (char*)cur_quality_node->codec_data, 2);
-      tmp[2] = '\0';
-      if (!int_from_string ((char*)tmp, NULL, &val , 16)) {
-        GST_ERROR ("Failed to int from string...");
-        return NULL;
-      }
-      (GST_BUFFER_DATA(codec_data))[idx] = val;
-      cur_quality_node->codec_data += 2;
-      DCI_len = DCI_len - 2;
-      //g_print ("val = 0x%02x, codec_data_length = %d, idx = %d\n", val, DCI_len, idx);
-      idx++;
-    }
   } else {
     GST_ERROR ("\n\n\nUnsupported Audio Codec Fourcc...\n\n\n");
     return NULL;
   }
 
-  if (!strncmp ((char *)cur_quality_node->fourcc, "AACL", 4)) {
+  if (!strncmp ((char *)quality->fourcc, "AACL", 4)) {
     caps = gst_caps_new_simple ("audio/mpeg",
                           "mpegversion", G_TYPE_INT, 4,
                           "framed", G_TYPE_BOOLEAN, TRUE,
                           "stream-format", G_TYPE_STRING, "raw",
-                          "rate", G_TYPE_INT, (int) cur_quality_node->samplingrate,
-                          "channels", G_TYPE_INT, cur_quality_node->channels,
+                          "rate", G_TYPE_INT, (int) quality->samplingrate,
+                          "channels", G_TYPE_INT, quality->channels,
+                          "codec_data", GST_TYPE_BUFFER, codec_data,
                           NULL);
-  } else if (!strncmp ((char *)cur_quality_node->fourcc, "WMAP", 4)) {
-    caps = gst_caps_new_simple ("audio/x-wma",
-                        "rate", G_TYPE_INT, (int) cur_quality_node->samplingrate,
-                         "channels", G_TYPE_INT, cur_quality_node->channels,
-                        NULL);
   } else {
-    char *s;
-
-    GST_ERROR ("Wrong Audio fourcc...");
-    s = g_strdup_printf ("audio/x-gst-fourcc-%s", "unknown");
-    caps = gst_caps_new_simple (s,
-                            "rate", G_TYPE_INT, (int) cur_quality_node->samplingrate,
-                             "channels", G_TYPE_INT, cur_quality_node->channels,
-                             NULL);
+    caps = gst_caps_new_simple ("audio/x-wma",
+                          "rate", G_TYPE_INT, (int) quality->samplingrate,
+                          "channels", G_TYPE_INT, quality->channels,
+                          "codec_data", GST_TYPE_BUFFER, codec_data,
+                          NULL);
   }
-  GST_INFO ( "prepared video caps : %s\n", gst_caps_to_string(caps));
+
+  gst_buffer_unref (codec_data);
+
+  GST_INFO ("prepared audio caps : %" GST_PTR_FORMAT, caps);
 
   return caps;
 }
 
-GstCaps *
-ssm_prepare_text_caps (GstSSMParse *parser, GstSSMStreamNode *stream)
+static GstCaps *
+ssm_prepare_text_caps (GstSSMParse *parser, GstSSMQualityNode *quality)
 {
-  // TODO: Yet to add support for text caps
+  parser->n_caps_conversions++;
+
+  /* fragments carry a TTML document in their mdat */
+  if (quality->fourcc &&
+      (!strncmp ((char *)quality->fourcc, "TTML", 4) ||
+       !strncmp ((char *)quality->fourcc, "DFXP", 4)))
+    return gst_caps_new_simple ("application/ttml+xml", NULL);
+
+  // TODO: Yet to add support for other text formats
+  GST_WARNING ("unsupported text fourcc %s", GST_STR_NULL (quality->fourcc));
   return NULL;
 }
 
-SS_BW_MODE
-gst_ssm_parse_switch_qualitylevel (GstSSMParse *parser, guint drate)
+/* returns the ascending bitrates of the stream quality levels (free with
+ * g_free) and the index of the level urls are currently built for */
+guint *
+gst_ssm_parse_get_bitrates (GstSSMParse *parser, SS_STREAM_TYPE stream_type, guint *n_bitrates, gint *cur_index)
 {
-  GstSSMStreamNode *stream =  parser->RootNode->streams[SS_STREAM_VIDEO]->data;
-  guint bitrate = ((GstSSMQualityNode *)stream->quality_lists->data)->bitrate;
-  SS_BW_MODE ret = SS_MODE_NO_SWITCH;
+  GstSSMStreamNode *stream = NULL;
+  GList *walk = NULL;
+  guint *bitrates = NULL;
+  guint i = 0;
 
-  /* check for upward transition */
-  while (drate > (bitrate + BITRATE_SWITCH_UPPER_THRESHOLD * bitrate)) {
-    if (g_list_next (stream->quality_lists)) {
-      stream->quality_lists = g_list_next (stream->quality_lists);
-      g_print ("Move to next quality level : drate = %d and bitrate = %d\n", drate, ((GstSSMQualityNode *)stream->quality_lists->data)->bitrate);
-      ret = SS_MODE_AV;
-    } else {
-      g_print ("Already at MAX Bitrate possible...\n");
-      ret = SS_MODE_NO_SWITCH;
-      break;
-    }
+  g_return_val_if_fail (parser != NULL, NULL);
+  g_return_val_if_fail (parser->RootNode->streams[stream_type], NULL);
+
+  MANIFEST_LOCK(parser);
+  stream = parser->RootNode->streams[stream_type]->data;
+
+  walk = g_list_first (stream->quality_lists);
+  bitrates = g_new0 (guint, g_list_length (walk));
+  for (i = 0; walk; walk = g_list_next (walk), i++) {
+    bitrates[i] = ((GstSSMQualityNode *)walk->data)->bitrate;
+    if (walk == stream->quality_lists && cur_index)
+      *cur_index = i;
   }
+  if (n_bitrates)
+    *n_bitrates = i;
+  MANIFEST_UNLOCK(parser);
 
-  /* check for downward transition */
-  while (drate < (bitrate + BITRATE_SWITCH_LOWER_THRESHOLD * bitrate)) {
-    if (g_list_previous (stream->quality_lists)) {
-      stream->quality_lists = g_list_previous (stream->quality_lists);
-      g_print ("Move to previous quality level : drate = %d and bitrate = %d\n", drate, ((GstSSMQualityNode *)stream->quality_lists->data)->bitrate);
-    } else {
-      g_print ("Reached MIN video bitrate possible...\n");
-      if (GST_SSM_PARSE_IS_LIVE_PRESENTATION(parser)) {
-        g_print ("Going to audio-only because of LIVE...\n");
-        ret = SS_MODE_AONLY;
-      } else {
-        ret = SS_MODE_AV;
-      }
+  return bitrates;
+}
+
+/* moves the stream to the quality level at @index of the ascending list */
+gboolean
+gst_ssm_parse_set_qualitylevel (GstSSMParse *parser, SS_STREAM_TYPE stream_type, guint index)
+{
+  GstSSMStreamNode *stream = NULL;
+  GList *level = NULL;
+
+  g_return_val_if_fail (parser != NULL, FALSE);
+  g_return_val_if_fail (parser->RootNode->streams[stream_type], FALSE);
+
+  MANIFEST_LOCK(parser);
+  stream = parser->RootNode->streams[stream_type]->data;
+  level = g_list_nth (g_list_first (stream->quality_lists), index);
+  if (level) {
+    stream->quality_lists = level;
+    g_print ("Move to quality level %u : bitrate = %d\n", index, ((GstSSMQualityNode *)level->data)->bitrate);
+  }
+  MANIFEST_UNLOCK(parser);
+
+  return level != NULL;
+}
+
+/* drops the fragments which fell out of the DVR window, so the timeline of a
+ * 24/7 live presentation stays bounded. Must be called with frag_lock held.
+ * Fragments not downloaded yet are dropped too when the download fell behind
+ * the window, the server does not serve them anymore */
+static void
+ssm_parse_trim_dvr_window (GstSSMParse *parser, GstSSMStreamNode *stream)
+{
+  GstSSMFragmentNode *last_fragment = NULL;
+  guint64 window_start = 0;
+  guint n_drop = 0;
+
+  if (!parser->RootNode->PresentationIsLive || !parser->RootNode->DVRWindowLength ||
+      !stream->fragments->len)
+    return;
+
+  last_fragment = GST_SSM_STREAM_FRAGMENT (stream, stream->fragments->len - 1);
+  if (last_fragment->time + last_fragment->dur <= parser->RootNode->DVRWindowLength)
+    return;
+
+  window_start = last_fragment->time + last_fragment->dur - parser->RootNode->DVRWindowLength;
+
+  /* the last fragment is always kept */
+  while (n_drop < stream->fragments->len - 1) {
+    GstSSMFragmentNode *fragment = GST_SSM_STREAM_FRAGMENT (stream, n_drop);
+
+    if (fragment->time + fragment->dur > window_start)
       break;
-    }
+    stream->stream_duration -= fragment->dur;
+    n_drop++;
   }
 
-  return ret;
+  if (!n_drop)
+    return;
+
+  g_array_remove_range (stream->fragments, 0, n_drop);
+  stream->frag_index = (stream->frag_index > n_drop) ? stream->frag_index - n_drop : 0;
+
+  GST_LOG ("dropped %u '%s' fragments out of DVR window, %u left", n_drop,
+      ssm_parse_get_stream_name (stream->type), stream->fragments->len);
 }
 
 gboolean
 gst_ssm_parse_append_next_fragment (GstSSMParse *parser, SS_STREAM_TYPE stream_type, guint64 timestamp, guint64 duration)
 {
   GstSSMStreamNode *stream = NULL;
-  GstSSMFragmentNode *new_fragment = NULL;
+  GstSSMFragmentNode new_fragment = { 0, };
   GstSSMFragmentNode *last_fragment = NULL;
-  GList *last_node = NULL;
 
   g_return_val_if_fail (parser != NULL, FALSE);
 
   /*get current stream based on stream_type */
   stream = (parser->RootNode->streams[stream_type])->data;
 
-  g_return_val_if_fail (stream->fragment_lists, FALSE);
+  g_return_val_if_fail (stream->fragments->len, FALSE);
 
   g_mutex_lock (stream->frag_lock);
 
-  last_node = g_list_last(stream->fragment_lists);
-
-  last_fragment = (GstSSMFragmentNode *)(last_node->data);
+  last_fragment = GST_SSM_STREAM_FRAGMENT (stream, stream->fragments->len - 1);
 
   if (last_fragment->time < timestamp) {
 
     GST_LOG ("+++++ last_fragment time = %llu and current recd = %llu +++++\n", last_fragment->time, timestamp);
 
-    /* allocate new fragment node */
-    new_fragment = g_slice_new0 (GstSSMFragmentNode);
-    if (new_fragment == NULL) {
-      GST_ERROR ("Allocation of fragment failed!");
-      return FALSE;
-    }
-
     if (duration == GST_CLOCK_TIME_NONE) {
       /* useful when lookahead count is zero */
       // TODO: need to check how to handle, when there is discontinuity
@@ -1218,26 +1529,21 @@ gst_ssm_parse_append_next_fragment (GstSSMParse *parser, SS_STREAM_TYPE stream_t
     }
 
     // TODO: need to handle when either time or duration present OR if both are non proper values
-    new_fragment->dur = duration;
-    new_fragment->time = timestamp;
-    new_fragment->num = 0;
+    new_fragment.dur = duration;
+    new_fragment.time = timestamp;
+    new_fragment.num = 0;
+    new_fragment.ts = gst_util_uint64_scale (timestamp, GST_SECOND, parser->RootNode->TimeScale);
 
     /* add the new fragment duration to total stream duration */
     stream->stream_duration += duration;
 
-    /* append new fragment list to stream fragment list */
-   ((GstSSMStreamNode *)(parser->RootNode->streams[stream_type]->data))->fragment_lists =
-	 g_list_append (((GstSSMStreamNode *)(parser->RootNode->streams[stream_type]->data))->fragment_lists, new_fragment);
+    /* append new fragment to stream timeline, amortized O(1) */
+    g_array_append_val (stream->fragments, new_fragment);
+    ssm_parse_trim_dvr_window (parser, stream);
 
     GST_DEBUG ("+++++ Appened new '%s' URL and signaling the condition and duration = %llu ++++++\n",
         ssm_parse_get_stream_name(stream_type), stream->stream_duration);
 
-    if (stream->fraglist_eos) {
-      GST_INFO ("Need to move the list now to next.. as we received new one\n");
-      ((GstSSMStreamNode *)(parser->RootNode->streams[stream_type]->data))->fragment_lists =
-	 g_list_next (((GstSSMStreamNode *)(parser->RootNode->streams[stream_type]->data))->fragment_lists);
-      stream->fraglist_eos = FALSE;
-    }
     /* signal fragment wait */
     g_cond_signal (stream->frag_cond);
 
@@ -1250,12 +1556,296 @@ gst_ssm_parse_append_next_fragment (GstSSMParse *parser, SS_STREAM_TYPE stream_t
   return TRUE;
 }
 
+/* appends the fragments of @fresh_stream newer than the last known one of
+ * @stream, returns the number of appended fragments */
+static guint
+ssm_parse_merge_stream (GstSSMParse *parser, GstSSMStreamNode *stream, GstSSMStreamNode *fresh_stream)
+{
+  guint j = 0;
+  guint n = 0;
+
+  g_mutex_lock (stream->frag_lock);
+
+  /* both timelines are sorted, so skip straight past the known part */
+  if (stream->fragments->len) {
+    GstSSMFragmentNode *last_fragment = GST_SSM_STREAM_FRAGMENT (stream, stream->fragments->len - 1);
+
+    j = fresh_stream->fragments->len;
+    while (j > 0 && GST_SSM_STREAM_FRAGMENT (fresh_stream, j - 1)->time > last_fragment->time)
+      j--;
+  }
+
+  for (; j < fresh_stream->fragments->len; j++) {
+    GstSSMFragmentNode fragment = *GST_SSM_STREAM_FRAGMENT (fresh_stream, j);
+
+    fragment.ts = gst_util_uint64_scale (fragment.time, GST_SECOND, parser->RootNode->TimeScale);
+    stream->stream_duration += fragment.dur;
+    g_array_append_val (stream->fragments, fragment);
+    n++;
+  }
+
+  if (n) {
+    ssm_parse_trim_dvr_window (parser, stream);
+    GST_DEBUG ("merged %u new '%s' fragments of stream %u from refreshed manifest", n,
+        ssm_parse_get_stream_name (stream->type), stream->index);
+    /* signal fragment wait */
+    g_cond_signal (stream->frag_cond);
+  }
+
+  g_mutex_unlock (stream->frag_lock);
+
+  return n;
+}
+
+/* merges a refreshed live manifest, parsed into @fresh, into the timeline of
+ * @parser. Only fragments newer than the last known one of each stream are
+ * appended, everything else of @parser is left untouched. Streams not
+ * selected are kept up to date too, so they can be switched to at any time.
+ * Returns the number of appended fragments */
+guint
+gst_ssm_parse_merge_manifest (GstSSMParse *parser, GstSSMParse *fresh)
+{
+  guint n_appended = 0;
+  gint i = 0;
+
+  g_return_val_if_fail (parser != NULL, 0);
+  g_return_val_if_fail (fresh != NULL && GST_SSM_PARSE_IS_COMPLETE (fresh), 0);
+
+  MANIFEST_LOCK (parser);
+  parser->RootNode->DVRWindowLength = fresh->RootNode->DVRWindowLength;
+  MANIFEST_UNLOCK (parser);
+
+  for (i = 0; i < SS_STREAM_NUM; i++) {
+    GList *streams = NULL;
+    GList *walk = NULL;
+
+    if (!parser->RootNode->streams[i] || !fresh->RootNode->streams[i])
+      continue;
+
+    /* the list is reordered by stream selection, frag_lock can't be taken
+     * under the manifest lock */
+    MANIFEST_LOCK (parser);
+    streams = g_list_copy (parser->RootNode->streams[i]);
+    MANIFEST_UNLOCK (parser);
+
+    for (walk = streams; walk; walk = g_list_next (walk)) {
+      GstSSMStreamNode *stream = walk->data;
+      GstSSMStreamNode *fresh_stream = NULL;
+      GList *link = NULL;
+
+      /* fresh streams are never selected, they are in manifest order */
+      link = g_list_nth (fresh->RootNode->streams[i], stream->index);
+      if (!link) {
+        GST_WARNING ("'%s' stream %u missing in refreshed manifest",
+            ssm_parse_get_stream_name (i), stream->index);
+        continue;
+      }
+      fresh_stream = link->data;
+
+      n_appended += ssm_parse_merge_stream (parser, stream, fresh_stream);
+    }
+
+    g_list_free (streams);
+  }
+
+  return n_appended;
+}
+
+/* seekable range of a live presentation, in nanoseconds: from the oldest to
+ * the newest fragment start which all streams still have */
+gboolean
+gst_ssm_parse_get_dvr_window (GstSSMParse *parser, GstClockTime *start, GstClockTime *stop)
+{
+  gint i = 0;
+
+  g_return_val_if_fail (parser != NULL, FALSE);
+
+  *start = 0;
+  *stop = GST_CLOCK_TIME_NONE;
+
+  for (i = 0; i < SS_STREAM_NUM; i++) {
+    GstSSMStreamNode *stream = NULL;
+
+    if (!parser->RootNode->streams[i])
+      continue;
+
+    stream = parser->RootNode->streams[i]->data;
+
+    g_mutex_lock (stream->frag_lock);
+    if (stream->fragments->len) {
+      *start = MAX (*start, GST_SSM_STREAM_FRAGMENT (stream, 0)->ts);
+      *stop = MIN (*stop, GST_SSM_STREAM_FRAGMENT (stream, stream->fragments->len - 1)->ts);
+    }
+    g_mutex_unlock (stream->frag_lock);
+  }
+
+  return GST_CLOCK_TIME_IS_VALID (*stop) && *start <= *stop;
+}
+
+/* a live manifest grows by about one fragment per fragment duration */
+GstClockTime
+gst_ssm_parse_get_refresh_interval (GstSSMParse *parser)
+{
+  GstClockTime interval = GST_CLOCK_TIME_NONE;
+  gint i = 0;
+
+  g_return_val_if_fail (parser != NULL, GST_CLOCK_TIME_NONE);
+
+  for (i = 0; i < SS_STREAM_NUM; i++) {
+    GstSSMStreamNode *stream = NULL;
+
+    if (!parser->RootNode->streams[i])
+      continue;
+
+    stream = parser->RootNode->streams[i]->data;
+
+    g_mutex_lock (stream->frag_lock);
+    if (stream->fragments->len) {
+      GstSSMFragmentNode *last_fragment = GST_SSM_STREAM_FRAGMENT (stream, stream->fragments->len - 1);
+
+      interval = MIN (interval, gst_util_uint64_scale (last_fragment->dur, GST_SECOND, parser->RootNode->TimeScale));
+    }
+    g_mutex_unlock (stream->frag_lock);
+  }
+
+  return interval;
+}
+
+/* index of the fragment containing @seek_time (nanoseconds), i.e. the last
+ * one starting at or before it */
+static guint
+ssm_parse_find_fragment (GstSSMStreamNode *stream, guint64 seek_time)
+{
+  guint low = 0;
+  guint high = stream->fragments->len;
+
+  while (high - low > 1) {
+    guint mid = low + (high - low) / 2;
+
+    if (GST_SSM_STREAM_FRAGMENT (stream, mid)->ts <= seek_time)
+      low = mid;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+/* duration of the fragment of @stream_type starting at @start_ts (ns) */
+GstClockTime
+gst_ssm_parse_get_fragment_duration (GstSSMParse *parser, SS_STREAM_TYPE stream_type, guint64 start_ts)
+{
+  GstSSMStreamNode *stream = NULL;
+  GstSSMFragmentNode *fragment = NULL;
+  GstClockTime duration = GST_CLOCK_TIME_NONE;
+
+  g_return_val_if_fail (parser != NULL, GST_CLOCK_TIME_NONE);
+
+  if (!parser->RootNode->streams[stream_type])
+    return GST_CLOCK_TIME_NONE;
+
+  stream = parser->RootNode->streams[stream_type]->data;
+
+  g_mutex_lock (stream->frag_lock);
+  if (stream->fragments->len) {
+    fragment = GST_SSM_STREAM_FRAGMENT (stream, ssm_parse_find_fragment (stream, start_ts));
+    if (fragment->ts == start_ts && fragment->dur != -1)
+      duration = gst_util_uint64_scale (fragment->dur, GST_SECOND, parser->RootNode->TimeScale);
+  }
+  g_mutex_unlock (stream->frag_lock);
+
+  return duration;
+}
+
+/* moves the next fragment of @stream_type forward to the one containing @ts
+ * (ns), never backwards. Returns TRUE when fragments were skipped */
+gboolean
+gst_ssm_parse_skip_fragments (GstSSMParse *parser, SS_STREAM_TYPE stream_type, guint64 ts)
+{
+  GstSSMStreamNode *stream = NULL;
+  gboolean skipped = FALSE;
+  guint index = 0;
+
+  g_return_val_if_fail (parser != NULL, FALSE);
+
+  if (!parser->RootNode->streams[stream_type])
+    return FALSE;
+
+  stream = parser->RootNode->streams[stream_type]->data;
+
+  g_mutex_lock (stream->frag_lock);
+  if (stream->fragments->len) {
+    index = ssm_parse_find_fragment (stream, ts);
+    if (index > stream->frag_index) {
+      stream->frag_index = index;
+      skipped = TRUE;
+    }
+  }
+  g_mutex_unlock (stream->frag_lock);
+
+  return skipped;
+}
+
+/* number of StreamIndex of @stream_type in the manifest, e.g. audio languages */
+guint
+gst_ssm_parse_get_n_streams (GstSSMParse *parser, SS_STREAM_TYPE stream_type)
+{
+  guint n_streams = 0;
+
+  g_return_val_if_fail (parser != NULL, 0);
+
+  MANIFEST_LOCK(parser);
+  n_streams = g_list_length (parser->RootNode->streams[stream_type]);
+  MANIFEST_UNLOCK(parser);
+
+  return n_streams;
+}
+
+/* makes the StreamIndex at @index (in manifest order) the current stream of
+ * @stream_type, its next fragment being the one containing @ts (ns). The
+ * other streams of the type keep their timeline, so switching back is cheap */
+gboolean
+gst_ssm_parse_select_stream (GstSSMParse *parser, SS_STREAM_TYPE stream_type, guint index, guint64 ts)
+{
+  GstSSMStreamNode *stream = NULL;
+  GList *walk = NULL;
+
+  g_return_val_if_fail (parser != NULL, FALSE);
+
+  MANIFEST_LOCK(parser);
+  for (walk = parser->RootNode->streams[stream_type]; walk; walk = g_list_next (walk)) {
+    if (((GstSSMStreamNode *) walk->data)->index == index)
+      break;
+  }
+  if (!walk) {
+    MANIFEST_UNLOCK(parser);
+    GST_WARNING ("no '%s' stream %u in manifest", ssm_parse_get_stream_name (stream_type), index);
+    return FALSE;
+  }
+
+  /* the head of the list is the current stream */
+  parser->RootNode->streams[stream_type] = g_list_remove_link (parser->RootNode->streams[stream_type], walk);
+  parser->RootNode->streams[stream_type] = g_list_concat (walk, parser->RootNode->streams[stream_type]);
+  stream = walk->data;
+  MANIFEST_UNLOCK(parser);
+
+  g_mutex_lock (stream->frag_lock);
+  if (stream->fragments->len)
+    stream->frag_index = ssm_parse_find_fragment (stream, ts);
+  g_mutex_unlock (stream->frag_lock);
+
+  GST_INFO ("selected '%s' stream %u (%s), next fragment %u at %"GST_TIME_FORMAT,
+      ssm_parse_get_stream_name (stream_type), index, GST_STR_NULL (stream->StreamName),
+      stream->frag_index, GST_TIME_ARGS (ts));
+
+  return TRUE;
+}
+
 gboolean
 gst_ssm_parse_seek_manifest (GstSSMParse *parser, guint64 seek_time)
 {
   gint i = 0;
   GstSSMStreamNode *stream = NULL;
-  guint64 stream_time = -1;
   guint64 start_ts = -1;
 
   parser->ns_start = 0;
@@ -1263,37 +1853,15 @@ gst_ssm_parse_seek_manifest (GstSSMParse *parser, guint64 seek_time)
   for (i = 0; i < SS_STREAM_NUM; i++) {
     if (parser->RootNode->streams[i]) {
       stream = parser->RootNode->streams[i]->data; // get current stream
-      stream_time = ((GstSSMFragmentNode *)stream->fragment_lists->data)->time;
-      stream_time = gst_util_uint64_scale (stream_time, GST_SECOND,
-          GST_SSM_PARSE_GET_TIMESCALE(parser));
-
-      if (seek_time > stream_time) {
-        /* forward seek */
-        while (seek_time > stream_time) {
-          stream->fragment_lists = g_list_next (stream->fragment_lists);
-          stream_time = gst_util_uint64_scale (((GstSSMFragmentNode *)stream->fragment_lists->data)->time, GST_SECOND,
-              GST_SSM_PARSE_GET_TIMESCALE(parser));
-          GST_LOG ("seek time = %"GST_TIME_FORMAT", cur_time = %"GST_TIME_FORMAT,
-              GST_TIME_ARGS(seek_time), GST_TIME_ARGS(stream_time));
-        }
-
-        /* moving to fragment before our seeked time */
-        stream->fragment_lists = g_list_previous (stream->fragment_lists);
-        start_ts = ((GstSSMFragmentNode *)stream->fragment_lists->data)->time;
-      } else if (seek_time < stream_time) {
-        /* backward seek */
-        while (seek_time < stream_time) {
-          stream->fragment_lists = g_list_previous (stream->fragment_lists);
-          stream_time = gst_util_uint64_scale (((GstSSMFragmentNode *)stream->fragment_lists->data)->time, GST_SECOND,
-                                              GST_SSM_PARSE_GET_TIMESCALE(parser));
-          GST_LOG ("seek time = %"GST_TIME_FORMAT", cur_time = %"GST_TIME_FORMAT,
-          GST_TIME_ARGS(seek_time), GST_TIME_ARGS(stream_time));
-        }
-        start_ts = ((GstSSMFragmentNode *)stream->fragment_lists->data)->time;
-      } else {
-        /* rare case */
-        start_ts = ((GstSSMFragmentNode *)stream->fragment_lists->data)->time;
-      }
+
+      g_mutex_lock (stream->frag_lock);
+      stream->frag_index = ssm_parse_find_fragment (stream, seek_time);
+      start_ts = GST_SSM_STREAM_FRAGMENT (stream, stream->frag_index)->time;
+      g_mutex_unlock (stream->frag_lock);
+
+      GST_LOG ("seek time = %"GST_TIME_FORMAT", '%s' fragment %u starts at %"GST_TIME_FORMAT,
+          GST_TIME_ARGS(seek_time), ssm_parse_get_stream_name(i), stream->frag_index,
+          GST_TIME_ARGS(GST_SSM_STREAM_FRAGMENT (stream, stream->frag_index)->ts));
 
       if (stream->type == SS_STREAM_VIDEO) {
         /* move to least possible bitrate variant*/
@@ -1313,6 +1881,410 @@ gst_ssm_parse_seek_manifest (GstSSMParse *parser, guint64 seek_time)
   return TRUE;
 }
 
+/* binary snapshot of a parsed VOD manifest, so a warm restart of the same
+ * presentation skips the XML parse. It is a local cache, written in host byte
+ * order: header, root node, protection header, then each stream with its
+ * quality levels & fragments. Every field is written on its own, no struct
+ * goes to the file as is. Strings are length prefixed, SSM_SNAPSHOT_NULL
+ * being a NULL string */
+#define SSM_SNAPSHOT_MAGIC "SSMS"
+#define SSM_SNAPSHOT_VERSION 2
+#define SSM_SNAPSHOT_NULL G_MAXUINT32
+/* num, dur, time, media_type & ts of a fragment */
+#define SSM_SNAPSHOT_FRAGMENT_SIZE (4 + 8 + 8 + 4 + 8)
+
+typedef struct
+{
+  const guint8 *data;
+  gsize size;
+  gsize pos;
+  gboolean error;
+} GstSSMSnapshotReader;
+
+static void
+ssm_snapshot_put_u32 (GByteArray *out, guint32 val)
+{
+  g_byte_array_append (out, (const guint8 *) &val, sizeof (val));
+}
+
+static void
+ssm_snapshot_put_u64 (GByteArray *out, guint64 val)
+{
+  g_byte_array_append (out, (const guint8 *) &val, sizeof (val));
+}
+
+static void
+ssm_snapshot_put_data (GByteArray *out, const gchar *data, guint32 len)
+{
+  if (!data) {
+    ssm_snapshot_put_u32 (out, SSM_SNAPSHOT_NULL);
+    return;
+  }
+  ssm_snapshot_put_u32 (out, len);
+  g_byte_array_append (out, (const guint8 *) data, len);
+}
+
+static void
+ssm_snapshot_put_str (GByteArray *out, const gchar *str)
+{
+  ssm_snapshot_put_data (out, str, str ? strlen (str) : 0);
+}
+
+static gconstpointer
+ssm_snapshot_get (GstSSMSnapshotReader *reader, gsize len)
+{
+  gconstpointer data = NULL;
+
+  if (reader->error || len > reader->size - reader->pos) {
+    reader->error = TRUE;
+    return NULL;
+  }
+  data = reader->data + reader->pos;
+  reader->pos += len;
+
+  return data;
+}
+
+static guint32
+ssm_snapshot_get_u32 (GstSSMSnapshotReader *reader)
+{
+  gconstpointer data = ssm_snapshot_get (reader, sizeof (guint32));
+  guint32 val = 0;
+
+  /* the mapped file has no alignment guarantee */
+  if (data)
+    memcpy (&val, data, sizeof (val));
+  return val;
+}
+
+static guint64
+ssm_snapshot_get_u64 (GstSSMSnapshotReader *reader)
+{
+  gconstpointer data = ssm_snapshot_get (reader, sizeof (guint64));
+  guint64 val = 0;
+
+  if (data)
+    memcpy (&val, data, sizeof (val));
+  return val;
+}
+
+/* newly allocated & NUL terminated, @len gets the stored length */
+static gchar *
+ssm_snapshot_get_data (GstSSMSnapshotReader *reader, guint32 *len)
+{
+  guint32 size = ssm_snapshot_get_u32 (reader);
+  gconstpointer data = NULL;
+  gchar *str = NULL;
+
+  if (len)
+    *len = 0;
+  if (reader->error || size == SSM_SNAPSHOT_NULL)
+    return NULL;
+
+  data = ssm_snapshot_get (reader, size);
+  if (!data)
+    return NULL;
+
+  str = g_malloc (size + 1);
+  memcpy (str, data, size);
+  str[size] = '\0';
+  if (len)
+    *len = size;
+
+  return str;
+}
+
+static void
+ssm_snapshot_put_stream (GByteArray *out, GstSSMStreamNode *stream)
+{
+  GList *walk = NULL;
+  guint i = 0;
+
+  ssm_snapshot_put_u32 (out, stream->type);
+  ssm_snapshot_put_u64 (out, stream->StreamTimeScale);
+  ssm_snapshot_put_u64 (out, stream->stream_duration);
+  ssm_snapshot_put_u32 (out, stream->nChunks);
+  ssm_snapshot_put_u32 (out, stream->nQualityLevels);
+  ssm_snapshot_put_u32 (out, stream->MaxWidth);
+  ssm_snapshot_put_u32 (out, stream->MaxHeight);
+  ssm_snapshot_put_u32 (out, stream->DisplayWidth);
+  ssm_snapshot_put_u32 (out, stream->DisplayHeight);
+  ssm_snapshot_put_str (out, stream->StreamType);
+  ssm_snapshot_put_str (out, stream->StreamUrl);
+  ssm_snapshot_put_str (out, stream->StreamSubType);
+  ssm_snapshot_put_str (out, stream->StreamName);
+
+  /* sorted by bitrate already */
+  ssm_snapshot_put_u32 (out, g_list_length (g_list_first (stream->quality_lists)));
+  for (walk = g_list_first (stream->quality_lists); walk; walk = g_list_next (walk)) {
+    GstSSMQualityNode *quality = walk->data;
+
+    ssm_snapshot_put_u32 (out, quality->index);
+    ssm_snapshot_put_u32 (out, quality->bitrate);
+    ssm_snapshot_put_u32 (out, quality->max_width);
+    ssm_snapshot_put_u32 (out, quality->max_height);
+    ssm_snapshot_put_u32 (out, quality->samplingrate);
+    ssm_snapshot_put_u32 (out, quality->channels);
+    ssm_snapshot_put_u32 (out, quality->bps);
+    ssm_snapshot_put_u32 (out, quality->packet_size);
+    ssm_snapshot_put_u32 (out, quality->audio_tag);
+    ssm_snapshot_put_u32 (out, quality->NALULengthofLength);
+    ssm_snapshot_put_str (out, quality->fourcc);
+    ssm_snapshot_put_str (out, quality->codec_data);
+    ssm_snapshot_put_str (out, quality->custom_attrs);
+  }
+
+  ssm_snapshot_put_u32 (out, stream->fragments->len);
+  for (i = 0; i < stream->fragments->len; i++) {
+    GstSSMFragmentNode *fragment = &g_array_index (stream->fragments, GstSSMFragmentNode, i);
+
+    ssm_snapshot_put_u32 (out, fragment->num);
+    ssm_snapshot_put_u64 (out, fragment->dur);
+    ssm_snapshot_put_u64 (out, fragment->time);
+    ssm_snapshot_put_u32 (out, fragment->media_type);
+    ssm_snapshot_put_u64 (out, fragment->ts);
+  }
+}
+
+static GstSSMStreamNode *
+ssm_snapshot_get_stream (GstSSMParse *parser, GstSSMSnapshotReader *reader)
+{
+  GstSSMStreamNode *stream = g_slice_new0 (GstSSMStreamNode);
+  guint32 n = 0;
+  guint32 i = 0;
+
+  stream->frag_lock = g_mutex_new ();
+  stream->frag_cond = g_cond_new ();
+  stream->fragments = g_array_new (FALSE, TRUE, sizeof (GstSSMFragmentNode));
+  stream->frag_index = 0;
+
+  stream->type = ssm_snapshot_get_u32 (reader);
+  stream->StreamTimeScale = ssm_snapshot_get_u64 (reader);
+  stream->stream_duration = ssm_snapshot_get_u64 (reader);
+  stream->nChunks = ssm_snapshot_get_u32 (reader);
+  stream->nQualityLevels = ssm_snapshot_get_u32 (reader);
+  stream->MaxWidth = ssm_snapshot_get_u32 (reader);
+  stream->MaxHeight = ssm_snapshot_get_u32 (reader);
+  stream->DisplayWidth = ssm_snapshot_get_u32 (reader);
+  stream->DisplayHeight = ssm_snapshot_get_u32 (reader);
+  stream->StreamType = ssm_snapshot_get_data (reader, NULL);
+  stream->StreamUrl = ssm_snapshot_get_data (reader, NULL);
+  stream->StreamSubType = ssm_snapshot_get_data (reader, NULL);
+  stream->StreamName = ssm_snapshot_get_data (reader, NULL);
+
+  if (reader->error || stream->type < SS_STREAM_VIDEO || stream->type >= SS_STREAM_NUM ||
+      !stream->StreamUrl || !ssm_parse_compile_url_template (stream))
+    goto error;
+
+  n = ssm_snapshot_get_u32 (reader);
+  for (i = 0; i < n && !reader->error; i++) {
+    GstSSMQualityNode *quality = g_slice_new0 (GstSSMQualityNode);
+
+    quality->index = ssm_snapshot_get_u32 (reader);
+    quality->bitrate = ssm_snapshot_get_u32 (reader);
+    quality->max_width = ssm_snapshot_get_u32 (reader);
+    quality->max_height = ssm_snapshot_get_u32 (reader);
+    quality->samplingrate = ssm_snapshot_get_u32 (reader);
+    quality->channels = ssm_snapshot_get_u32 (reader);
+    quality->bps = ssm_snapshot_get_u32 (reader);
+    quality->packet_size = ssm_snapshot_get_u32 (reader);
+    quality->audio_tag = ssm_snapshot_get_u32 (reader);
+    quality->NALULengthofLength = ssm_snapshot_get_u32 (reader);
+    quality->fourcc = ssm_snapshot_get_data (reader, NULL);
+    quality->codec_data = ssm_snapshot_get_data (reader, NULL);
+    quality->custom_attrs = ssm_snapshot_get_data (reader, NULL);
+    stream->quality_lists = g_list_append (stream->quality_lists, quality);
+
+    if (!reader->error)
+      ssm_parse_build_quality_caps (parser, stream, quality);
+  }
+
+  n = ssm_snapshot_get_u32 (reader);
+  if (reader->error || !n || n > (reader->size - reader->pos) / SSM_SNAPSHOT_FRAGMENT_SIZE)
+    goto error;
+  g_array_set_size (stream->fragments, n);
+  for (i = 0; i < n; i++) {
+    GstSSMFragmentNode *fragment = &g_array_index (stream->fragments, GstSSMFragmentNode, i);
+
+    fragment->num = ssm_snapshot_get_u32 (reader);
+    fragment->dur = ssm_snapshot_get_u64 (reader);
+    fragment->time = ssm_snapshot_get_u64 (reader);
+    fragment->media_type = ssm_snapshot_get_u32 (reader);
+    fragment->ts = ssm_snapshot_get_u64 (reader);
+  }
+
+  return stream;
+
+error:
+  reader->error = TRUE;
+  gst_ssm_parse_free_stream_node (stream);
+  return NULL;
+}
+
+/* writes the parsed manifest to @location, VOD presentations only */
+gboolean
+gst_ssm_parse_save_snapshot (GstSSMParse *parser, const gchar *location)
+{
+  GstSSMRootNode *root = NULL;
+  GByteArray *out = NULL;
+  GError *err = NULL;
+  gboolean ret = FALSE;
+  guint n_streams = 0;
+  gint i = 0;
+
+  g_return_val_if_fail (parser != NULL, FALSE);
+  g_return_val_if_fail (location != NULL, FALSE);
+
+  if (!GST_SSM_PARSE_IS_COMPLETE (parser) || parser->RootNode->PresentationIsLive)
+    return FALSE;
+
+  root = parser->RootNode;
+  out = g_byte_array_new ();
+
+  g_byte_array_append (out, (const guint8 *) SSM_SNAPSHOT_MAGIC, 4);
+  ssm_snapshot_put_u32 (out, SSM_SNAPSHOT_VERSION);
+
+  ssm_snapshot_put_u32 (out, root->MajorVersion);
+  ssm_snapshot_put_u32 (out, root->MinorVersion);
+  ssm_snapshot_put_u64 (out, root->TimeScale);
+  ssm_snapshot_put_u64 (out, root->Duration);
+  ssm_snapshot_put_u32 (out, root->LookAheadCount);
+  ssm_snapshot_put_u64 (out, root->DVRWindowLength);
+
+  /* presence, then SystemID & Content together, either can be NULL */
+  ssm_snapshot_put_u32 (out, root->ProtectNode != NULL);
+  if (root->ProtectNode) {
+    ssm_snapshot_put_str (out, root->ProtectNode->SystemID);
+    ssm_snapshot_put_data (out, root->ProtectNode->Content, root->ProtectNode->ContentSize);
+  }
+
+  MANIFEST_LOCK(parser);
+  for (i = 0; i < SS_STREAM_NUM; i++)
+    n_streams += g_list_length (root->streams[i]);
+  ssm_snapshot_put_u32 (out, n_streams);
+  for (i = 0; i < SS_STREAM_NUM; i++) {
+    GList *walk = NULL;
+    guint index = 0;
+
+    /* in manifest order, whichever stream is selected */
+    for (index = 0; index < g_list_length (root->streams[i]); index++) {
+      for (walk = root->streams[i]; walk; walk = g_list_next (walk)) {
+        GstSSMStreamNode *stream = walk->data;
+
+        if (stream->index != index)
+          continue;
+        g_mutex_lock (stream->frag_lock);
+        ssm_snapshot_put_stream (out, stream);
+        g_mutex_unlock (stream->frag_lock);
+        break;
+      }
+    }
+  }
+  MANIFEST_UNLOCK(parser);
+
+  /* written to a temporary file & renamed, a reader never sees half of it */
+  ret = g_file_set_contents (location, (const gchar *) out->data, out->len, &err);
+  if (ret) {
+    GST_INFO ("wrote %u bytes manifest snapshot to %s", out->len, location);
+  } else {
+    GST_WARNING ("failed to write manifest snapshot : %s", err->message);
+    g_error_free (err);
+  }
+
+  g_byte_array_free (out, TRUE);
+
+  return ret;
+}
+
+/* fills a new parser from the snapshot at @location instead of the XML
+ * manifest. On failure the parser is left as new, ready for the XML parse */
+gboolean
+gst_ssm_parse_load_snapshot (GstSSMParse *parser, const gchar *location)
+{
+  GstSSMSnapshotReader reader = { NULL, 0, 0, FALSE };
+  GMappedFile *file = NULL;
+  GstSSMRootNode *root = NULL;
+  GError *err = NULL;
+  guint32 n_streams = 0;
+  guint32 n = 0;
+  gint i = 0;
+
+  g_return_val_if_fail (parser != NULL, FALSE);
+  g_return_val_if_fail (location != NULL, FALSE);
+  g_return_val_if_fail (parser->RootNode == NULL, FALSE);
+
+  file = g_mapped_file_new (location, FALSE, &err);
+  if (!file) {
+    GST_DEBUG ("no manifest snapshot : %s", err->message);
+    g_error_free (err);
+    return FALSE;
+  }
+
+  reader.data = (const guint8 *) g_mapped_file_get_contents (file);
+  reader.size = g_mapped_file_get_length (file);
+
+  if (reader.size < 4 || memcmp (reader.data, SSM_SNAPSHOT_MAGIC, 4))
+    goto invalid;
+  reader.pos = 4;
+  if (ssm_snapshot_get_u32 (&reader) != SSM_SNAPSHOT_VERSION)
+    goto invalid;
+
+  root = parser->RootNode = g_slice_new0 (GstSSMRootNode);
+  root->MajorVersion = ssm_snapshot_get_u32 (&reader);
+  root->MinorVersion = ssm_snapshot_get_u32 (&reader);
+  root->TimeScale = ssm_snapshot_get_u64 (&reader);
+  root->Duration = ssm_snapshot_get_u64 (&reader);
+  root->LookAheadCount = ssm_snapshot_get_u32 (&reader);
+  root->DVRWindowLength = ssm_snapshot_get_u64 (&reader);
+  root->PresentationIsLive = FALSE;
+
+  if (ssm_snapshot_get_u32 (&reader)) {
+    root->ProtectNode = g_slice_new0 (GstSSMProtectionNode);
+    root->ProtectNode->SystemID = ssm_snapshot_get_data (&reader, NULL);
+    root->ProtectNode->Content = ssm_snapshot_get_data (&reader, &n);
+    root->ProtectNode->ContentSize = n;
+  }
+
+  n_streams = ssm_snapshot_get_u32 (&reader);
+  for (n = 0; n < n_streams && !reader.error; n++) {
+    GstSSMStreamNode *stream = ssm_snapshot_get_stream (parser, &reader);
+
+    if (!stream)
+      break;
+    stream->index = g_list_length (root->streams[stream->type]);
+    root->streams[stream->type] = g_list_append (root->streams[stream->type], stream);
+  }
+
+  if (reader.error || !n_streams || !ssm_parse_root_node_end (parser))
+    goto invalid;
+
+  g_mapped_file_unref (file);
+
+  GST_INFO ("loaded manifest snapshot %s, %u streams", location, n_streams);
+
+  return TRUE;
+
+invalid:
+  GST_WARNING ("invalid manifest snapshot %s, ignored", location);
+  if (parser->RootNode) {
+    for (i = 0; i < SS_STREAM_NUM; i++) {
+      g_list_foreach (root->streams[i], (GFunc) gst_ssm_parse_free_stream_node, NULL);
+      g_list_free (root->streams[i]);
+    }
+    if (root->ProtectNode) {
+      g_free (root->ProtectNode->SystemID);
+      g_free (root->ProtectNode->Content);
+      g_slice_free (GstSSMProtectionNode, root->ProtectNode);
+    }
+    g_slice_free (GstSSMRootNode, root);
+    parser->RootNode = NULL;
+  }
+  parser->complete = FALSE;
+  g_mapped_file_unref (file);
+
+  return FALSE;
+}
+
 static gboolean
 convert_NALUnitDCI_to_PacktizedDCI (unsigned char *nalu_dci, unsigned char **packetized_dci, unsigned int *packetized_dci_len)
 {
@@ -6,14 +6,13 @@
 #include <glib.h>
 #include <gst/gst.h>
 #include <libxml2/libxml/tree.h>
+#include <libxml2/libxml/parser.h>
 
 G_BEGIN_DECLS
 typedef struct _GstSSMParse GstSSMParse;
 
 #define GST_SSMPARESE(m) ((GstSSMParse*)m)
 #define XML_MAKE_FOURCC(a,b,c,d)        ((guint32)((a)|(b)<<8|(c)<<16|(d)<<24))
-#define BITRATE_SWITCH_UPPER_THRESHOLD 0.4
-#define BITRATE_SWITCH_LOWER_THRESHOLD 0.1
 
 
 typedef enum
@@ -32,11 +31,26 @@ typedef enum
   SS_MODE_AV,
 }SS_BW_MODE;
 
+typedef enum
+{
+  SS_URL_SEGMENT_LITERAL,
+  SS_URL_SEGMENT_BITRATE, /* {bitrate} */
+  SS_URL_SEGMENT_START_TIME, /* {start time} */
+  SS_URL_SEGMENT_CUSTOM_ATTRIBUTES, /* {CustomAttributes} */
+}SS_URL_SEGMENT_TYPE;
+
+typedef struct
+{
+  SS_URL_SEGMENT_TYPE type;
+  gchar *literal; /* SS_URL_SEGMENT_LITERAL only */
+}GstSSMUrlSegment;
+
 typedef struct
 {
   guint64 StreamTimeScale;
   guint64 stream_duration;
   SS_STREAM_TYPE type;
+  guint index; /* position among the StreamIndex of the same type in the manifest */
   guint nChunks;
   guint nQualityLevels;
   guint MaxWidth;
@@ -44,12 +58,14 @@ typedef struct
   guint DisplayWidth;
   guint DisplayHeight;
   GList *quality_lists;
-  GList *fragment_lists;
+  GArray *fragments; /* GstSSMFragmentNode timeline in ascending time */
+  guint frag_index; /* next fragment to download, == fragments->len at the end */
   gchar *StreamType;
   gchar *StreamUrl;
+  GArray *url_template; /* StreamUrl compiled to GstSSMUrlSegment */
+  GString *url_buf; /* reused to build fragment urls */
   gchar *StreamSubType;
   gchar *StreamName;
-  gboolean fraglist_eos;
   GMutex *frag_lock;
   GCond *frag_cond;
 }GstSSMStreamNode;
@@ -68,6 +84,8 @@ typedef struct
   guint NALULengthofLength;
   gchar *fourcc;
   gchar *codec_data;
+  gchar *custom_attrs; /* 'Name=Value,...' substituted for {CustomAttributes} */
+  GstCaps *caps; /* built once when the quality level is parsed */
 }GstSSMQualityNode;
 
 typedef struct
@@ -76,6 +94,7 @@ typedef struct
   guint64 dur;
   guint64 time;
   guint media_type;
+  GstClockTime ts; /* time scaled to nanoseconds, for seeking */
 }GstSSMFragmentNode;
 
 typedef struct
@@ -105,6 +124,17 @@ struct _GstSSMParse
   GstSSMRootNode *RootNode;
   GMutex *lock;
   guint64 ns_start;
+
+  /* incremental (SAX) manifest parsing state */
+  xmlParserCtxtPtr sax_ctxt;
+  GstSSMStreamNode *cur_stream; /* StreamIndex being parsed */
+  GstSSMQualityNode *cur_quality; /* QualityLevel being parsed */
+  gboolean in_protection;
+  GString *protect_content; /* ProtectionHeader text being parsed */
+  gboolean sax_error;
+  gboolean complete; /* root element closed, RootNode is usable */
+  guint n_caps_conversions; /* caps built from codec data so far */
+  gboolean flushing; /* live waits for the next fragment are given up */
 };
 
 #define gst_ssm_parse_check_stream(parser, stream_type) (parser->RootNode->streams[stream_type])
@@ -113,17 +143,35 @@ struct _GstSSMParse
 #define GST_SSM_PARSE_IS_LIVE_PRESENTATION(parser) (parser->RootNode->PresentationIsLive)
 #define GST_SSM_PARSE_LOOKAHEAD_COUNT(parser) (parser->RootNode->LookAheadCount)
 #define GST_SSM_PARSE_NS_START(parser) (parser->ns_start)
+#define GST_SSM_PARSE_IS_COMPLETE(parser) (parser->complete)
+#define GST_SSM_PARSE_IS_FLUSHING(parser) (parser->flushing)
+#define GST_SSM_STREAM_FRAGMENT(stream, index) (&g_array_index ((stream)->fragments, GstSSMFragmentNode, index))
+#define GST_SSM_STREAM_FRAGLIST_EOS(stream) ((stream)->frag_index >= (stream)->fragments->len)
 
 const gchar *ssm_parse_get_stream_name(SS_STREAM_TYPE type);
 GstSSMParse *gst_ssm_parse_new (const gchar * uri);
 void gst_ssm_parse_free (GstSSMParse *parser);
 gboolean gst_ssm_parse_manifest (GstSSMParse *parser, char *data, unsigned int size);
-gboolean gst_ssm_parse_get_next_fragment_url (GstSSMParse *parser, SS_STREAM_TYPE stream_type, gchar **uri, guint64 *start_ts);
+gboolean gst_ssm_parse_manifest_push (GstSSMParse *parser, const char *data, unsigned int size);
+gboolean gst_ssm_parse_manifest_finish (GstSSMParse *parser);
+gboolean gst_ssm_parse_get_next_fragment_url (GstSSMParse *parser, SS_STREAM_TYPE stream_type, gchar **uri, guint64 *start_ts, guint *bitrate);
+gboolean gst_ssm_parse_has_next_fragment (GstSSMParse *parser, SS_STREAM_TYPE stream_type);
+void gst_ssm_parse_set_flushing (GstSSMParse *parser, gboolean flushing);
 gboolean gst_ssm_parse_append_next_fragment (GstSSMParse *parser, SS_STREAM_TYPE stream_type, guint64 timestamp, guint64 duration);
 GstCaps *ssm_parse_get_stream_caps (GstSSMParse *parser, SS_STREAM_TYPE stream_type);
-SS_BW_MODE
-gst_ssm_parse_switch_qualitylevel (GstSSMParse *parser, guint drate);
+guint gst_ssm_parse_get_caps_conversions (GstSSMParse *parser);
+guint *gst_ssm_parse_get_bitrates (GstSSMParse *parser, SS_STREAM_TYPE stream_type, guint *n_bitrates, gint *cur_index);
+gboolean gst_ssm_parse_set_qualitylevel (GstSSMParse *parser, SS_STREAM_TYPE stream_type, guint index);
 gboolean gst_ssm_parse_seek_manifest (GstSSMParse *parser, guint64 seek_time);
+guint gst_ssm_parse_merge_manifest (GstSSMParse *parser, GstSSMParse *fresh);
+gboolean gst_ssm_parse_get_dvr_window (GstSSMParse *parser, GstClockTime *start, GstClockTime *stop);
+GstClockTime gst_ssm_parse_get_refresh_interval (GstSSMParse *parser);
+GstClockTime gst_ssm_parse_get_fragment_duration (GstSSMParse *parser, SS_STREAM_TYPE stream_type, guint64 start_ts);
+gboolean gst_ssm_parse_skip_fragments (GstSSMParse *parser, SS_STREAM_TYPE stream_type, guint64 ts);
+guint gst_ssm_parse_get_n_streams (GstSSMParse *parser, SS_STREAM_TYPE stream_type);
+gboolean gst_ssm_parse_select_stream (GstSSMParse *parser, SS_STREAM_TYPE stream_type, guint index, guint64 ts);
+gboolean gst_ssm_parse_save_snapshot (GstSSMParse *parser, const gchar *location);
+gboolean gst_ssm_parse_load_snapshot (GstSSMParse *parser, const gchar *location);
 G_END_DECLS
 #endif /* __SS_MANIFEST_PARSE_H__ */
 
@@ -0,0 +1,258 @@
+/*
+ * ssabrsim: replays a bandwidth trace through the ssdemux ABR engine
+ *
+ * The trace is a text file of "<seconds> <kbps>" lines, the link keeps that
+ * bandwidth for that long, the trace loops when it runs out. Fragments are
+ * downloaded back to back at the level the engine selects, the player drains
+ * the buffer in real time and stalls when it runs dry. Everything happens on
+ * a simulated clock, the same trace and options give the same output.
+ *
+ *   ssabrsim --policy=hybrid --bitrates=350,700,1500,3000 traces/cellular.trace
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ssabr.h"
+
+typedef struct
+{
+  gdouble duration; /* s */
+  gdouble bps;
+} SimSegment;
+
+static gchar *policy_name = "hybrid";
+static gchar *bitrates_str = "350,700,1500,3000,6000";
+static gdouble fragment_duration = 2.0;
+static gdouble max_buffer = 30.0;
+static gint n_fragments = 300;
+static gboolean quiet = FALSE;
+
+static GOptionEntry entries[] = {
+  {"policy", 'p', 0, G_OPTION_ARG_STRING, &policy_name, "ABR policy : throughput, buffer or hybrid", "NAME"},
+  {"bitrates", 'b', 0, G_OPTION_ARG_STRING, &bitrates_str, "Comma separated quality levels in kbps", "LIST"},
+  {"fragment-duration", 'd', 0, G_OPTION_ARG_DOUBLE, &fragment_duration, "Fragment duration in seconds", "S"},
+  {"max-buffer", 'm', 0, G_OPTION_ARG_DOUBLE, &max_buffer, "Buffered duration the player stops downloading at", "S"},
+  {"fragments", 'n', 0, G_OPTION_ARG_INT, &n_fragments, "Number of fragments to download", "N"},
+  {"quiet", 'q', 0, G_OPTION_ARG_NONE, &quiet, "Only print the summary", NULL},
+  {NULL}
+};
+
+static GArray *
+sim_load_trace (const gchar *path)
+{
+  GArray *trace = NULL;
+  gchar *contents = NULL;
+  gchar **lines = NULL;
+  GError *error = NULL;
+  gint i = 0;
+
+  if (!g_file_get_contents (path, &contents, NULL, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return NULL;
+  }
+
+  trace = g_array_new (FALSE, FALSE, sizeof (SimSegment));
+  lines = g_strsplit (contents, "\n", -1);
+  for (i = 0; lines[i]; i++) {
+    SimSegment seg;
+    gchar *line = g_strstrip (lines[i]);
+    gchar *end = NULL;
+
+    if (line[0] == '\0' || line[0] == '#')
+      continue;
+
+    seg.duration = g_ascii_strtod (line, &end);
+    seg.bps = g_ascii_strtod (end, &end) * 1000;
+    if (seg.duration <= 0 || seg.bps <= 0) {
+      g_printerr ("%s:%d: bad trace line '%s'\n", path, i + 1, line);
+      g_array_free (trace, TRUE);
+      trace = NULL;
+      break;
+    }
+    g_array_append_val (trace, seg);
+  }
+
+  if (trace && trace->len == 0) {
+    g_printerr ("%s: empty trace\n", path);
+    g_array_free (trace, TRUE);
+    trace = NULL;
+  }
+
+  g_strfreev (lines);
+  g_free (contents);
+
+  return trace;
+}
+
+/* seconds it takes to fetch @bits starting at @now */
+static gdouble
+sim_download_time (GArray *trace, gdouble now, gdouble bits)
+{
+  gdouble period = 0;
+  gdouble pos = 0;
+  gdouble elapsed = 0;
+  guint i = 0;
+
+  for (i = 0; i < trace->len; i++)
+    period += g_array_index (trace, SimSegment, i).duration;
+
+  /* find the segment @now falls into */
+  pos = now - period * (guint64) (now / period);
+  for (i = 0; i + 1 < trace->len && pos >= g_array_index (trace, SimSegment, i).duration; i++)
+    pos -= g_array_index (trace, SimSegment, i).duration;
+
+  while (TRUE) {
+    SimSegment *seg = &g_array_index (trace, SimSegment, i);
+    gdouble left = seg->duration - pos;
+
+    if (seg->bps * left >= bits)
+      return elapsed + bits / seg->bps;
+
+    bits -= seg->bps * left;
+    elapsed += left;
+    pos = 0;
+    i = (i + 1) % trace->len;
+  }
+}
+
+static guint *
+sim_parse_bitrates (const gchar *str, guint *n_bitrates)
+{
+  gchar **levels = g_strsplit (str, ",", -1);
+  guint *bitrates = g_new0 (guint, g_strv_length (levels));
+  guint n = 0;
+
+  for (n = 0; levels[n]; n++) {
+    bitrates[n] = atoi (levels[n]) * 1000;
+    if (bitrates[n] == 0 || (n > 0 && bitrates[n] <= bitrates[n - 1])) {
+      g_printerr ("bitrates must be increasing & non zero : %s\n", str);
+      g_free (bitrates);
+      bitrates = NULL;
+      break;
+    }
+  }
+
+  g_strfreev (levels);
+  *n_bitrates = n;
+
+  return bitrates;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *ctx = NULL;
+  GError *error = NULL;
+  GArray *trace = NULL;
+  GstSSAbr *abr = NULL;
+  SS_ABR_POLICY policy = SS_ABR_POLICY_HYBRID;
+  guint *bitrates = NULL;
+  guint n_bitrates = 0;
+  gdouble now = 0;
+  gdouble buffered = 0;
+  gdouble startup = 0;
+  gdouble rebuffer = 0;
+  gdouble played_bits = 0;
+  guint n_stalls = 0;
+  guint n_switches = 0;
+  gint cur = 0;
+  gint i = 0;
+
+  ctx = g_option_context_new ("TRACE - replay a bandwidth trace through the ABR engine");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (argc != 2) {
+    g_printerr ("usage: %s [OPTION...] TRACE\n", argv[0]);
+    return 1;
+  }
+
+  if (!strcmp (policy_name, "throughput"))
+    policy = SS_ABR_POLICY_THROUGHPUT;
+  else if (!strcmp (policy_name, "buffer"))
+    policy = SS_ABR_POLICY_BUFFER;
+  else if (!strcmp (policy_name, "hybrid"))
+    policy = SS_ABR_POLICY_HYBRID;
+  else {
+    g_printerr ("unknown policy '%s'\n", policy_name);
+    return 1;
+  }
+
+  if (fragment_duration <= 0 || max_buffer < fragment_duration || n_fragments <= 0) {
+    g_printerr ("bad fragment duration, buffer size or fragment count\n");
+    return 1;
+  }
+
+  bitrates = sim_parse_bitrates (bitrates_str, &n_bitrates);
+  if (!bitrates)
+    return 1;
+
+  trace = sim_load_trace (argv[1]);
+  if (!trace) {
+    g_free (bitrates);
+    return 1;
+  }
+
+  abr = gst_ss_abr_new (policy);
+
+  if (!quiet)
+    g_print ("#  frag    time(s)  rate(kbps)  estimate(kbps)  buffer(s)  level  kbps\n");
+
+  for (i = 0; i < n_fragments; i++) {
+    gdouble bits = (gdouble) bitrates[cur] * fragment_duration;
+    gdouble took = sim_download_time (trace, now, bits);
+    gdouble rate = bits / took;
+    gint next = 0;
+
+    /* playback starts once the first fragment is in */
+    if (i == 0) {
+      startup = took;
+    } else if (took > buffered) {
+      rebuffer += took - buffered;
+      n_stalls++;
+      buffered = 0;
+    } else {
+      buffered -= took;
+    }
+    now += took;
+    buffered += fragment_duration;
+    played_bits += bits;
+
+    /* a full buffer pauses the downloads until there is room for a fragment */
+    if (buffered > max_buffer) {
+      now += buffered - max_buffer;
+      buffered = max_buffer;
+    }
+
+    gst_ss_abr_add_sample (abr, (guint64) rate);
+    next = gst_ss_abr_select (abr, bitrates, n_bitrates, cur, (GstClockTime) (buffered * GST_SECOND));
+
+    if (!quiet)
+      g_print ("%7d %10.2f %11.0f %15" G_GUINT64_FORMAT " %10.2f %6d %5u\n",
+          i, now, rate / 1000, gst_ss_abr_get_estimate (abr) / 1000,
+          buffered, cur, bitrates[cur] / 1000);
+
+    if (next != cur)
+      n_switches++;
+    cur = next;
+  }
+
+  g_print ("policy %s, %d fragments : average %.0f kbps, %u switches, startup %.2f s, "
+      "%u stalls for %.2f s\n", policy_name, n_fragments,
+      played_bits / (n_fragments * fragment_duration) / 1000, n_switches, startup,
+      n_stalls, rebuffer);
+
+  gst_ss_abr_free (abr);
+  g_array_free (trace, TRUE);
+  g_free (bitrates);
+
+  return 0;
+}
@@ -0,0 +1,1120 @@
+/*
+ * ssdemux-bench: plays a presentation through ssdemux & reports what it cost
+ *
+ *   souphttpsrc location=URL ! ssdemux ! queue ! fakesink   (one per stream)
+ *
+ * Meant to run against ssfixture.py (make bench). The modes are
+ *
+ *   play       : the time to the first buffer on a sink, the CPU used once
+ *                playing (after a warm-up), the switches, stalls & bytes of
+ *                each stream from the "stats" property of ssdemux and the
+ *                memory high-water mark of the process
+ *   seek-storm : --seeks flushing seeks to random positions, back to back,
+ *                waiting for a buffer after every tenth one. Fails when a
+ *                seek or the buffers after it take more than --timeout
+ *                seconds, i.e. when a stream task stalled
+ *   retry      : against ssfixture.py --live, which answers 412 for the
+ *                fragments announced ahead of its live edge. Checks that
+ *                fragment-retries rises & playback goes on once the fragment
+ *                is published, then that running out of max-retries posts
+ *                the element error, within --duration seconds each
+ *   setup      : the download pipe of ssdemux (urisrc ! piffdemux) alone,
+ *                over --fragments audio fragments of ssfixture.py, built &
+ *                torn down for every fragment, then built once & re-armed
+ *                (READY, new uri, PLAYING) for every fragment
+ *   latency    : the same re-armed download pipe over --fragments audio
+ *                fragments, its samples handed to another thread through a
+ *                queue as ssdemux does, from an appsink ("new-buffer" and a
+ *                pull, as before) then from a proxy pad chain function (as
+ *                now). Reports the latency to the first sample of a fragment,
+ *                between samples & the CPU used per fragment
+ *
+ *   ssdemux-bench --duration=60 http://127.0.0.1:8080/bench.ism/Manifest
+ *   ssdemux-bench --mode=seek-storm --seeks=500 http://127.0.0.1:8080/bench.ism/Manifest
+ *   ssdemux-bench --mode=retry --duration=20 http://127.0.0.1:8080/bench.ism/Manifest
+ *   ssdemux-bench --mode=setup --fragments=500 http://127.0.0.1:8080/bench.ism/Manifest
+ *   ssdemux-bench --mode=latency http://127.0.0.1:8080/bench.ism/Manifest
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <gst/gst.h>
+
+/* a buffer is waited for after this many seeks in the seek-storm mode */
+#define BENCH_SEEK_SETTLE 10
+
+/* audio fragments of ssfixture.py at its defaults */
+#define BENCH_FRAGMENT_URL "%s/QualityLevels(128000)/Fragments(audio=%" G_GUINT64_FORMAT ")"
+#define BENCH_FRAGMENT_DURATION 20000000
+#define BENCH_FIXTURE_FRAGMENTS 150
+#define BENCH_AUDIO_CAPS "audio/mpeg, mpegversion=(int)4, framed=(boolean)true, " \
+    "stream-format=(string)raw, rate=(int)44100, channels=(int)2, codec_data=(buffer)1210"
+
+static gchar *mode_name = "play";
+static gint duration = 60;
+static gint warmup = 5;
+static gboolean no_sync = FALSE;
+static gint n_seeks = 300;
+static gint timeout = 10;
+static gint n_fragments = 200;
+
+static GOptionEntry entries[] = {
+  {"mode", 'm', 0, G_OPTION_ARG_STRING, &mode_name, "play, seek-storm, retry, setup or latency", "MODE"},
+  {"duration", 'd', 0, G_OPTION_ARG_INT, &duration, "Seconds measured after the warm-up", "S"},
+  {"warmup", 'w', 0, G_OPTION_ARG_INT, &warmup, "Seconds played before measuring the CPU", "S"},
+  {"no-sync", 'n', 0, G_OPTION_ARG_NONE, &no_sync, "Don't play in real time, as fast as the link goes", NULL},
+  {"seeks", 's', 0, G_OPTION_ARG_INT, &n_seeks, "Seeks of the seek-storm mode", "N"},
+  {"timeout", 't', 0, G_OPTION_ARG_INT, &timeout, "Seconds a seek or a buffer may take before the stream is considered stalled", "S"},
+  {"fragments", 'f', 0, G_OPTION_ARG_INT, &n_fragments, "Fragments downloaded in the setup & latency modes", "N"},
+  {NULL}
+};
+
+typedef struct
+{
+  GMainLoop *loop;
+  GstElement *pipeline;
+  GstElement *demux;
+
+  GMutex *lock;
+  GCond *cond;
+  GstClockTime start;           /* PLAYING requested */
+  GstClockTime first;           /* first buffer on a sink */
+  GstClockTime last;            /* last buffer on a sink */
+  guint64 buffers;
+
+  GstClockTime steady;          /* end of the warm-up */
+  struct rusage steady_usage;
+  GstClockTime end;
+  struct rusage end_usage;
+
+  GstClockTime seek_start;      /* seek in progress, for the watchdog */
+  guint n_seeks;
+  gboolean done;
+
+  gboolean failed;
+} Bench;
+
+static GstClockTime
+bench_now (void)
+{
+  GTimeVal now;
+
+  g_get_current_time (&now);
+  return GST_TIMEVAL_TO_TIME (now);
+}
+
+static gdouble
+bench_cpu_time (const struct rusage *usage)
+{
+  return usage->ru_utime.tv_sec + usage->ru_utime.tv_usec / 1e6 +
+      usage->ru_stime.tv_sec + usage->ru_stime.tv_usec / 1e6;
+}
+
+/* threads of the process, -1 when /proc is not there */
+static gint
+bench_threads (void)
+{
+  gchar *status = NULL;
+  gchar *line = NULL;
+  gint threads = -1;
+
+  if (!g_file_get_contents ("/proc/self/status", &status, NULL, NULL))
+    return -1;
+  line = strstr (status, "\nThreads:");
+  if (line)
+    threads = atoi (line + strlen ("\nThreads:"));
+  g_free (status);
+
+  return threads;
+}
+
+/* gst_structure_get_uint64 () is not in 0.10 */
+static gboolean
+bench_get_uint64 (const GstStructure *s, const gchar *field, guint64 *value)
+{
+  const GValue *v = gst_structure_get_value (s, field);
+
+  if (v == NULL || !G_VALUE_HOLDS_UINT64 (v))
+    return FALSE;
+  *value = g_value_get_uint64 (v);
+
+  return TRUE;
+}
+
+static gint
+bench_compare (gconstpointer a, gconstpointer b)
+{
+  gdouble da = *(const gdouble *) a;
+  gdouble db = *(const gdouble *) b;
+
+  return da < db ? -1 : da > db;
+}
+
+/* sorts @samples & prints their percentiles, in @unit */
+static void
+bench_print_latency (const gchar *what, GArray *samples, const gchar *unit)
+{
+  gdouble *v = (gdouble *) samples->data;
+  guint n = samples->len;
+
+  if (!n)
+    return;
+
+  g_array_sort (samples, bench_compare);
+  g_print ("%-8s: p50 %.1f %s, p99 %.1f %s, max %.1f %s over %u\n", what,
+      v[n / 2], unit, v[MIN (n - 1, n * 99 / 100)], unit, v[n - 1], unit, n);
+}
+
+static void
+bench_handoff (GstElement *sink, GstBuffer *buf, GstPad *pad, Bench *bench)
+{
+  g_mutex_lock (bench->lock);
+  bench->last = bench_now ();
+  if (!GST_CLOCK_TIME_IS_VALID (bench->first))
+    bench->first = bench->last;
+  bench->buffers++;
+  g_cond_broadcast (bench->cond);
+  g_mutex_unlock (bench->lock);
+}
+
+static void
+bench_pad_added (GstElement *demux, GstPad *pad, Bench *bench)
+{
+  GstElement *queue = gst_element_factory_make ("queue", NULL);
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstPad *sinkpad = NULL;
+
+  g_object_set (sink, "sync", !no_sync, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (bench_handoff), bench);
+
+  gst_bin_add_many (GST_BIN (bench->pipeline), queue, sink, NULL);
+  gst_element_link (queue, sink);
+
+  sinkpad = gst_element_get_static_pad (queue, "sink");
+  if (gst_pad_link (pad, sinkpad) != GST_PAD_LINK_OK)
+    g_printerr ("could not link %s\n", GST_PAD_NAME (pad));
+  gst_object_unref (sinkpad);
+
+  gst_element_sync_state_with_parent (sink);
+  gst_element_sync_state_with_parent (queue);
+}
+
+/* souphttpsrc ! ssdemux on @url, not started */
+static Bench *
+bench_new (const gchar *url)
+{
+  Bench *bench = g_new0 (Bench, 1);
+  GstElement *src = NULL;
+
+  bench->lock = g_mutex_new ();
+  bench->cond = g_cond_new ();
+  bench->first = GST_CLOCK_TIME_NONE;
+  bench->last = GST_CLOCK_TIME_NONE;
+  bench->steady = GST_CLOCK_TIME_NONE;
+  bench->end = GST_CLOCK_TIME_NONE;
+  bench->seek_start = GST_CLOCK_TIME_NONE;
+
+  bench->pipeline = gst_pipeline_new ("bench");
+  src = gst_element_factory_make ("souphttpsrc", NULL);
+  bench->demux = gst_element_factory_make ("ssdemux", NULL);
+  if (!src || !bench->demux) {
+    g_printerr ("souphttpsrc or ssdemux missing, check GST_PLUGIN_PATH\n");
+    exit (1);
+  }
+  g_object_set (src, "location", url, NULL);
+  gst_bin_add_many (GST_BIN (bench->pipeline), src, bench->demux, NULL);
+  gst_element_link (src, bench->demux);
+  g_signal_connect (bench->demux, "pad-added", G_CALLBACK (bench_pad_added), bench);
+
+  return bench;
+}
+
+static void
+bench_free (Bench *bench)
+{
+  gst_element_set_state (bench->pipeline, GST_STATE_NULL);
+  gst_object_unref (bench->pipeline);
+  if (bench->loop)
+    g_main_loop_unref (bench->loop);
+  g_mutex_free (bench->lock);
+  g_cond_free (bench->cond);
+  g_free (bench);
+}
+
+/* time the sinks got @buffers buffers at, GST_CLOCK_TIME_NONE after
+ * --timeout seconds */
+static GstClockTime
+bench_wait_buffers (Bench *bench, guint64 buffers)
+{
+  GstClockTime last = GST_CLOCK_TIME_NONE;
+  GTimeVal deadline;
+
+  g_get_current_time (&deadline);
+  g_time_val_add (&deadline, timeout * G_USEC_PER_SEC);
+
+  g_mutex_lock (bench->lock);
+  while (bench->buffers < buffers)
+    if (!g_cond_timed_wait (bench->cond, bench->lock, &deadline))
+      break;
+  if (bench->buffers >= buffers)
+    last = bench->last;
+  g_mutex_unlock (bench->lock);
+
+  return last;
+}
+
+/* prints & returns TRUE when an error was posted */
+static gboolean
+bench_check_error (Bench *bench)
+{
+  GstBus *bus = gst_element_get_bus (bench->pipeline);
+  GstMessage *msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ERROR);
+  GError *error = NULL;
+  gchar *debug = NULL;
+
+  gst_object_unref (bus);
+  if (!msg)
+    return FALSE;
+
+  gst_message_parse_error (msg, &error, &debug);
+  g_printerr ("error from %s : %s\n%s\n", GST_OBJECT_NAME (GST_MESSAGE_SRC (msg)),
+      error->message, debug ? debug : "");
+  g_error_free (error);
+  g_free (debug);
+  gst_message_unref (msg);
+
+  return TRUE;
+}
+
+static gboolean
+bench_bus_cb (GstBus *bus, GstMessage *msg, Bench *bench)
+{
+  switch (GST_MESSAGE_TYPE (msg)) {
+    case GST_MESSAGE_ERROR:{
+      GError *error = NULL;
+      gchar *debug = NULL;
+
+      gst_message_parse_error (msg, &error, &debug);
+      g_printerr ("error from %s : %s\n%s\n", GST_OBJECT_NAME (GST_MESSAGE_SRC (msg)),
+          error->message, debug ? debug : "");
+      g_error_free (error);
+      g_free (debug);
+      bench->failed = TRUE;
+      g_main_loop_quit (bench->loop);
+      break;
+    }
+    case GST_MESSAGE_EOS:
+      g_print ("end of stream before the end of the measure\n");
+      g_main_loop_quit (bench->loop);
+      break;
+    case GST_MESSAGE_ELEMENT:{
+      const GstStructure *s = gst_message_get_structure (msg);
+      guint64 ttff = 0;
+
+      if (gst_structure_has_name (s, "ssdemux-ttff") &&
+          bench_get_uint64 (s, "time", &ttff))
+        g_print ("ssdemux ttff %-6s : %.0f ms\n", gst_structure_get_string (s, "stream"),
+            (gdouble) ttff / GST_MSECOND);
+      break;
+    }
+    default:
+      break;
+  }
+
+  return TRUE;
+}
+
+/* takes the usage snapshots, quits at the end of the measure */
+static gboolean
+bench_tick (Bench *bench)
+{
+  GstClockTime first;
+  GstClockTime now = bench_now ();
+
+  g_mutex_lock (bench->lock);
+  first = bench->first;
+  g_mutex_unlock (bench->lock);
+
+  if (!GST_CLOCK_TIME_IS_VALID (first))
+    return TRUE;
+
+  if (!GST_CLOCK_TIME_IS_VALID (bench->steady)) {
+    if (now - first >= warmup * GST_SECOND) {
+      bench->steady = now;
+      getrusage (RUSAGE_SELF, &bench->steady_usage);
+    }
+  } else if (now - bench->steady >= duration * GST_SECOND) {
+    bench->end = now;
+    getrusage (RUSAGE_SELF, &bench->end_usage);
+    g_main_loop_quit (bench->loop);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+bench_print_stream (const GstStructure *s, const gchar *name)
+{
+  gchar *field = NULL;
+  guint switches = 0, stalls = 0, bitrate = 0;
+  guint64 bytes = 0;
+  gint level = -1;
+
+  field = g_strdup_printf ("%s-bytes", name);
+  if (!bench_get_uint64 (s, field, &bytes)) {
+    g_free (field);
+    return;
+  }
+  g_free (field);
+
+  field = g_strdup_printf ("%s-switches", name);
+  gst_structure_get_uint (s, field, &switches);
+  g_free (field);
+  field = g_strdup_printf ("%s-stalls", name);
+  gst_structure_get_uint (s, field, &stalls);
+  g_free (field);
+  field = g_strdup_printf ("%s-bitrate", name);
+  gst_structure_get_uint (s, field, &bitrate);
+  g_free (field);
+  field = g_strdup_printf ("%s-quality-level", name);
+  gst_structure_get_int (s, field, &level);
+  g_free (field);
+
+  g_print ("%-6s : level %d at %u kbps, %u switches, %u stalls, %" G_GUINT64_FORMAT " KB\n",
+      name, level, bitrate / 1000, switches, stalls, bytes / 1024);
+}
+
+static gboolean
+bench_play (const gchar *url)
+{
+  Bench *bench = bench_new (url);
+  GstStructure *stats = NULL;
+  GstBus *bus = NULL;
+  gboolean ret;
+
+  bench->loop = g_main_loop_new (NULL, FALSE);
+  bus = gst_element_get_bus (bench->pipeline);
+  gst_bus_add_watch (bus, (GstBusFunc) bench_bus_cb, bench);
+  gst_object_unref (bus);
+  g_timeout_add (100, (GSourceFunc) bench_tick, bench);
+
+  bench->start = bench_now ();
+  gst_element_set_state (bench->pipeline, GST_STATE_PLAYING);
+  g_main_loop_run (bench->loop);
+
+  /* the stats are gone once the demuxer is stopped */
+  g_object_get (bench->demux, "stats", &stats, NULL);
+  gst_element_set_state (bench->pipeline, GST_STATE_NULL);
+
+  if (GST_CLOCK_TIME_IS_VALID (bench->first))
+    g_print ("startup : first buffer %.0f ms after PLAYING\n",
+        (gdouble) (bench->first - bench->start) / GST_MSECOND);
+  else
+    g_print ("startup : no buffer reached the sinks\n");
+
+  if (GST_CLOCK_TIME_IS_VALID (bench->end)) {
+    gdouble cpu = bench_cpu_time (&bench->end_usage) - bench_cpu_time (&bench->steady_usage);
+    gdouble wall = (gdouble) (bench->end - bench->steady) / GST_SECOND;
+
+    g_print ("cpu     : %.2f s over %.1f s of playback, %.1f %% of a core\n",
+        cpu, wall, 100 * cpu / wall);
+  }
+  g_print ("buffers : %" G_GUINT64_FORMAT "\n", bench->buffers);
+
+  if (stats) {
+    bench_print_stream (stats, "video");
+    bench_print_stream (stats, "audio");
+    gst_structure_free (stats);
+  }
+
+  ret = !bench->failed;
+  bench_free (bench);
+
+  return ret;
+}
+
+/* a deadlocked seek never returns, there is nothing left to do but report
+ * it & exit */
+static gpointer
+bench_watchdog (Bench *bench)
+{
+  for (;;) {
+    g_usleep (100 * 1000);
+
+    g_mutex_lock (bench->lock);
+    if (bench->done) {
+      g_mutex_unlock (bench->lock);
+      return NULL;
+    }
+    if (GST_CLOCK_TIME_IS_VALID (bench->seek_start) &&
+        bench_now () - bench->seek_start > timeout * GST_SECOND) {
+      g_printerr ("seek-storm : seek %u did not return after %d s, a stream task stalled\n",
+          bench->n_seeks + 1, timeout);
+      fflush (stdout);
+      _exit (1);
+    }
+    g_mutex_unlock (bench->lock);
+  }
+
+  return NULL;
+}
+
+static gboolean
+bench_seek_storm (const gchar *url)
+{
+  Bench *bench = bench_new (url);
+  GArray *seeks = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  GArray *recoveries = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  GRand *rand = g_rand_new_with_seed (0);
+  GstFormat format = GST_FORMAT_TIME;
+  gint64 length = -1;
+  GThread *watchdog = NULL;
+  GstStructure *stats = NULL;
+  guint rejected = 0;
+  gboolean ret = FALSE;
+  gint threads = 0;
+  gint i;
+
+  gst_element_set_state (bench->pipeline, GST_STATE_PLAYING);
+  if (!GST_CLOCK_TIME_IS_VALID (bench_wait_buffers (bench, 1))) {
+    g_printerr ("seek-storm : no buffer reached the sinks\n");
+    goto done;
+  }
+  if (!gst_element_query_duration (bench->pipeline, &format, &length) || length <= 0) {
+    g_printerr ("seek-storm : no duration, not a VOD presentation?\n");
+    goto done;
+  }
+  threads = bench_threads ();
+
+  g_print ("seek-storm : %d seeks in %.0f s, %d threads playing\n", n_seeks,
+      (gdouble) length / GST_SECOND, threads);
+
+  watchdog = g_thread_create ((GThreadFunc) bench_watchdog, bench, TRUE, NULL);
+
+  for (i = 0; i < n_seeks; i++) {
+    GstClockTime position = (GstClockTime) g_rand_double_range (rand, 0, length * 0.9);
+    GstClockTime start = bench_now ();
+    guint64 buffers;
+    gdouble ms;
+
+    g_mutex_lock (bench->lock);
+    bench->seek_start = start;
+    g_mutex_unlock (bench->lock);
+
+    if (!gst_element_seek_simple (bench->pipeline, GST_FORMAT_TIME,
+            GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT, position))
+      rejected++;
+
+    g_mutex_lock (bench->lock);
+    bench->seek_start = GST_CLOCK_TIME_NONE;
+    bench->n_seeks++;
+    buffers = bench->buffers;
+    g_mutex_unlock (bench->lock);
+
+    ms = (gdouble) (bench_now () - start) / GST_MSECOND;
+    g_array_append_val (seeks, ms);
+
+    if (bench_check_error (bench))
+      goto done;
+
+    /* the buffers after the seek show the stream tasks were restarted */
+    if ((i + 1) % BENCH_SEEK_SETTLE == 0 || i == n_seeks - 1) {
+      GstClockTime last = bench_wait_buffers (bench, buffers + 1);
+
+      if (!GST_CLOCK_TIME_IS_VALID (last)) {
+        g_printerr ("seek-storm : no buffer within %d s of seek %d, a stream task stalled\n",
+            timeout, i + 1);
+        goto done;
+      }
+      ms = (gdouble) (last - start) / GST_MSECOND;
+      g_array_append_val (recoveries, ms);
+    }
+  }
+
+  g_object_get (bench->demux, "stats", &stats, NULL);
+
+  bench_print_latency ("seek", seeks, "ms");
+  bench_print_latency ("buffer", recoveries, "ms");
+  g_print ("rejected: %u seeks\n", rejected);
+  g_print ("threads : %d after the seeks\n", bench_threads ());
+  if (stats) {
+    bench_print_stream (stats, "video");
+    bench_print_stream (stats, "audio");
+    gst_structure_free (stats);
+  }
+  ret = TRUE;
+
+done:
+  g_mutex_lock (bench->lock);
+  bench->done = TRUE;
+  g_mutex_unlock (bench->lock);
+  if (watchdog)
+    g_thread_join (watchdog);
+
+  g_rand_free (rand);
+  g_array_free (seeks, TRUE);
+  g_array_free (recoveries, TRUE);
+  bench_free (bench);
+
+  return ret;
+}
+
+/* the fixture has the fragment a while after announcing it, retries every
+ * 100 ms up to 1 s without a limit get it */
+static gboolean
+bench_retry_recover (const gchar *url)
+{
+  Bench *bench = bench_new (url);
+  GstClockTime start, first, last, retried = GST_CLOCK_TIME_NONE;
+  guint64 retries = 0, failures = 0;
+  gboolean ret = FALSE;
+
+  g_object_set (bench->demux, "retry-delay", (guint64) 100 * GST_MSECOND,
+      "retry-max-delay", (guint64) GST_SECOND, "max-retries", 0, NULL);
+
+  start = bench_now ();
+  gst_element_set_state (bench->pipeline, GST_STATE_PLAYING);
+
+  while (bench_now () - start < duration * GST_SECOND) {
+    g_usleep (100 * 1000);
+    if (bench_check_error (bench))
+      goto done;
+
+    g_object_get (bench->demux, "fragment-retries", &retries, NULL);
+    if (retries && !GST_CLOCK_TIME_IS_VALID (retried))
+      retried = bench_now ();
+
+    /* a buffer after the first retry, the retried fragment came in */
+    g_mutex_lock (bench->lock);
+    last = bench->last;
+    g_mutex_unlock (bench->lock);
+    if (GST_CLOCK_TIME_IS_VALID (retried) && GST_CLOCK_TIME_IS_VALID (last) && last > retried)
+      break;
+  }
+
+  g_object_get (bench->demux, "fragment-retry-failures", &failures, NULL);
+  g_mutex_lock (bench->lock);
+  first = bench->first;
+  last = bench->last;
+  g_mutex_unlock (bench->lock);
+
+  if (!retries) {
+    g_printerr ("retry : no fragment retried in %d s, is ssfixture.py running with --live?\n", duration);
+    goto done;
+  }
+  if (!GST_CLOCK_TIME_IS_VALID (last) || last <= retried) {
+    g_printerr ("retry : no buffer after the first retry in %d s\n", duration);
+    goto done;
+  }
+  if (failures) {
+    g_printerr ("retry : %" G_GUINT64_FORMAT " fragments given up without max-retries\n", failures);
+    goto done;
+  }
+
+  g_print ("retry   : %" G_GUINT64_FORMAT " retries, first buffer %.0f ms after PLAYING\n",
+      retries, (gdouble) (first - start) / GST_MSECOND);
+  ret = TRUE;
+
+done:
+  bench_free (bench);
+
+  return ret;
+}
+
+/* a single retry 1 ms later can't get a fragment published a fragment
+ * duration later, the demuxer has to give up with an error */
+static gboolean
+bench_retry_give_up (const gchar *url)
+{
+  Bench *bench = bench_new (url);
+  GstBus *bus = gst_element_get_bus (bench->pipeline);
+  GstMessage *msg = NULL;
+  GstClockTime start;
+  guint64 failures = 0;
+  GError *error = NULL;
+  gboolean ret = FALSE;
+
+  g_object_set (bench->demux, "retry-delay", (guint64) GST_MSECOND,
+      "retry-max-delay", (guint64) GST_MSECOND, "max-retries", 1, NULL);
+
+  start = bench_now ();
+  gst_element_set_state (bench->pipeline, GST_STATE_PLAYING);
+
+  msg = gst_bus_timed_pop_filtered (bus, duration * GST_SECOND, GST_MESSAGE_ERROR);
+  if (!msg) {
+    g_printerr ("give-up : no error in %d s with max-retries=1\n", duration);
+    goto done;
+  }
+  if (GST_MESSAGE_SRC (msg) != GST_OBJECT (bench->demux)) {
+    g_printerr ("give-up : error from %s, not from ssdemux\n", GST_OBJECT_NAME (GST_MESSAGE_SRC (msg)));
+    goto done;
+  }
+
+  g_object_get (bench->demux, "fragment-retry-failures", &failures, NULL);
+  if (!failures) {
+    g_printerr ("give-up : error without a fragment-retry-failures\n");
+    goto done;
+  }
+
+  gst_message_parse_error (msg, &error, NULL);
+  g_print ("give-up : \"%s\" %.0f ms after PLAYING, %" G_GUINT64_FORMAT " fragments given up\n",
+      error->message, (gdouble) (bench_now () - start) / GST_MSECOND, failures);
+  g_error_free (error);
+  ret = TRUE;
+
+done:
+  if (msg)
+    gst_message_unref (msg);
+  gst_object_unref (bus);
+  bench_free (bench);
+
+  return ret;
+}
+
+static gboolean
+bench_retry (const gchar *url)
+{
+  return bench_retry_recover (url) && bench_retry_give_up (url);
+}
+
+/* urisrc ! piffdemux, as the download pipe of ssdemux, ending in @sink or,
+ * without one, in the unparented @proxy pad. Without piffdemux, urisrc
+ * alone */
+static GstElement *
+bench_download_pipe (const gchar *uri, GstElement *sink, GstPad *proxy)
+{
+  GstElement *pipe = gst_pipeline_new ("download");
+  GstElement *src = gst_element_make_from_uri (GST_URI_SRC, uri, "src");
+  GstElement *parser = gst_element_factory_make ("piffdemux", "parser");
+  GstElement *tail = NULL;
+  GstPad *srcpad = NULL;
+
+  if (!src) {
+    g_printerr ("no source for %s\n", uri);
+    exit (1);
+  }
+  g_object_set (src, "is-live", FALSE, NULL);
+
+  gst_bin_add (GST_BIN (pipe), src);
+  tail = src;
+  if (parser) {
+    gst_bin_add (GST_BIN (pipe), parser);
+    gst_element_link (src, parser);
+    tail = parser;
+  }
+
+  if (sink) {
+    g_object_set (sink, "sync", FALSE, NULL);
+    gst_bin_add (GST_BIN (pipe), sink);
+    gst_element_link (tail, sink);
+  } else {
+    srcpad = gst_element_get_static_pad (tail, "src");
+    gst_pad_link (srcpad, proxy);
+    gst_object_unref (srcpad);
+  }
+
+  return pipe;
+}
+
+/* points the pipe built by bench_download_pipe () to another fragment */
+static gboolean
+bench_download_rearm (GstElement *pipe, const gchar *uri)
+{
+  GstElement *src = gst_bin_get_by_name (GST_BIN (pipe), "src");
+  gboolean ret;
+
+  gst_element_set_state (pipe, GST_STATE_READY);
+  ret = gst_uri_handler_set_uri (GST_URI_HANDLER (src), uri);
+  gst_object_unref (src);
+
+  return ret;
+}
+
+/* what gst_ss_demux_rearm_download_pipe () sets per fragment */
+static void
+bench_download_arm (GstElement *pipe, GstCaps *caps, guint64 start_ts)
+{
+  GstElement *parser = gst_bin_get_by_name (GST_BIN (pipe), "parser");
+
+  if (parser) {
+    g_object_set (parser, "caps", caps, "start-ts", start_ts, NULL);
+    gst_object_unref (parser);
+  }
+}
+
+/* plays @pipe to EOS */
+static gboolean
+bench_download (GstElement *pipe)
+{
+  GstBus *bus = gst_element_get_bus (pipe);
+  GstMessage *msg = NULL;
+  gboolean ret;
+
+  gst_element_set_state (pipe, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, timeout * GST_SECOND, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  ret = msg && GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS;
+  if (msg)
+    gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  return ret;
+}
+
+static void
+bench_print_setup (const gchar *what, GArray *samples, const struct rusage *before,
+    const struct rusage *after)
+{
+  gdouble cpu = (bench_cpu_time (after) - bench_cpu_time (before)) * 1e3;
+
+  bench_print_latency (what, samples, "ms");
+  g_print ("%-8s: %.2f ms CPU per fragment\n", "", cpu / samples->len);
+}
+
+static gboolean
+bench_setup (const gchar *url)
+{
+  gchar *base = g_path_get_dirname (url);
+  GArray *created = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  GArray *rearmed = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  GstCaps *caps = gst_caps_from_string (BENCH_AUDIO_CAPS);
+  GstElement *pipe = NULL;
+  GstElement *parser = NULL;
+  struct rusage before, after;
+  gboolean ret = FALSE;
+  gint i;
+
+  parser = gst_element_factory_make ("piffdemux", NULL);
+  g_print ("setup   : %d fragments through urisrc ! %sfakesink\n", n_fragments,
+      parser ? "piffdemux ! " : "");
+  if (parser)
+    gst_object_unref (parser);
+
+  /* a pipe per fragment, as before the download pipes were kept */
+  getrusage (RUSAGE_SELF, &before);
+  for (i = 0; i < n_fragments; i++) {
+    guint64 start_ts = (guint64) (i % BENCH_FIXTURE_FRAGMENTS) * BENCH_FRAGMENT_DURATION;
+    gchar *uri = g_strdup_printf (BENCH_FRAGMENT_URL, base, start_ts);
+    GstClockTime start = bench_now ();
+    gboolean ok;
+    gdouble ms;
+
+    pipe = bench_download_pipe (uri, gst_element_factory_make ("fakesink", NULL), NULL);
+    bench_download_arm (pipe, caps, start_ts);
+    ok = bench_download (pipe);
+    gst_element_set_state (pipe, GST_STATE_NULL);
+    gst_object_unref (pipe);
+    pipe = NULL;
+    ms = (gdouble) (bench_now () - start) / GST_MSECOND;
+    g_array_append_val (created, ms);
+
+    if (!ok) {
+      g_printerr ("setup : %s was not downloaded\n", uri);
+      g_free (uri);
+      goto done;
+    }
+    g_free (uri);
+  }
+  getrusage (RUSAGE_SELF, &after);
+  bench_print_setup ("new pipe", created, &before, &after);
+
+  /* one pipe re-armed for every fragment */
+  getrusage (RUSAGE_SELF, &before);
+  for (i = 0; i < n_fragments; i++) {
+    guint64 start_ts = (guint64) (i % BENCH_FIXTURE_FRAGMENTS) * BENCH_FRAGMENT_DURATION;
+    gchar *uri = g_strdup_printf (BENCH_FRAGMENT_URL, base, start_ts);
+    GstClockTime start = bench_now ();
+    gboolean ok = TRUE;
+    gdouble ms;
+
+    if (!pipe)
+      pipe = bench_download_pipe (uri, gst_element_factory_make ("fakesink", NULL), NULL);
+    else
+      ok = bench_download_rearm (pipe, uri);
+    bench_download_arm (pipe, caps, start_ts);
+    ok = ok && bench_download (pipe);
+    ms = (gdouble) (bench_now () - start) / GST_MSECOND;
+    g_array_append_val (rearmed, ms);
+
+    if (!ok) {
+      g_printerr ("setup : %s was not downloaded\n", uri);
+      g_free (uri);
+      goto done;
+    }
+    g_free (uri);
+  }
+  getrusage (RUSAGE_SELF, &after);
+  bench_print_setup ("re-arm", rearmed, &before, &after);
+  ret = TRUE;
+
+done:
+  if (pipe) {
+    gst_element_set_state (pipe, GST_STATE_NULL);
+    gst_object_unref (pipe);
+  }
+  gst_caps_unref (caps);
+  g_array_free (created, TRUE);
+  g_array_free (rearmed, TRUE);
+  g_free (base);
+
+  return ret;
+}
+
+/* the samples of a fragment on their way to the consuming thread, the
+ * stream task in ssdemux */
+typedef struct
+{
+  GMutex *lock;
+  GCond *cond;
+  GQueue *queue;
+  gboolean eos;
+} BenchSamples;
+
+static void
+bench_samples_push (BenchSamples *samples, GstBuffer *buf)
+{
+  g_mutex_lock (samples->lock);
+  if (buf)
+    g_queue_push_tail (samples->queue, buf);
+  else
+    samples->eos = TRUE;
+  g_cond_signal (samples->cond);
+  g_mutex_unlock (samples->lock);
+}
+
+/* next sample, NULL at EOS or after --timeout seconds */
+static GstBuffer *
+bench_samples_pop (BenchSamples *samples)
+{
+  GstBuffer *buf = NULL;
+  GTimeVal deadline;
+
+  g_get_current_time (&deadline);
+  g_time_val_add (&deadline, timeout * G_USEC_PER_SEC);
+
+  g_mutex_lock (samples->lock);
+  while (g_queue_is_empty (samples->queue) && !samples->eos)
+    if (!g_cond_timed_wait (samples->cond, samples->lock, &deadline))
+      break;
+  buf = g_queue_pop_head (samples->queue);
+  g_mutex_unlock (samples->lock);
+
+  return buf;
+}
+
+static void
+bench_appsink_new_buffer (GstElement *appsink, BenchSamples *samples)
+{
+  GstBuffer *buf = NULL;
+
+  g_signal_emit_by_name (appsink, "pull-buffer", &buf);
+  if (buf)
+    bench_samples_push (samples, buf);
+}
+
+static void
+bench_appsink_eos (GstElement *appsink, BenchSamples *samples)
+{
+  bench_samples_push (samples, NULL);
+}
+
+static GstFlowReturn
+bench_proxy_chain (GstPad *pad, GstBuffer *buf)
+{
+  bench_samples_push (gst_pad_get_element_private (pad), buf);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+bench_proxy_event (GstPad *pad, GstEvent *event)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS)
+    bench_samples_push (gst_pad_get_element_private (pad), NULL);
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+/* downloads --fragments fragments through a pipe ending in an appsink or,
+ * @use_appsink being FALSE, in a proxy pad */
+static gboolean
+bench_latency_run (const gchar *base, gboolean use_appsink)
+{
+  GArray *first = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  GArray *between = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  GstCaps *caps = gst_caps_from_string (BENCH_AUDIO_CAPS);
+  const gchar *what = use_appsink ? "appsink" : "proxy";
+  GstElement *pipe = NULL;
+  GstPad *proxy = NULL;
+  BenchSamples samples;
+  struct rusage before, after;
+  gboolean ret = FALSE;
+  gint i;
+
+  samples.lock = g_mutex_new ();
+  samples.cond = g_cond_new ();
+  samples.queue = g_queue_new ();
+
+  getrusage (RUSAGE_SELF, &before);
+  for (i = 0; i < n_fragments; i++) {
+    guint64 start_ts = (guint64) (i % BENCH_FIXTURE_FRAGMENTS) * BENCH_FRAGMENT_DURATION;
+    gchar *uri = g_strdup_printf (BENCH_FRAGMENT_URL, base, start_ts);
+    GstClockTime prev;
+    GstBuffer *buf = NULL;
+    gboolean ok = TRUE;
+    gboolean got_first = FALSE;
+
+    if (!pipe && use_appsink) {
+      GstElement *sink = gst_element_factory_make ("appsink", NULL);
+
+      if (!sink) {
+        g_printerr ("latency : appsink missing\n");
+        g_free (uri);
+        goto done;
+      }
+      g_object_set (sink, "emit-signals", TRUE, NULL);
+      g_signal_connect (sink, "new-buffer", G_CALLBACK (bench_appsink_new_buffer), &samples);
+      g_signal_connect (sink, "eos", G_CALLBACK (bench_appsink_eos), &samples);
+      pipe = bench_download_pipe (uri, sink, NULL);
+    } else if (!pipe) {
+      proxy = gst_pad_new ("proxy", GST_PAD_SINK);
+      gst_pad_set_element_private (proxy, &samples);
+      gst_pad_set_chain_function (proxy, bench_proxy_chain);
+      gst_pad_set_event_function (proxy, bench_proxy_event);
+      gst_pad_set_active (proxy, TRUE);
+      pipe = bench_download_pipe (uri, NULL, proxy);
+    } else {
+      ok = bench_download_rearm (pipe, uri);
+    }
+    bench_download_arm (pipe, caps, start_ts);
+    samples.eos = FALSE;
+
+    prev = bench_now ();
+    if (!ok || gst_element_set_state (pipe, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+      g_printerr ("latency : %s was not downloaded\n", uri);
+      g_free (uri);
+      goto done;
+    }
+    g_free (uri);
+
+    while ((buf = bench_samples_pop (&samples))) {
+      GstClockTime now = bench_now ();
+      gdouble us = (gdouble) (now - prev) / GST_USECOND;
+
+      if (got_first)
+        g_array_append_val (between, us);
+      else
+        g_array_append_val (first, us);
+      got_first = TRUE;
+      prev = now;
+      gst_buffer_unref (buf);
+    }
+    if (!samples.eos) {
+      g_printerr ("latency : no sample within %d s\n", timeout);
+      goto done;
+    }
+  }
+  getrusage (RUSAGE_SELF, &after);
+
+  g_print ("%s :\n", what);
+  bench_print_latency ("first", first, "us");
+  bench_print_latency ("between", between, "us");
+  g_print ("%-8s: %.2f ms CPU per fragment\n", "cpu",
+      (bench_cpu_time (&after) - bench_cpu_time (&before)) * 1e3 / n_fragments);
+  ret = TRUE;
+
+done:
+  if (pipe) {
+    gst_element_set_state (pipe, GST_STATE_NULL);
+    gst_object_unref (pipe);
+  }
+  if (proxy)
+    gst_object_unref (proxy);
+  while (!g_queue_is_empty (samples.queue))
+    gst_buffer_unref (g_queue_pop_head (samples.queue));
+  g_queue_free (samples.queue);
+  g_mutex_free (samples.lock);
+  g_cond_free (samples.cond);
+  gst_caps_unref (caps);
+  g_array_free (first, TRUE);
+  g_array_free (between, TRUE);
+
+  return ret;
+}
+
+static gboolean
+bench_latency (const gchar *url)
+{
+  gchar *base = g_path_get_dirname (url);
+  gboolean ret;
+
+  g_print ("latency : %d fragments, samples handed to another thread\n", n_fragments);
+  ret = bench_latency_run (base, TRUE) && bench_latency_run (base, FALSE);
+  g_free (base);
+
+  return ret;
+}
+
+static const struct
+{
+  const gchar *name;
+  gboolean (*run) (const gchar *url);
+} modes[] = {
+  {"play", bench_play},
+  {"seek-storm", bench_seek_storm},
+  {"retry", bench_retry},
+  {"setup", bench_setup},
+  {"latency", bench_latency},
+};
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *ctx = NULL;
+  GError *error = NULL;
+  struct rusage usage;
+  gboolean ok;
+  guint m;
+
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+
+  ctx = g_option_context_new ("URL - play a Smooth Streaming manifest through ssdemux");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (argc != 2) {
+    g_printerr ("usage: %s [OPTION...] URL\n", argv[0]);
+    return 1;
+  }
+  if (duration <= 0 || warmup < 0 || n_seeks < 1 || timeout < 1 || n_fragments < 1) {
+    g_printerr ("bad duration, warm-up, seeks, timeout or fragments\n");
+    return 1;
+  }
+
+  for (m = 0; m < G_N_ELEMENTS (modes); m++)
+    if (!strcmp (mode_name, modes[m].name))
+      break;
+  if (m == G_N_ELEMENTS (modes)) {
+    g_printerr ("unknown mode '%s'\n", mode_name);
+    return 1;
+  }
+
+  ok = modes[m].run (argv[1]);
+
+  getrusage (RUSAGE_SELF, &usage);
+  g_print ("memory  : %ld KB max RSS\n", usage.ru_maxrss);
+
+  return ok ? 0 : 1;
+}
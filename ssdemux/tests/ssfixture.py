@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+#
+# ssfixture: local stand-in of a Smooth Streaming server for ssdemux
+#
+# Serves a synthetic VOD or, with --live, live presentation, no media files
+# needed:
+#   <any path>/Manifest                                 the manifest
+#   .../QualityLevels(<bitrate>)/Fragments(video=<t>)   PIFF video fragment
+#   .../QualityLevels(<bitrate>)/Fragments(audio=<t>)   PIFF audio fragment
+#
+# A fragment is a moof (mfhd, traf with tfhd, trun & the tfxd uuid box)
+# followed by an mdat of bitrate * duration bytes of dummy samples. Each
+# response can be delayed (--latency) and throttled (--rate), so the ABR
+# and the prefetch window can be measured against a known link.
+#
+# The live presentation starts with LIVE_BACKLOG fragments published when the
+# server starts, then publishes one per fragment duration. Its manifest lists
+# the last --fragments published ones (the DVR window) and announces
+# --live-ahead more, which are answered 412 until they are published, like a
+# server asked for a fragment it does not have yet.
+#
+#   ssfixture.py --port=8080 --rate=2000 --latency=50
+#   ssfixture.py --live --live-ahead=2
+#
+
+import argparse
+import re
+import struct
+import sys
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+TIMESCALE = 10000000
+AUDIO_BITRATE = 128000
+AUDIO_RATE = 44100
+VIDEO_FPS = 30
+
+# 640x360 Main profile SPS & PPS, the samples are never decoded
+SPS_PPS = "00000001674D401FE8802802DD80B501010140000003004000000C03C60C44800000000168EBEF20"
+
+TFXD_UUID = bytes.fromhex("6D1D9B0542D544E680E2141DAFF757B2")
+
+# fragments published when a live presentation starts
+LIVE_BACKLOG = 3
+
+FRAGMENT_RE = re.compile(r"/QualityLevels\((\d+)\)/Fragments\((video|audio)=(\d+)\)$")
+
+
+def box(kind, payload):
+    return struct.pack(">I4s", 8 + len(payload), kind) + payload
+
+
+def full_box(kind, version, flags, payload):
+    return box(kind, struct.pack(">I", (version << 24) | flags) + payload)
+
+
+def fragment(seq, kind, bitrate, start, duration):
+    """moof + mdat of one fragment, @start & @duration in TIMESCALE units"""
+    seconds = duration / TIMESCALE
+    if kind == "video":
+        n_samples = max(1, int(round(seconds * VIDEO_FPS)))
+    else:
+        n_samples = max(1, int(round(seconds * AUDIO_RATE / 1024)))
+    sample_size = max(8, int(bitrate * seconds / 8) // n_samples)
+    sample_duration = duration // n_samples
+
+    samples = bytearray()
+    for i in range(n_samples):
+        if kind == "video":
+            # length prefixed NAL, IDR first
+            nal = bytes([0x65 if i == 0 else 0x41]) + bytes(sample_size - 5)
+            samples += struct.pack(">I", len(nal)) + nal
+        else:
+            samples += bytes(sample_size)
+
+    def moof(data_offset):
+        mfhd = full_box(b"mfhd", 0, 0, struct.pack(">I", seq))
+        # track 1, non sync samples by default
+        tfhd = full_box(b"tfhd", 0, 0x000020, struct.pack(">II", 1, 0x01010000))
+        # data offset, first sample flags (sync), duration & size per sample
+        entries = b"".join(struct.pack(">II", sample_duration, sample_size)
+                           for _ in range(n_samples))
+        trun = full_box(b"trun", 0, 0x000305,
+                        struct.pack(">IiI", n_samples, data_offset, 0x02000000) + entries)
+        tfxd = box(b"uuid", TFXD_UUID + struct.pack(">IQQ", 1 << 24, start, duration))
+        return box(b"moof", mfhd + box(b"traf", tfhd + trun + tfxd))
+
+    header = moof(0)
+    header = moof(len(header) + 8)
+
+    return header + box(b"mdat", bytes(samples))
+
+
+def manifest(args, first_index, count):
+    """manifest listing @count fragments per stream from @first_index"""
+    duration = int(args.fragment_duration * TIMESCALE)
+    chunks = "".join('      <c d="%d"/>\n' % duration for _ in range(count - 1))
+    first = '      <c t="%d" d="%d"/>\n' % (first_index * duration, duration)
+
+    if args.live:
+        timing = ('IsLive="TRUE" LookaheadCount="%d" DVRWindowLength="%d" Duration="0"'
+                  % (args.live_ahead, duration * args.fragments))
+    else:
+        timing = 'Duration="%d"' % (duration * count)
+
+    levels = ""
+    for i, kbps in enumerate(args.bitrates):
+        levels += ('      <QualityLevel Index="%d" Bitrate="%d" FourCC="H264" MaxWidth="640" '
+                   'MaxHeight="360" CodecPrivateData="%s" NALUnitLengthField="4"/>\n'
+                   % (i, kbps * 1000, SPS_PPS))
+
+    return ('<?xml version="1.0" encoding="UTF-8"?>\n'
+            '<SmoothStreamingMedia MajorVersion="2" MinorVersion="0" TimeScale="%d" %s>\n'
+            '  <StreamIndex Type="video" Chunks="%d" QualityLevels="%d" MaxWidth="640" MaxHeight="360" '
+            'DisplayWidth="640" DisplayHeight="360" Url="QualityLevels({bitrate})/Fragments(video={start time})">\n'
+            '%s%s%s'
+            '  </StreamIndex>\n'
+            '  <StreamIndex Type="audio" Chunks="%d" QualityLevels="1" '
+            'Url="QualityLevels({bitrate})/Fragments(audio={start time})">\n'
+            '      <QualityLevel Index="0" Bitrate="%d" FourCC="AACL" SamplingRate="%d" Channels="2" '
+            'BitsPerSample="16" PacketSize="4" AudioTag="255" CodecPrivateData="1210"/>\n'
+            '%s%s'
+            '  </StreamIndex>\n'
+            '</SmoothStreamingMedia>\n'
+            % (TIMESCALE, timing, count, len(args.bitrates),
+               levels, first, chunks, count, AUDIO_BITRATE, AUDIO_RATE, first, chunks)).encode()
+
+
+def published(server):
+    """fragments of the live presentation the server has by now"""
+    args = server.args
+    return LIVE_BACKLOG + int((time.monotonic() - server.start) / args.fragment_duration)
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, fmt, *fargs):
+        if self.server.args.verbose:
+            BaseHTTPRequestHandler.log_message(self, fmt, *fargs)
+
+    def reply(self, body, content_type):
+        args = self.server.args
+
+        if args.latency:
+            time.sleep(args.latency / 1000.0)
+
+        self.send_response(200)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+
+        if not args.rate:
+            self.wfile.write(body)
+            return
+
+        # paced in 16 KB writes to --rate kbps
+        start = time.monotonic()
+        for pos in range(0, len(body), 16384):
+            self.wfile.write(body[pos:pos + 16384])
+            due = start + (pos + 16384) * 8 / (args.rate * 1000.0)
+            delay = due - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+
+    def do_GET(self):
+        args = self.server.args
+        path = self.path.split("?")[0]
+        duration = int(args.fragment_duration * TIMESCALE)
+
+        if path.endswith("/Manifest"):
+            if args.live:
+                # the DVR window, then the fragments announced ahead
+                edge = published(self.server)
+                first = max(0, edge - args.fragments)
+                self.reply(manifest(args, first, edge + args.live_ahead - first), "text/xml")
+            else:
+                self.reply(self.server.manifest, "text/xml")
+            return
+
+        match = FRAGMENT_RE.search(path)
+        if match:
+            bitrate, kind, start = int(match.group(1)), match.group(2), int(match.group(3))
+            valid_bitrates = [AUDIO_BITRATE] if kind == "audio" else [k * 1000 for k in args.bitrates]
+            if args.live and bitrate in valid_bitrates and start % duration == 0 and \
+                    start // duration >= published(self.server):
+                self.send_error(412)
+                return
+            if bitrate in valid_bitrates and start % duration == 0 and \
+                    (args.live or start // duration < args.fragments):
+                self.reply(fragment(start // duration + 1, kind, bitrate, start, duration),
+                           "video/mp4" if kind == "video" else "audio/mp4")
+                return
+
+        self.send_error(404)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Smooth Streaming fixture server for ssdemux")
+    parser.add_argument("--port", type=int, default=0, help="port to listen on, 0 for any free port")
+    parser.add_argument("--port-file", help="file the port is written to once listening")
+    parser.add_argument("--bitrates", default="350,700,1500,3000",
+                        type=lambda s: [int(k) for k in s.split(",")],
+                        help="video quality levels in kbps")
+    parser.add_argument("--fragments", type=int, default=150,
+                        help="fragments per stream, of the DVR window with --live")
+    parser.add_argument("--fragment-duration", type=float, default=2.0, help="seconds")
+    parser.add_argument("--rate", type=int, default=0, help="kbps per response, 0 for unthrottled")
+    parser.add_argument("--latency", type=int, default=0, help="ms before each response")
+    parser.add_argument("--live", action="store_true", help="serve a live presentation")
+    parser.add_argument("--live-ahead", type=int, default=2,
+                        help="fragments announced before they are published, with --live")
+    parser.add_argument("--verbose", action="store_true", help="log the requests")
+    args = parser.parse_args()
+
+    if args.fragments < 1 or args.fragment_duration <= 0 or sorted(args.bitrates) != args.bitrates:
+        parser.error("bad fragment count, duration or bitrates")
+    if args.live_ahead < 1:
+        parser.error("at least one fragment has to be announced ahead")
+
+    server = ThreadingHTTPServer(("127.0.0.1", args.port), Handler)
+    server.daemon_threads = True
+    server.args = args
+    server.manifest = manifest(args, 0, args.fragments)
+    server.start = time.monotonic()
+
+    port = server.server_address[1]
+    if args.port_file:
+        with open(args.port_file, "w") as f:
+            f.write("%d\n" % port)
+    print("serving http://127.0.0.1:%d/bench.ism/Manifest" % port)
+    sys.stdout.flush()
+
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
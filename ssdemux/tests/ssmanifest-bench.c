@@ -0,0 +1,547 @@
+/*
+ * ssmanifest-bench: times the manifest parser on a synthetic presentation
+ *
+ * A manifest with --fragments <c> entries per stream is generated in memory,
+ * no network and no pipeline are involved. The modes are
+ *
+ *   seek   : seeks spread over the whole timeline, gst_ssm_parse_seek_manifest
+ *   append : live fragments appended to the timeline,
+ *            gst_ssm_parse_append_next_fragment
+ *   url    : fragment urls built from the compiled Url templates,
+ *            gst_ssm_parse_get_next_fragment_url, the audio one using
+ *            {CustomAttributes}
+ *   snapshot : cold start parsing the XML manifest against a warm start
+ *              from its snapshot, gst_ssm_parse_load_snapshot, at
+ *              --iterations / 100 loads each
+ *
+ * Seek & append are also run on a GList of fragment nodes handled the way
+ * the parser did before the timeline array (walking & rescaling node by
+ * node, g_list_last () per append), video urls by splitting & joining the
+ * Url pattern per fragment as the parser did before the templates, for
+ * reference.
+ *
+ *   ssmanifest-bench --fragments=50000 --iterations=1000 seek append
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include "ssmanifestparse.h"
+
+#define BENCH_TIMESCALE 10000000
+#define BENCH_FRAGMENT_DURATION 20000000 /* 2 s */
+#define BENCH_URI "http://localhost/bench.ism/Manifest"
+
+static gint n_fragments = 50000;
+static gint n_iterations = 1000;
+
+static GOptionEntry entries[] = {
+  {"fragments", 'f', 0, G_OPTION_ARG_INT, &n_fragments, "Fragments per stream in the manifest", "N"},
+  {"iterations", 'i', 0, G_OPTION_ARG_INT, &n_iterations, "Seeks, appends... timed per mode, x100 for urls", "N"},
+  {NULL}
+};
+
+/* what the parser did before the timeline array, one list per stream */
+typedef struct
+{
+  GList *fragments; /* current fragment */
+  guint64 timescale;
+} BenchList;
+
+static gchar *
+bench_build_manifest (guint n, gboolean live, gsize *size)
+{
+  GString *xml = g_string_new (NULL);
+  const gchar *types[] = { "video", "audio" };
+  guint i, s;
+
+  g_string_append_printf (xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<SmoothStreamingMedia MajorVersion=\"2\" MinorVersion=\"0\" TimeScale=\"%u\" "
+      "Duration=\"%" G_GUINT64_FORMAT "\"%s>\n", BENCH_TIMESCALE,
+      live ? (guint64) 0 : (guint64) n * BENCH_FRAGMENT_DURATION,
+      live ? " IsLive=\"TRUE\" LookAheadFragmentCount=\"2\" DVRWindowLength=\"0\"" : "");
+
+  for (s = 0; s < G_N_ELEMENTS (types); s++) {
+    g_string_append_printf (xml, "  <StreamIndex Type=\"%s\" Chunks=\"%u\" QualityLevels=\"%u\" "
+        "Url=\"QualityLevels({bitrate}%s)/Fragments(%s={start time})\">\n",
+        types[s], n, s ? 1 : 3, s ? ",{CustomAttributes}" : "", types[s]);
+
+    if (s == 0) {
+      static const guint bitrates[] = { 350000, 1500000, 3000000 };
+
+      for (i = 0; i < G_N_ELEMENTS (bitrates); i++)
+        g_string_append_printf (xml, "    <QualityLevel Index=\"%u\" Bitrate=\"%u\" FourCC=\"H264\" "
+            "MaxWidth=\"%u\" MaxHeight=\"%u\" CodecPrivateData=\"00000001674D401FE8802802DD80B501010140000003004000000C03C60C44800000000168EBEF20\"/>\n",
+            i, bitrates[i], 320 << i, 180 << i);
+    } else {
+      g_string_append (xml, "    <QualityLevel Index=\"0\" Bitrate=\"128000\" FourCC=\"AACL\" "
+          "SamplingRate=\"44100\" Channels=\"2\" BitsPerSample=\"16\" PacketSize=\"4\" "
+          "AudioTag=\"255\" CodecPrivateData=\"1210\">\n"
+          "      <CustomAttributes><Attribute Name=\"Lang\" Value=\"en\"/>"
+          "<Attribute Name=\"Mix\" Value=\"stereo\"/></CustomAttributes>\n"
+          "    </QualityLevel>\n");
+    }
+
+    g_string_append_printf (xml, "    <c t=\"0\" d=\"%u\"/>\n", BENCH_FRAGMENT_DURATION);
+    for (i = 1; i < n; i++)
+      g_string_append_printf (xml, "    <c d=\"%u\"/>\n", BENCH_FRAGMENT_DURATION);
+
+    g_string_append (xml, "  </StreamIndex>\n");
+  }
+  g_string_append (xml, "</SmoothStreamingMedia>\n");
+
+  *size = xml->len;
+
+  return g_string_free (xml, FALSE);
+}
+
+static GstSSMParse *
+bench_parse (guint n, gboolean live)
+{
+  GstSSMParse *parser = gst_ssm_parse_new (BENCH_URI);
+  gsize size = 0;
+  gchar *xml = bench_build_manifest (n, live, &size);
+
+  if (!gst_ssm_parse_manifest (parser, xml, size)) {
+    g_printerr ("failed to parse the synthetic manifest\n");
+    gst_ssm_parse_free (parser);
+    parser = NULL;
+  }
+  g_free (xml);
+
+  return parser;
+}
+
+static void
+bench_list_init (BenchList *list, GstSSMParse *parser, SS_STREAM_TYPE type)
+{
+  GstSSMStreamNode *stream = parser->RootNode->streams[type]->data;
+  guint i;
+
+  list->fragments = NULL;
+  list->timescale = GST_SSM_PARSE_GET_TIMESCALE (parser);
+  for (i = 0; i < stream->fragments->len; i++)
+    list->fragments = g_list_prepend (list->fragments,
+        g_slice_dup (GstSSMFragmentNode, GST_SSM_STREAM_FRAGMENT (stream, i)));
+  list->fragments = g_list_reverse (list->fragments);
+}
+
+static void
+bench_list_clear (BenchList *list)
+{
+  GList *walk;
+
+  for (walk = g_list_first (list->fragments); walk; walk = walk->next)
+    g_slice_free (GstSSMFragmentNode, walk->data);
+  g_list_free (g_list_first (list->fragments));
+  list->fragments = NULL;
+}
+
+#define BENCH_LIST_TS(list, node) \
+    gst_util_uint64_scale (((GstSSMFragmentNode *) (node)->data)->time, GST_SECOND, (list)->timescale)
+
+static void
+bench_list_seek (BenchList *list, guint64 seek_time)
+{
+  guint64 stream_time = BENCH_LIST_TS (list, list->fragments);
+
+  if (seek_time > stream_time) {
+    while (seek_time > stream_time && list->fragments->next) {
+      list->fragments = list->fragments->next;
+      stream_time = BENCH_LIST_TS (list, list->fragments);
+    }
+    if (seek_time < stream_time)
+      list->fragments = list->fragments->prev;
+  } else {
+    while (seek_time < stream_time && list->fragments->prev) {
+      list->fragments = list->fragments->prev;
+      stream_time = BENCH_LIST_TS (list, list->fragments);
+    }
+  }
+}
+
+static void
+bench_list_append (BenchList *list, guint64 timestamp, guint64 duration)
+{
+  GstSSMFragmentNode *fragment = g_slice_new0 (GstSSMFragmentNode);
+  GstSSMFragmentNode *last = g_list_last (list->fragments)->data;
+
+  if (last->time < timestamp) {
+    fragment->time = timestamp;
+    fragment->dur = duration;
+    list->fragments = g_list_append (list->fragments, fragment);
+  } else {
+    g_slice_free (GstSSMFragmentNode, fragment);
+  }
+}
+
+static gboolean
+bench_seek (void)
+{
+  GstSSMParse *parser = bench_parse (n_fragments, FALSE);
+  BenchList lists[SS_STREAM_NUM];
+  GTimer *timer = NULL;
+  GRand *rand = NULL;
+  guint64 duration = (guint64) n_fragments * BENCH_FRAGMENT_DURATION * (GST_SECOND / BENCH_TIMESCALE);
+  gdouble array_time, list_time;
+  gint i, s;
+
+  if (!parser)
+    return FALSE;
+
+  timer = g_timer_new ();
+
+  rand = g_rand_new_with_seed (0);
+  g_timer_start (timer);
+  for (i = 0; i < n_iterations; i++)
+    gst_ssm_parse_seek_manifest (parser, (guint64) (g_rand_double (rand) * duration));
+  array_time = g_timer_elapsed (timer, NULL);
+  g_rand_free (rand);
+
+  for (s = SS_STREAM_VIDEO; s <= SS_STREAM_AUDIO; s++)
+    bench_list_init (&lists[s], parser, s);
+
+  rand = g_rand_new_with_seed (0);
+  g_timer_start (timer);
+  for (i = 0; i < n_iterations; i++) {
+    guint64 seek_time = (guint64) (g_rand_double (rand) * duration);
+
+    for (s = SS_STREAM_VIDEO; s <= SS_STREAM_AUDIO; s++)
+      bench_list_seek (&lists[s], seek_time);
+  }
+  list_time = g_timer_elapsed (timer, NULL);
+  g_rand_free (rand);
+
+  g_print ("seek   : %d seeks over %d fragments, timeline %.3f us/seek, list %.3f us/seek\n",
+      n_iterations, n_fragments, array_time * 1e6 / n_iterations, list_time * 1e6 / n_iterations);
+
+  for (s = SS_STREAM_VIDEO; s <= SS_STREAM_AUDIO; s++)
+    bench_list_clear (&lists[s]);
+  g_timer_destroy (timer);
+  gst_ssm_parse_free (parser);
+
+  return TRUE;
+}
+
+static gboolean
+bench_append (void)
+{
+  GstSSMParse *parser = bench_parse (n_fragments, TRUE);
+  BenchList list;
+  GTimer *timer = NULL;
+  guint64 start = (guint64) n_fragments * BENCH_FRAGMENT_DURATION;
+  gdouble array_time, list_time;
+  gint i;
+
+  if (!parser)
+    return FALSE;
+
+  timer = g_timer_new ();
+  bench_list_init (&list, parser, SS_STREAM_VIDEO);
+
+  g_timer_start (timer);
+  for (i = 0; i < n_iterations; i++)
+    gst_ssm_parse_append_next_fragment (parser, SS_STREAM_VIDEO,
+        start + (guint64) i * BENCH_FRAGMENT_DURATION, BENCH_FRAGMENT_DURATION);
+  array_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < n_iterations; i++)
+    bench_list_append (&list, start + (guint64) i * BENCH_FRAGMENT_DURATION, BENCH_FRAGMENT_DURATION);
+  list_time = g_timer_elapsed (timer, NULL);
+
+  g_print ("append : %d appends after %d fragments, timeline %.3f us/append, list %.3f us/append\n",
+      n_iterations, n_fragments, array_time * 1e6 / n_iterations, list_time * 1e6 / n_iterations);
+
+  bench_list_clear (&list);
+  g_timer_destroy (timer);
+  gst_ssm_parse_free (parser);
+
+  return TRUE;
+}
+
+/* video url the way the parser built it before the templates */
+static gchar *
+bench_split_url (GstSSMParse *parser, GstSSMStreamNode *stream, guint bitrate, guint64 time)
+{
+  GPtrArray *strs = g_ptr_array_new ();
+  gchar **splitter1 = NULL;
+  gchar **splitter2 = NULL;
+  gchar **splitter3 = NULL;
+  gchar *uri = NULL;
+
+  g_ptr_array_add (strs, g_strdup (parser->presentation_uri));
+  splitter1 = g_strsplit (stream->StreamUrl, "{", 3);
+  g_ptr_array_add (strs, g_strdup (splitter1[0]));
+  g_ptr_array_add (strs, g_strdup_printf ("%d", bitrate));
+  splitter2 = g_strsplit (splitter1[1], "}", 2);
+  g_ptr_array_add (strs, g_strdup (splitter2[1]));
+  g_ptr_array_add (strs, g_strdup_printf ("%" G_GUINT64_FORMAT, time));
+  splitter3 = g_strsplit (splitter1[2], "}", 2);
+  g_ptr_array_add (strs, g_strdup (splitter3[1]));
+  g_ptr_array_add (strs, NULL);
+
+  uri = g_strjoinv (NULL, (gchar **) strs->pdata);
+  g_strfreev ((gchar **) g_ptr_array_free (strs, FALSE));
+  g_strfreev (splitter1);
+  g_strfreev (splitter2);
+  g_strfreev (splitter3);
+
+  return uri;
+}
+
+/* seconds to build @n urls of @type, starting over at the end of the
+ * timeline */
+static gdouble
+bench_url_run (GstSSMParse *parser, SS_STREAM_TYPE type, guint n, gchar **sample)
+{
+  GTimer *timer = g_timer_new ();
+  gdouble elapsed;
+  guint i;
+
+  gst_ssm_parse_seek_manifest (parser, 0);
+  g_timer_start (timer);
+  for (i = 0; i < n; i++) {
+    gchar *uri = NULL;
+    guint64 start_ts = 0;
+
+    if (!gst_ssm_parse_get_next_fragment_url (parser, type, &uri, &start_ts, NULL)) {
+      gst_ssm_parse_seek_manifest (parser, 0);
+      gst_ssm_parse_get_next_fragment_url (parser, type, &uri, &start_ts, NULL);
+    }
+    if (i == 0)
+      *sample = uri;
+    else
+      g_free (uri);
+  }
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  return elapsed;
+}
+
+static gboolean
+bench_url (void)
+{
+  GstSSMParse *parser = bench_parse (n_fragments, FALSE);
+  GstSSMStreamNode *stream = NULL;
+  GstSSMQualityNode *quality = NULL;
+  GTimer *timer = NULL;
+  gchar *video_url = NULL;
+  gchar *audio_url = NULL;
+  gchar *split_url = NULL;
+  guint n = (guint) n_iterations * 100;
+  gdouble video_time, audio_time, split_time;
+  guint i;
+
+  if (!parser)
+    return FALSE;
+
+  video_time = bench_url_run (parser, SS_STREAM_VIDEO, n, &video_url);
+  audio_time = bench_url_run (parser, SS_STREAM_AUDIO, n, &audio_url);
+
+  stream = parser->RootNode->streams[SS_STREAM_VIDEO]->data;
+  quality = stream->quality_lists->data;
+  timer = g_timer_new ();
+  for (i = 0; i < n; i++) {
+    gchar *uri = bench_split_url (parser, stream, quality->bitrate,
+        GST_SSM_STREAM_FRAGMENT (stream, i % stream->fragments->len)->time);
+
+    if (i == 0)
+      split_url = uri;
+    else
+      g_free (uri);
+  }
+  split_time = g_timer_elapsed (timer, NULL);
+
+  if (strcmp (video_url, split_url)) {
+    g_printerr ("url mismatch : template '%s', split '%s'\n", video_url, split_url);
+    return FALSE;
+  }
+
+  g_print ("url    : %u urls, video template %.0f urls/s (%.3f us/url), split %.0f urls/s (%.3f us/url)\n"
+      "         audio template with {CustomAttributes} %.0f urls/s (%.3f us/url), e.g. %s\n",
+      n, n / video_time, video_time * 1e6 / n, n / split_time, split_time * 1e6 / n,
+      n / audio_time, audio_time * 1e6 / n, audio_url);
+
+  g_free (video_url);
+  g_free (audio_url);
+  g_free (split_url);
+  g_timer_destroy (timer);
+  gst_ssm_parse_free (parser);
+
+  return TRUE;
+}
+
+/* same timeline on both sides, fragment by fragment */
+static gboolean
+bench_same_timeline (GstSSMParse *a, GstSSMParse *b)
+{
+  gint s;
+  guint i;
+
+  for (s = SS_STREAM_VIDEO; s <= SS_STREAM_AUDIO; s++) {
+    GstSSMStreamNode *sa = a->RootNode->streams[s]->data;
+    GstSSMStreamNode *sb = b->RootNode->streams[s]->data;
+
+    if (sa->fragments->len != sb->fragments->len)
+      return FALSE;
+    for (i = 0; i < sa->fragments->len; i++) {
+      GstSSMFragmentNode *fa = GST_SSM_STREAM_FRAGMENT (sa, i);
+      GstSSMFragmentNode *fb = GST_SSM_STREAM_FRAGMENT (sb, i);
+
+      if (fa->num != fb->num || fa->dur != fb->dur || fa->time != fb->time ||
+          fa->media_type != fb->media_type || fa->ts != fb->ts)
+        return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static gboolean
+bench_snapshot (void)
+{
+  GstSSMParse *parser = NULL;
+  GstSSMParse *loaded = NULL;
+  GTimer *timer = NULL;
+  GError *error = NULL;
+  gchar *location = NULL;
+  gchar *xml = NULL;
+  gsize size = 0;
+  gsize snapshot_size = 0;
+  gchar *contents = NULL;
+  gint n = MAX (n_iterations / 100, 1);
+  gdouble xml_time, snapshot_time;
+  gboolean ret = FALSE;
+  gint fd;
+  gint i;
+
+  fd = g_file_open_tmp ("ssmanifest-bench-XXXXXX", &location, &error);
+  if (fd < 0) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return FALSE;
+  }
+  close (fd);
+
+  xml = bench_build_manifest (n_fragments, FALSE, &size);
+  timer = g_timer_new ();
+
+  xml_time = 0;
+  for (i = 0; i < n; i++) {
+    g_timer_start (timer);
+    parser = gst_ssm_parse_new (BENCH_URI);
+    if (!gst_ssm_parse_manifest (parser, xml, size)) {
+      g_printerr ("failed to parse the synthetic manifest\n");
+      goto done;
+    }
+    xml_time += g_timer_elapsed (timer, NULL);
+    if (i + 1 < n) {
+      gst_ssm_parse_free (parser);
+      parser = NULL;
+    }
+  }
+
+  if (!gst_ssm_parse_save_snapshot (parser, location)) {
+    g_printerr ("failed to write the snapshot to %s\n", location);
+    goto done;
+  }
+  if (g_file_get_contents (location, &contents, &snapshot_size, NULL))
+    g_free (contents);
+
+  snapshot_time = 0;
+  for (i = 0; i < n; i++) {
+    g_timer_start (timer);
+    loaded = gst_ssm_parse_new (BENCH_URI);
+    if (!gst_ssm_parse_load_snapshot (loaded, location)) {
+      g_printerr ("failed to load the snapshot\n");
+      goto done;
+    }
+    snapshot_time += g_timer_elapsed (timer, NULL);
+    if (i + 1 < n) {
+      gst_ssm_parse_free (loaded);
+      loaded = NULL;
+    }
+  }
+
+  if (!bench_same_timeline (parser, loaded)) {
+    g_printerr ("the snapshot timeline differs from the parsed one\n");
+    goto done;
+  }
+
+  g_print ("snapshot : %d loads of %d fragments, xml %.2f ms (%" G_GSIZE_FORMAT " KB), "
+      "snapshot %.2f ms (%" G_GSIZE_FORMAT " KB)\n", n, n_fragments,
+      xml_time * 1e3 / n, size / 1024, snapshot_time * 1e3 / n, snapshot_size / 1024);
+  ret = TRUE;
+
+done:
+  if (parser)
+    gst_ssm_parse_free (parser);
+  if (loaded)
+    gst_ssm_parse_free (loaded);
+  g_unlink (location);
+  g_free (location);
+  g_free (xml);
+  g_timer_destroy (timer);
+
+  return ret;
+}
+
+static const struct
+{
+  const gchar *name;
+  gboolean (*run) (void);
+} modes[] = {
+  {"seek", bench_seek},
+  {"append", bench_append},
+  {"url", bench_url},
+  {"snapshot", bench_snapshot},
+};
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *ctx = NULL;
+  GError *error = NULL;
+  guint m;
+  gint i;
+
+  ctx = g_option_context_new ("[MODE...] - time the manifest parser, all modes by default");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (n_fragments < 2 || n_iterations < 1) {
+    g_printerr ("need at least 2 fragments & 1 iteration\n");
+    return 1;
+  }
+
+  for (i = 1; i < argc; i++) {
+    for (m = 0; m < G_N_ELEMENTS (modes); m++)
+      if (!strcmp (argv[i], modes[m].name))
+        break;
+    if (m == G_N_ELEMENTS (modes)) {
+      g_printerr ("unknown mode '%s'\n", argv[i]);
+      return 1;
+    }
+  }
+
+  for (m = 0; m < G_N_ELEMENTS (modes); m++) {
+    gboolean selected = (argc == 1);
+
+    for (i = 1; i < argc; i++)
+      selected |= !strcmp (argv[i], modes[m].name);
+
+    if (selected && !modes[m].run ())
+      return 1;
+  }
+
+  return 0;
+}